@@ -0,0 +1,69 @@
+#pragma once
+#include <spdlog/spdlog.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Small helpers shared by the benchmark binaries: --name=value flags, a
+// wall-clock timer, unique scratch file names and log levels.
+namespace srd::bench {
+
+class Flags {
+   public:
+    Flags(int argc, char **argv) : argc_(argc), argv_(argv) {}
+
+    std::string get(const char *name, const std::string &def) const {
+        const std::string prefix = std::string("--") + name + "=";
+        for (int i = 1; i < argc_; ++i) {
+            if (std::strncmp(argv_[i], prefix.c_str(), prefix.size()) == 0) {
+                return argv_[i] + prefix.size();
+            }
+        }
+        return def;
+    }
+
+    std::uint64_t get_u64(const char *name, std::uint64_t def) const {
+        const std::string v = get(name, "");
+        return v.empty() ? def : std::strtoull(v.c_str(), nullptr, 10);
+    }
+
+    double get_double(const char *name, double def) const {
+        const std::string v = get(name, "");
+        return v.empty() ? def : std::strtod(v.c_str(), nullptr);
+    }
+
+   private:
+    int argc_;
+    char **argv_;
+};
+
+class Timer {
+   public:
+    Timer() : start_(std::chrono::steady_clock::now()) {}
+    double seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                             start_)
+            .count();
+    }
+
+   private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+inline std::string scratch_path(const std::string &dir, const char *tag) {
+    static int counter = 0;
+    return dir + "/srd_bench_" + tag + "_" + std::to_string(::getpid()) + "_" +
+           std::to_string(counter++) + ".dat";
+}
+
+// Opening a StorageManager or filling a SlottedPage logs at info level;
+// inside a timed loop that output skews the numbers. Keep warnings only.
+inline void quiet_logs() {
+    spdlog::set_level(spdlog::level::warn);
+}
+
+}  // namespace srd::bench
@@ -0,0 +1,164 @@
+// Foreground write throughput while backups and checkpoints run. Writer
+// threads rewrite random pages of a preloaded file (so the file size, and
+// the snapshot size, stays fixed); the throughput is measured
+//   - alone (baseline),
+//   - during snapshot_to with the copy fallback, rate-limited,
+//   - during snapshot_to with reflink allowed (labelled by what was done:
+//     a copy where reflink is unsupported),
+//   - with pages updated in memory and a Checkpointer writing them back.
+//
+//   checkpoint_bench --pages=16384 --threads=2 --seconds=2 --copy_mbps=64
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench/bench_util.hpp"
+#include "srd/storage/checkpointer.hpp"
+
+using srd::bench::Flags;
+using srd::bench::Timer;
+using srd::storage::CheckpointOptions;
+using srd::storage::Checkpointer;
+using srd::storage::PAGE_SIZE;
+using srd::storage::SlottedPage;
+using srd::storage::SnapshotOptions;
+using srd::storage::SnapshotStats;
+using srd::storage::StorageManager;
+
+namespace {
+
+// Run 'threads' writers until 'body' returns; returns their ops/s.
+double with_writers(StorageManager &sm, std::size_t threads,
+                    std::uint64_t pages, const std::function<void()> &body,
+                    double *elapsed = nullptr) {
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> ops{0};
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 rng(t + 1);
+            SlottedPage page;
+            std::uint64_t n = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                std::memset(page.raw_data(), static_cast<int>(n), 64);
+                sm.flush(rng() % pages, page);
+                ++n;
+            }
+            ops += n;
+        });
+    }
+    const Timer timer;
+    body();
+    const double secs = timer.seconds();
+    stop = true;
+    for (auto &w : workers) w.join();
+    if (elapsed != nullptr) *elapsed = secs;
+    return static_cast<double>(ops.load()) / secs;
+}
+
+void sleep_for(double secs) {
+    std::this_thread::sleep_for(std::chrono::duration<double>(secs));
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    srd::bench::quiet_logs();
+    const Flags flags(argc, argv);
+    const std::uint64_t pages = flags.get_u64("pages", 16384);
+    const std::size_t threads = flags.get_u64("threads", 2);
+    const double seconds = flags.get_double("seconds", 2.0);
+    const std::uint64_t copy_mbps = flags.get_u64("copy_mbps", 64);
+    const std::string dir = flags.get("dir", ".");
+
+    const std::string path = srd::bench::scratch_path(dir, "ckpt_src");
+    const std::string target = srd::bench::scratch_path(dir, "ckpt_snap");
+    StorageManager sm(path);
+    {
+        sm.extend_to(pages - 1);
+        SlottedPage page;
+        std::vector<const SlottedPage *> batch(256, &page);
+        for (std::uint64_t p = 0; p < pages; p += batch.size()) {
+            const std::size_t n = std::min<std::uint64_t>(256, pages - p);
+            sm.flush_range(p, {batch.data(), n});
+        }
+        sm.sync();
+    }
+    std::printf("pages=%llu (%.0f MiB) threads=%zu\n",
+                static_cast<unsigned long long>(pages),
+                static_cast<double>(pages * PAGE_SIZE) / 1048576.0, threads);
+
+    const double base =
+        with_writers(sm, threads, pages, [&] { sleep_for(seconds); });
+    std::printf("%-28s %10.0f writes/s\n", "baseline", base);
+
+    for (bool reflink : {false, true}) {
+        SnapshotOptions o;
+        o.reflink = reflink;
+        o.bytes_per_sec = copy_mbps << 20;
+        SnapshotStats stats;
+        double secs = 0;
+        const double rate = with_writers(
+            sm, threads, pages,
+            [&] { stats = sm.snapshot_to(target, o); }, &secs);
+        std::printf("%-28s %10.0f writes/s (%.0f%% of baseline) "
+                    "snapshot %.2f s, %llu pages, reflink allowed=%s, "
+                    "saved by writers=%llu\n",
+                    stats.reflinked ? "during snapshot (reflink)"
+                                    : "during snapshot (copy)",
+                    rate, 100.0 * rate / base, secs,
+                    static_cast<unsigned long long>(stats.pages),
+                    reflink ? "yes" : "no",
+                    static_cast<unsigned long long>(stats.copied_by_writers));
+        std::filesystem::remove(target);
+    }
+
+    // Writers again, while the main thread updates a hot set in memory
+    // and marks it dirty every 20 ms; the checkpointer writes it back.
+    {
+        const std::uint64_t hot = std::min<std::uint64_t>(pages, 4096);
+        std::vector<std::unique_ptr<SlottedPage>> mem;
+        for (std::uint64_t i = 0; i < hot; ++i) {
+            mem.push_back(std::make_unique<SlottedPage>());
+        }
+        CheckpointOptions o;
+        o.bytes_per_sec = copy_mbps << 20;
+        Checkpointer ckpt(sm, o);
+        std::uint64_t updates = 0;
+        const double rate = with_writers(sm, threads, pages, [&] {
+            const Timer t;
+            std::size_t slot = 0;
+            while (t.seconds() < seconds) {
+                for (std::uint64_t id = 0; id < hot; ++id) {
+                    // A full page drops the record but is still marked.
+                    mem[id]->addRecord("update", slot);
+                    ckpt.mark_dirty(id, mem[id].get());
+                }
+                updates += hot;
+                sleep_for(0.02);
+            }
+        });
+        const Timer t;
+        ckpt.checkpoint();
+        const auto stats = ckpt.stats();
+        std::printf("%-28s %10.0f writes/s (%.0f%% of baseline) "
+                    "%llu updates, %llu pages in %llu rounds, "
+                    "final checkpoint %.3f s\n",
+                    "with checkpointer", rate, 100.0 * rate / base,
+                    static_cast<unsigned long long>(updates),
+                    static_cast<unsigned long long>(stats.pages_written),
+                    static_cast<unsigned long long>(stats.rounds),
+                    t.seconds());
+    }
+    std::filesystem::remove(path);
+    return 0;
+}
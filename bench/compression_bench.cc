@@ -0,0 +1,178 @@
+// Raw vs. compressed page files: writes the same table to both, then
+// reports on-disk size and full-scan throughput. With --drop_cache=1 (the
+// default) each file is synced and evicted from the page cache before it
+// is scanned, so the scan reads from the device, which is where the
+// smaller compressed file is meant to win.
+//
+//   compression_bench --rows=2000000 --payload=48 --fill=0.7 --dir=/scratch
+//
+// --fill sets how full each page is (records per page as a fraction of
+// what fits), since partly filled pages are where zero-trimming pays.
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench/bench_util.hpp"
+#include "srd/record/tuple.hpp"
+#include "srd/storage/record_stream.hpp"
+
+using srd::bench::Flags;
+using srd::bench::Timer;
+using srd::record::Field;
+using srd::record::Tuple;
+using srd::storage::MAX_SLOTS;
+using srd::storage::PAGE_SIZE;
+using srd::storage::RecordReader;
+using srd::storage::SlottedPage;
+using srd::storage::StorageManager;
+using srd::storage::StorageOptions;
+
+namespace {
+
+struct Result {
+    double write_secs = 0;
+    double scan_secs = 0;
+    std::uint64_t file_bytes = 0;
+    std::uint64_t pages = 0;
+    std::uint64_t scanned = 0;
+};
+
+std::string make_row(std::mt19937 &rng, std::size_t payload) {
+    static const char *const WORDS[] = {"alpha", "bravo", "charlie", "delta",
+                                        "echo",  "fox",   "golf",    "hotel"};
+    std::string text;
+    while (text.size() < payload) {
+        text += WORDS[rng() % 8];
+        text += ' ';
+    }
+    text.resize(payload);
+    Tuple t;
+    t.addField(std::make_unique<Field>(static_cast<int>(rng() % 1000000)));
+    t.addField(std::make_unique<Field>(static_cast<float>(rng() % 10000) /
+                                       100.0f));
+    t.addField(std::make_unique<Field>(text));
+    return t.serialize();
+}
+
+void evict(const std::string &path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+}
+
+Result run(const std::string &path, bool compressed, std::uint64_t rows,
+           std::size_t payload, std::size_t per_page, bool drop_cache) {
+    StorageOptions o;
+    o.compressed = compressed;
+    Result r;
+    {
+        StorageManager sm(path, o);
+        std::mt19937 rng(7);
+        const Timer timer;
+        // Pages are filled to the target by hand so every file gets the
+        // same layout; flushed in batches like RecordWriter does.
+        std::vector<std::unique_ptr<SlottedPage>> batch;
+        std::uint64_t next_page = 0;
+        auto flush_batch = [&] {
+            if (batch.empty()) return;
+            sm.extend_to(next_page + batch.size() - 1);
+            std::vector<const SlottedPage *> ptrs;
+            for (const auto &p : batch) ptrs.push_back(p.get());
+            sm.flush_range(next_page, ptrs);
+            next_page += batch.size();
+            batch.clear();
+        };
+        std::size_t on_page = per_page;
+        for (std::uint64_t i = 0; i < rows; ++i) {
+            const std::string rec = make_row(rng, payload);
+            std::size_t slot = 0;
+            if (on_page == per_page || !batch.back()->addRecord(rec, slot)) {
+                if (batch.size() == 64) flush_batch();
+                batch.push_back(std::make_unique<SlottedPage>());
+                batch.back()->addRecord(rec, slot);
+                on_page = 0;
+            }
+            ++on_page;
+        }
+        flush_batch();
+        sm.sync();
+        r.write_secs = timer.seconds();
+        r.pages = sm.num_pages();
+        r.file_bytes = sm.file_bytes();
+    }
+    if (drop_cache) evict(path);
+
+    StorageManager sm(path, o);
+    const Timer timer;
+    RecordReader reader(sm, 0, 0, 64);
+    std::string rec;
+    while (reader.next(rec)) ++r.scanned;
+    r.scan_secs = timer.seconds();
+    return r;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    srd::bench::quiet_logs();
+    const Flags flags(argc, argv);
+    const std::uint64_t rows = flags.get_u64("rows", 1000000);
+    const std::size_t payload = flags.get_u64("payload", 48);
+    const double fill = flags.get_double("fill", 0.7);
+    const bool drop_cache = flags.get_u64("drop_cache", 1) != 0;
+    const std::string dir = flags.get("dir", ".");
+
+    // Records per page at the requested fill.
+    std::size_t fits = 0;
+    {
+        std::mt19937 rng(7);
+        SlottedPage probe;
+        std::size_t slot = 0;
+        while (fits < MAX_SLOTS &&
+               probe.addRecord(make_row(rng, payload), slot)) {
+            ++fits;
+        }
+    }
+    const auto per_page = std::max<std::size_t>(
+        1, static_cast<std::size_t>(fill * static_cast<double>(fits)));
+
+    const std::string raw_path = srd::bench::scratch_path(dir, "raw");
+    const std::string lz_path = srd::bench::scratch_path(dir, "lz");
+    const Result raw =
+        run(raw_path, false, rows, payload, per_page, drop_cache);
+    const Result lz = run(lz_path, true, rows, payload, per_page, drop_cache);
+
+    const double logical = static_cast<double>(raw.pages) * PAGE_SIZE;
+    std::printf("rows=%llu payload=%zu B records/page=%zu/%zu pages=%llu "
+                "drop_cache=%s\n",
+                static_cast<unsigned long long>(rows), payload, per_page, fits,
+                static_cast<unsigned long long>(raw.pages),
+                drop_cache ? "yes" : "no");
+    for (const auto &[name, r] : {std::pair{"raw", raw}, std::pair{"lz", lz}}) {
+        std::printf("%-4s size=%8.1f MiB write=%.3f s scan=%.3f s "
+                    "(%.1f MiB/s of pages, %.0f rows/s)%s\n",
+                    name, static_cast<double>(r.file_bytes) / 1048576.0,
+                    r.write_secs, r.scan_secs,
+                    logical / 1048576.0 / r.scan_secs,
+                    static_cast<double>(r.scanned) / r.scan_secs,
+                    r.scanned == rows ? "" : "  ROW COUNT MISMATCH");
+    }
+    std::printf("ratio=%.2fx scan speedup=%.2fx\n",
+                static_cast<double>(raw.file_bytes) /
+                    static_cast<double>(lz.file_bytes),
+                raw.scan_secs / lz.scan_secs);
+
+    std::filesystem::remove(raw_path);
+    std::filesystem::remove(lz_path);
+    std::filesystem::remove(StorageManager::page_map_path(lz_path));
+    return (raw.scanned == rows && lz.scanned == rows) ? 0 : 1;
+}
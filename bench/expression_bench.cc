@@ -0,0 +1,225 @@
+// Filter throughput of CompiledExpr against interpreting the same Expr tree
+// row by row: once over Tuple::deserialize'd Fields (the naive path, with
+// an allocation per field and a type switch in every accessor) and once
+// over TupleView (no allocation, but still a tree walk and type dispatch
+// per row). Rows are (id INT, qty INT, price FLOAT, region STRING).
+//
+//   expression_bench --rows=2000000 --reps=3
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench/bench_util.hpp"
+#include "srd/execution/expression.hpp"
+#include "srd/record/tuple.hpp"
+#include "srd/record/tuple_view.hpp"
+
+using srd::bench::Flags;
+using srd::bench::Timer;
+using srd::execution::CompiledExpr;
+using srd::execution::Expr;
+using srd::execution::ExprOp;
+using srd::execution::ExprType;
+using srd::record::Field;
+using srd::record::FieldType;
+using srd::record::Tuple;
+using srd::record::TupleView;
+
+namespace {
+
+struct Value {
+    ExprType type = ExprType::BOOL;
+    bool b = false;
+    int64_t i = 0;
+    double d = 0.0;
+    std::string s;
+};
+
+double as_double(const Value &v) {
+    return v.type == ExprType::INT ? static_cast<double>(v.i) : v.d;
+}
+
+template <class Cmp>
+bool compare(const Value &a, const Value &b, Cmp cmp) {
+    if (a.type == ExprType::STRING) return cmp(a.s.compare(b.s), 0);
+    if (a.type == ExprType::INT && b.type == ExprType::INT) {
+        return cmp(a.i, b.i);
+    }
+    return cmp(as_double(a), as_double(b));
+}
+
+// Tree-walking interpreter; col(e) reads column node 'e' of the row.
+Value interpret(const Expr &e, const std::function<Value(const Expr &)> &col) {
+    Value out;
+    out.type = e.type();
+    switch (e.op()) {
+        case ExprOp::COLUMN: return col(e);
+        case ExprOp::CONSTANT:
+            out.b = e.int_value() != 0;
+            out.i = e.int_value();
+            out.d = e.float_value();
+            out.s = e.string_value();
+            return out;
+        case ExprOp::NOT: out.b = !interpret(e.left(), col).b; return out;
+        case ExprOp::AND:
+            out.b = interpret(e.left(), col).b && interpret(e.right(), col).b;
+            return out;
+        case ExprOp::OR:
+            out.b = interpret(e.left(), col).b || interpret(e.right(), col).b;
+            return out;
+        default: break;
+    }
+    const Value a = interpret(e.left(), col);
+    const Value b = interpret(e.right(), col);
+    switch (e.op()) {
+        case ExprOp::ADD:
+        case ExprOp::SUB:
+        case ExprOp::MUL:
+            if (out.type == ExprType::INT) {
+                out.i = e.op() == ExprOp::ADD   ? a.i + b.i
+                        : e.op() == ExprOp::SUB ? a.i - b.i
+                                                : a.i * b.i;
+            } else {
+                const double x = as_double(a), y = as_double(b);
+                out.d = e.op() == ExprOp::ADD   ? x + y
+                        : e.op() == ExprOp::SUB ? x - y
+                                                : x * y;
+            }
+            return out;
+        case ExprOp::EQ: out.b = compare(a, b, std::equal_to<>()); break;
+        case ExprOp::NE: out.b = compare(a, b, std::not_equal_to<>()); break;
+        case ExprOp::LT: out.b = compare(a, b, std::less<>()); break;
+        case ExprOp::LE: out.b = compare(a, b, std::less_equal<>()); break;
+        case ExprOp::GT: out.b = compare(a, b, std::greater<>()); break;
+        case ExprOp::GE: out.b = compare(a, b, std::greater_equal<>()); break;
+        default: break;
+    }
+    return out;
+}
+
+std::size_t naive_filter(const Expr &pred,
+                         const std::vector<std::string> &recs) {
+    std::size_t hits = 0;
+    for (const auto &rec : recs) {
+        std::istringstream in(rec);
+        const auto t = Tuple::deserialize(in);
+        const auto col = [&](const Expr &c) {
+            const Field &f = *t->fields.at(c.column_index());
+            Value v;
+            v.type = c.type();
+            switch (c.column_type()) {
+                case FieldType::INT: v.i = f.asInt(); break;
+                case FieldType::FLOAT: v.d = f.asFloat(); break;
+                case FieldType::STRING: v.s = f.asString(); break;
+            }
+            return v;
+        };
+        hits += interpret(pred, col).b;
+    }
+    return hits;
+}
+
+std::size_t view_filter(const Expr &pred,
+                        const std::vector<std::string> &recs) {
+    std::size_t hits = 0;
+    for (const auto &rec : recs) {
+        const TupleView t(rec);
+        const auto col = [&](const Expr &c) {
+            const auto f = t.field(c.column_index());
+            Value v;
+            v.type = c.type();
+            switch (c.column_type()) {
+                case FieldType::INT: v.i = f.asInt(); break;
+                case FieldType::FLOAT: v.d = f.asFloat(); break;
+                case FieldType::STRING: v.s = f.asString(); break;
+            }
+            return v;
+        };
+        hits += interpret(pred, col).b;
+    }
+    return hits;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    srd::bench::quiet_logs();
+    const Flags flags(argc, argv);
+    const std::size_t rows = flags.get_u64("rows", 1000000);
+    const int reps = static_cast<int>(flags.get_u64("reps", 3));
+
+    static const char *const REGIONS[] = {"EU", "US", "APAC", "LATAM"};
+    std::mt19937 rng(11);
+    std::vector<std::string> recs;
+    recs.reserve(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        Tuple t;
+        t.addField(std::make_unique<Field>(static_cast<int>(rng() % 1000000)));
+        t.addField(std::make_unique<Field>(static_cast<int>(rng() % 100)));
+        t.addField(std::make_unique<Field>(static_cast<float>(rng() % 10000) /
+                                           100.0f));
+        t.addField(std::make_unique<Field>(std::string(REGIONS[rng() % 4])));
+        recs.push_back(t.serialize());
+    }
+    const std::vector<std::string_view> views(recs.begin(), recs.end());
+
+    const Expr id = Expr::column(0, FieldType::INT);
+    const Expr qty = Expr::column(1, FieldType::INT);
+    const Expr price = Expr::column(2, FieldType::FLOAT);
+    const Expr region = Expr::column(3, FieldType::STRING);
+    const std::pair<const char *, Expr> queries[] = {
+        {"price < 50", Expr::lt(price, Expr::constant(50.0))},
+        {"qty * price - 10 > 2000",
+         Expr::gt(Expr::sub(Expr::mul(qty, price), Expr::constant(10)),
+                  Expr::constant(2000))},
+        {"(region = EU and price * 1.1 < 50) or id > 900000",
+         Expr::logical_or(
+             Expr::logical_and(
+                 Expr::eq(region, Expr::constant("EU")),
+                 Expr::lt(Expr::mul(price, Expr::constant(1.1)),
+                          Expr::constant(50.0))),
+             Expr::gt(id, Expr::constant(900000)))},
+    };
+
+    std::printf("rows=%zu reps=%d (best of reps, Mrows/s)\n", rows, reps);
+    int status = 0;
+    for (const auto &[name, pred] : queries) {
+        double best_naive = 1e30, best_view = 1e30, best_compiled = 1e30;
+        std::size_t naive_hits = 0, view_hits = 0, compiled_hits = 0;
+        for (int r = 0; r < reps; ++r) {
+            Timer t0;
+            naive_hits = naive_filter(pred, recs);
+            best_naive = std::min(best_naive, t0.seconds());
+
+            Timer t1;
+            view_hits = view_filter(pred, recs);
+            best_view = std::min(best_view, t1.seconds());
+
+            // Compilation is part of the measured time.
+            Timer t2;
+            const CompiledExpr compiled(pred);
+            std::vector<uint32_t> sel;
+            sel.reserve(rows);
+            compiled_hits = compiled.filter(views, sel);
+            best_compiled = std::min(best_compiled, t2.seconds());
+        }
+        const double n = static_cast<double>(rows) / 1e6;
+        std::printf("%-52s naive=%7.2f view=%7.2f compiled=%7.2f "
+                    "(x%.1f vs naive, x%.1f vs view) hits=%zu%s\n",
+                    name, n / best_naive, n / best_view, n / best_compiled,
+                    best_naive / best_compiled, best_view / best_compiled,
+                    compiled_hits,
+                    naive_hits == compiled_hits && view_hits == compiled_hits
+                        ? ""
+                        : "  MISMATCH");
+        if (naive_hits != compiled_hits || view_hits != compiled_hits) {
+            status = 1;
+        }
+    }
+    return status;
+}
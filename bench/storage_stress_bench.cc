@@ -0,0 +1,412 @@
+// Concurrent load generator for StorageManager and SlottedPage. N threads
+// run a weighted mix of reads, in-place updates, inserts, deletes and page
+// flushes against a shared set of in-memory pages backed by one file, then
+// every page is flushed, read back and checked.
+//
+//   storage_stress_bench --threads=8 --seconds=10 --pages=4096 --fill=0.7
+//       --read=60 --update=20 --insert=10 --delete=5 --flush=5
+//       --dist=zipf --theta=0.99 --record_bytes=64 --dir=/scratch
+//
+// --dist picks both the page and the slot of an operation: "uniform", or
+// "zipf" with skew --theta (hot pages are the lowest page ids). --ops sets
+// a fixed operation count per thread instead of --seconds.
+//
+// Records are [u64 key][u64 version][payload], the payload derived from
+// key and version, so any record read back can be checked on its own.
+// Integrity at the end: every live record is intact, no key appears twice,
+// every key was actually written, and the file matches memory exactly.
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "bench/bench_util.hpp"
+#include "srd/common/hash.hpp"
+#include "srd/storage/storage_manager.hpp"
+
+using srd::bench::Flags;
+using srd::bench::Timer;
+using srd::common::mix64;
+using srd::storage::MAX_SLOTS;
+using srd::storage::PAGE_SIZE;
+using srd::storage::SlottedPage;
+using srd::storage::StorageManager;
+
+namespace {
+
+enum Op { READ, UPDATE, INSERT, DELETE, FLUSH, NUM_OPS };
+constexpr const char *OP_NAMES[NUM_OPS] = {"read", "update", "insert",
+                                           "delete", "flush"};
+constexpr std::uint64_t HEADER = 16;
+constexpr int THREAD_SHIFT = 48;
+
+// Log-linear latency histogram: 16 sub-buckets per power of two, so a
+// reported percentile is within ~6% of the true value.
+class Histogram {
+   public:
+    static constexpr int SUB = 16;
+
+    void add(std::uint64_t ns) {
+        ++buckets_[index_(ns)];
+        ++count_;
+    }
+
+    void merge(const Histogram &other) {
+        for (std::size_t i = 0; i < buckets_.size(); ++i) {
+            buckets_[i] += other.buckets_[i];
+        }
+        count_ += other.count_;
+    }
+
+    std::uint64_t count() const {
+        return count_;
+    }
+
+    // Upper bound of the bucket holding the q-quantile, in ns.
+    std::uint64_t percentile(double q) const {
+        if (count_ == 0) return 0;
+        const auto rank = static_cast<std::uint64_t>(
+            std::ceil(q * static_cast<double>(count_)));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < buckets_.size(); ++i) {
+            seen += buckets_[i];
+            if (seen >= std::max<std::uint64_t>(rank, 1)) return upper_(i);
+        }
+        return upper_(buckets_.size() - 1);
+    }
+
+   private:
+    static std::size_t index_(std::uint64_t ns) {
+        if (ns < SUB) return static_cast<std::size_t>(ns);
+        const int msb = 63 - __builtin_clzll(ns);
+        const int shift = msb - 4;  // keep the top 5 bits
+        return static_cast<std::size_t>((shift + 1) * SUB) +
+               static_cast<std::size_t>((ns >> shift) - SUB);
+    }
+    static std::uint64_t upper_(std::size_t i) {
+        if (i < SUB) return i;
+        const int shift = static_cast<int>(i / SUB) - 1;
+        const std::uint64_t mantissa = SUB + i % SUB;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    std::array<std::uint64_t, 64 * SUB> buckets_{};
+    std::uint64_t count_ = 0;
+};
+
+// Zipfian ranks over [0, n) (Gray et al., "Quickly generating billion-
+// record synthetic databases"); rank 0 is the hottest. theta in (0, 1).
+class Zipf {
+   public:
+    Zipf(std::uint64_t n, double theta)
+        : n_(n),
+          theta_(theta),
+          zetan_(zeta_(n, theta)),
+          alpha_(1.0 / (1.0 - theta)),
+          eta_((1.0 - std::pow(2.0 / static_cast<double>(n), 1.0 - theta)) /
+               (1.0 - zeta_(2, theta) / zetan_)) {}
+
+    template <typename Rng>
+    std::uint64_t operator()(Rng &rng) const {
+        const double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        const double uz = u * zetan_;
+        if (uz < 1.0) return 0;
+        if (n_ > 1 && uz < 1.0 + std::pow(0.5, theta_)) return 1;
+        const auto r = static_cast<std::uint64_t>(
+            static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+        return std::min(r, n_ - 1);
+    }
+
+   private:
+    static double zeta_(std::uint64_t n, double theta) {
+        double sum = 0;
+        for (std::uint64_t i = 1; i <= n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i), theta);
+        }
+        return sum;
+    }
+
+    std::uint64_t n_;
+    double theta_, zetan_, alpha_, eta_;
+};
+
+// Picks page ids or slots according to --dist.
+class Picker {
+   public:
+    Picker(std::uint64_t n, bool zipf, double theta)
+        : n_(n), zipf_(zipf ? std::make_unique<Zipf>(n, theta) : nullptr) {}
+
+    template <typename Rng>
+    std::uint64_t operator()(Rng &rng) const {
+        if (zipf_) return (*zipf_)(rng);
+        return std::uniform_int_distribution<std::uint64_t>(0, n_ - 1)(rng);
+    }
+
+   private:
+    std::uint64_t n_;
+    std::unique_ptr<Zipf> zipf_;
+};
+
+std::string make_record(std::uint64_t key, std::uint64_t version,
+                        std::size_t size) {
+    std::string rec(size, '\0');
+    std::memcpy(rec.data(), &key, 8);
+    std::memcpy(rec.data() + 8, &version, 8);
+    const std::uint64_t seed = mix64(key ^ (version * 0x9e3779b97f4a7c15ULL));
+    for (std::size_t i = HEADER; i < size; ++i) {
+        rec[i] = static_cast<char>(seed >> (8 * (i % 8)));
+    }
+    return rec;
+}
+
+bool record_ok(const std::string &rec, std::size_t size) {
+    if (rec.size() != size) return false;
+    std::uint64_t key = 0, version = 0;
+    std::memcpy(&key, rec.data(), 8);
+    std::memcpy(&version, rec.data() + 8, 8);
+    return rec == make_record(key, version, size);
+}
+
+std::uint64_t record_key(const std::string &rec) {
+    std::uint64_t key = 0;
+    std::memcpy(&key, rec.data(), 8);
+    return key;
+}
+
+struct ThreadStats {
+    Histogram latency[NUM_OPS];
+    std::uint64_t failed[NUM_OPS] = {};
+    std::uint64_t corrupt = 0;
+    std::uint64_t inserted = 0;  // keys (t << THREAD_SHIFT) | [0, inserted)
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    srd::bench::quiet_logs();
+    const Flags flags(argc, argv);
+    const std::size_t threads =
+        flags.get_u64("threads", std::thread::hardware_concurrency());
+    const double seconds = flags.get_double("seconds", 3.0);
+    const std::uint64_t ops_per_thread = flags.get_u64("ops", 0);
+    const std::uint64_t num_pages =
+        std::max<std::uint64_t>(flags.get_u64("pages", 1024), 1);
+    const double fill = flags.get_double("fill", 0.7);
+    const std::size_t record_bytes =
+        std::max<std::uint64_t>(flags.get_u64("record_bytes", 64), HEADER);
+    const bool zipf = flags.get("dist", "uniform") == "zipf";
+    const double theta = flags.get_double("theta", 0.99);
+    const std::string dir = flags.get("dir", ".");
+    const std::uint64_t weights[NUM_OPS] = {
+        flags.get_u64("read", 60), flags.get_u64("update", 20),
+        flags.get_u64("insert", 10), flags.get_u64("delete", 5),
+        flags.get_u64("flush", 5)};
+    std::uint64_t total_weight = 0;
+    for (auto w : weights) total_weight += w;
+    if (total_weight == 0 || threads == 0) {
+        std::fprintf(stderr, "need threads > 0 and a non-empty op mix\n");
+        return 2;
+    }
+
+    // How many records fit in an empty page sets the fill target.
+    std::size_t per_page = 0;
+    {
+        SlottedPage probe;
+        std::size_t slot = 0;
+        const std::string rec = make_record(0, 0, record_bytes);
+        while (probe.addRecord(rec, slot)) ++per_page;
+    }
+    const auto initial_per_page = static_cast<std::size_t>(
+        std::clamp(fill, 0.0, 1.0) * static_cast<double>(per_page));
+
+    const std::string path = srd::bench::scratch_path(dir, "stress");
+    StorageManager sm(path);
+    sm.extend_to(num_pages - 1);
+    std::vector<std::unique_ptr<SlottedPage>> pages;
+    pages.reserve(num_pages);
+    std::uint64_t initial_keys = 0;
+    const std::uint64_t loader_key = std::uint64_t{threads} << THREAD_SHIFT;
+    for (std::uint64_t p = 0; p < num_pages; ++p) {
+        auto page = std::make_unique<SlottedPage>();
+        std::size_t slot = 0;
+        for (std::size_t i = 0; i < initial_per_page; ++i) {
+            page->addRecord(
+                make_record(loader_key | initial_keys++, 0, record_bytes),
+                slot);
+        }
+        pages.push_back(std::move(page));
+    }
+
+    const Picker page_pick(num_pages, zipf, theta);
+    const Picker slot_pick(MAX_SLOTS, zipf, theta);
+    std::vector<ThreadStats> stats(threads);
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> pool;
+    const Timer timer;
+    for (std::size_t t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            ThreadStats &st = stats[t];
+            std::mt19937_64 rng(0x5eed + t);
+            std::uniform_int_distribution<std::uint64_t> mix(0,
+                                                             total_weight - 1);
+            std::string rec;
+            std::size_t slot = 0;
+            for (std::uint64_t n = 0;; ++n) {
+                if (ops_per_thread ? n >= ops_per_thread
+                                   : stop.load(std::memory_order_relaxed)) {
+                    break;
+                }
+                std::uint64_t pick = mix(rng);
+                int op = 0;
+                while (pick >= weights[op]) pick -= weights[op++];
+                const std::uint64_t pid = page_pick(rng);
+                const std::size_t sid = slot_pick(rng);
+                SlottedPage &page = *pages[pid];
+
+                const auto start = std::chrono::steady_clock::now();
+                bool ok = true;
+                switch (op) {
+                    case READ:
+                        ok = page.getRecord(sid, rec);
+                        if (ok && !record_ok(rec, record_bytes)) ++st.corrupt;
+                        break;
+                    case UPDATE: {
+                        ok = page.getRecord(sid, rec);
+                        if (!ok) break;
+                        std::uint64_t version = 0;
+                        std::memcpy(&version, rec.data() + 8, 8);
+                        ok = page.updateRecord(
+                            sid, make_record(record_key(rec), version + 1,
+                                             record_bytes));
+                        break;
+                    }
+                    case INSERT: {
+                        const std::uint64_t key =
+                            (std::uint64_t{t} << THREAD_SHIFT) | st.inserted;
+                        ok = page.addRecord(
+                            make_record(key, 0, record_bytes), slot);
+                        if (ok) ++st.inserted;
+                        break;
+                    }
+                    case DELETE:
+                        ok = page.deleteTuple(sid);
+                        break;
+                    case FLUSH:
+                        sm.flush(pid, page);
+                        break;
+                }
+                const auto ns = std::chrono::duration_cast<
+                    std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start);
+                st.latency[op].add(static_cast<std::uint64_t>(ns.count()));
+                if (!ok) ++st.failed[op];
+            }
+        });
+    }
+    if (ops_per_thread == 0) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        stop = true;
+    }
+    for (auto &th : pool) th.join();
+    const double secs = timer.seconds();
+
+    // ---- report ----
+    Histogram all;
+    std::uint64_t corrupt_reads = 0;
+    char dist[32] = "uniform";
+    if (zipf) std::snprintf(dist, sizeof(dist), "zipf theta=%.2f", theta);
+    std::printf("threads=%zu pages=%llu fill=%.2f (%zu/%zu records) "
+                "record=%zu B dist=%s\n",
+                threads, static_cast<unsigned long long>(num_pages), fill,
+                initial_per_page, per_page, record_bytes, dist);
+    for (int op = 0; op < NUM_OPS; ++op) {
+        Histogram h;
+        std::uint64_t failed = 0;
+        for (const auto &st : stats) {
+            h.merge(st.latency[op]);
+            failed += st.failed[op];
+        }
+        all.merge(h);
+        if (h.count() == 0) continue;
+        std::printf("%-7s ops=%-10llu miss=%-9llu p50=%llu ns p99=%llu ns "
+                    "p999=%llu ns\n",
+                    OP_NAMES[op], static_cast<unsigned long long>(h.count()),
+                    static_cast<unsigned long long>(failed),
+                    static_cast<unsigned long long>(h.percentile(0.5)),
+                    static_cast<unsigned long long>(h.percentile(0.99)),
+                    static_cast<unsigned long long>(h.percentile(0.999)));
+    }
+    for (const auto &st : stats) corrupt_reads += st.corrupt;
+    std::printf("total   ops=%llu in %.3f s: %.0f ops/s, p50=%llu ns "
+                "p99=%llu ns p999=%llu ns\n",
+                static_cast<unsigned long long>(all.count()), secs,
+                static_cast<double>(all.count()) / secs,
+                static_cast<unsigned long long>(all.percentile(0.5)),
+                static_cast<unsigned long long>(all.percentile(0.99)),
+                static_cast<unsigned long long>(all.percentile(0.999)));
+
+    // ---- integrity ----
+    std::uint64_t live = 0, bad = 0, dup = 0, unknown = 0;
+    std::unordered_set<std::uint64_t> keys;
+    std::string rec;
+    for (const auto &page : pages) {
+        for (std::size_t s = 0; s < MAX_SLOTS; ++s) {
+            if (!page->getRecord(s, rec)) continue;
+            ++live;
+            if (!record_ok(rec, record_bytes)) {
+                ++bad;
+                continue;
+            }
+            const std::uint64_t key = record_key(rec);
+            if (!keys.insert(key).second) ++dup;
+            const std::uint64_t owner = key >> THREAD_SHIFT;
+            const std::uint64_t seq = key & ((1ULL << THREAD_SHIFT) - 1);
+            if (owner > threads) {
+                ++unknown;
+                continue;
+            }
+            const std::uint64_t written =
+                owner == threads ? initial_keys : stats[owner].inserted;
+            if (seq >= written) ++unknown;
+        }
+    }
+
+    std::vector<std::pair<std::uint64_t, const SlottedPage *>> dirty;
+    for (std::uint64_t p = 0; p < num_pages; ++p) {
+        dirty.emplace_back(p, pages[p].get());
+    }
+    sm.flush_pages(std::move(dirty));
+    std::uint64_t mismatched_pages = 0;
+    const auto on_disk = sm.load_range(0, num_pages);
+    for (std::uint64_t p = 0; p < num_pages; ++p) {
+        if (std::memcmp(on_disk[p]->raw_data(), pages[p]->raw_data(),
+                        PAGE_SIZE) != 0) {
+            ++mismatched_pages;
+        }
+    }
+
+    const bool ok = corrupt_reads == 0 && bad == 0 && dup == 0 &&
+                    unknown == 0 && mismatched_pages == 0;
+    std::printf("integrity: live=%llu corrupt_reads=%llu bad=%llu dup=%llu "
+                "unknown=%llu disk_mismatch=%llu verified=%s\n",
+                static_cast<unsigned long long>(live),
+                static_cast<unsigned long long>(corrupt_reads),
+                static_cast<unsigned long long>(bad),
+                static_cast<unsigned long long>(dup),
+                static_cast<unsigned long long>(unknown),
+                static_cast<unsigned long long>(mismatched_pages),
+                ok ? "yes" : "NO");
+
+    pages.clear();
+    std::filesystem::remove(path);
+    return ok ? 0 : 1;
+}
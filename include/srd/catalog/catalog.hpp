@@ -0,0 +1,120 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "srd/record/field.hpp"
+#include "srd/storage/storage_manager.hpp"
+
+namespace srd::catalog {
+
+struct ColumnDef {
+    std::string name;
+    record::FieldType type = record::FieldType::INT;
+};
+
+// Secondary structure hanging off a table (zone map, Bloom index, ...).
+struct IndexDef {
+    std::string name;
+    std::string kind;
+    std::uint32_t column = 0;
+    std::uint64_t root_page = 0;
+};
+
+// Just enough about free space to pick an insert target without reading
+// the table: how big it is, how much room is left and where the first
+// page with room is.
+struct FreeSpaceSummary {
+    std::uint64_t pages = 0;
+    std::uint64_t free_bytes = 0;
+    std::uint64_t first_free_page = 0;
+};
+
+struct TableDef {
+    std::string name;
+    // Data file of the table; its first data page is root_page.
+    std::string path;
+    std::vector<ColumnDef> schema;
+    std::uint64_t root_page = 0;
+    FreeSpaceSummary free_space;
+    std::vector<IndexDef> indexes;
+};
+
+// Database metadata kept in the pages of a dedicated file, so opening a
+// database costs a few page reads instead of a scan of the data:
+//
+//   page 0, 1   superblock, written alternately (double write). Each copy
+//               carries a generation and a CRC; open picks the newest
+//               valid one, so a torn superblock write loses at most the
+//               commit in progress.
+//   page 2..    catalog blob (all table definitions). A commit writes the
+//               new blob into pages the current superblock does not
+//               reference (shadow write), syncs, then publishes it by
+//               writing the next superblock copy and syncing again.
+//
+// Changes made through create_table / update_table / drop_table stay in
+// memory until commit(). Not thread-safe; callers serialize access.
+class Catalog {
+   public:
+    // Opens the catalog in 'sm', formatting an empty file (one blank page,
+    // as StorageManager creates it). Throws std::runtime_error if the file
+    // has data but no valid superblock, or the catalog blob is corrupt.
+    explicit Catalog(storage::StorageManager &sm);
+
+    Catalog(const Catalog &) = delete;
+    Catalog &operator=(const Catalog &) = delete;
+
+    // Generation of the last committed superblock; starts at 1.
+    std::uint64_t generation() const noexcept {
+        return current_.generation;
+    }
+
+    // nullptr if there is no such table.
+    const TableDef *find(std::string_view name) const;
+    std::vector<std::string> table_names() const;
+    std::size_t num_tables() const noexcept {
+        return tables_.size();
+    }
+
+    // Throws std::runtime_error if the table already exists.
+    void create_table(TableDef table);
+    // Replace a table's definition. Throws std::out_of_range if missing.
+    void update_table(TableDef table);
+    // Throws std::out_of_range if missing.
+    void drop_table(std::string_view name);
+
+    // Whether there are changes not yet committed.
+    bool dirty() const noexcept {
+        return dirty_;
+    }
+
+    // Persist all changes atomically: after a crash the catalog is either
+    // entirely the old or entirely the new one.
+    void commit();
+
+   private:
+    struct Superblock {
+        std::uint64_t generation = 0;
+        std::uint64_t catalog_first = 0;
+        std::uint64_t catalog_pages = 0;
+        std::uint64_t catalog_bytes = 0;
+        std::uint32_t catalog_crc = 0;
+        // Extent of the previous blob, reused by the next commit.
+        std::uint64_t spare_first = 0;
+        std::uint64_t spare_pages = 0;
+    };
+
+    bool read_superblock_(std::uint64_t page_id, Superblock &sb);
+    void write_superblock_(const Superblock &sb);
+    void load_catalog_(const Superblock &sb);
+    void write_pages_(std::uint64_t first, const std::string &bytes);
+
+    storage::StorageManager &sm_;
+    Superblock current_;
+    std::map<std::string, TableDef, std::less<>> tables_;
+    bool dirty_ = false;
+};
+
+}  // namespace srd::catalog
@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SRD_CRC32C_X86 1
+#endif
+
+namespace srd::common {
+
+namespace detail {
+
+// Byte-at-a-time table for the Castagnoli polynomial (reflected).
+inline constexpr std::array<uint32_t, 256> CRC32C_TABLE = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? (c >> 1) ^ 0x82f63b78U : c >> 1;
+        }
+        table[i] = c;
+    }
+    return table;
+}();
+
+inline uint32_t crc32c_table(const unsigned char *p, std::size_t len,
+                             uint32_t crc) {
+    for (std::size_t i = 0; i < len; ++i) {
+        crc = CRC32C_TABLE[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(SRD_CRC32C_X86)
+// SSE4.2 has a CRC-32C instruction; eight bytes per step.
+__attribute__((target("sse4.2"))) inline uint32_t crc32c_sse42(
+    const unsigned char *p, std::size_t len, uint32_t crc) {
+    uint64_t c = crc;
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        c = __builtin_ia32_crc32di(c, v);
+    }
+    auto c32 = static_cast<uint32_t>(c);
+    for (; len > 0; ++p, --len) c32 = __builtin_ia32_crc32qi(c32, *p);
+    return c32;
+}
+#endif
+
+}  // namespace detail
+
+// CRC-32C of a byte range. Unlike hash_bytes its output is fixed forever,
+// so it is what on-disk structures use to detect torn or corrupt writes.
+// Pass a previous result as 'crc' to checksum data in pieces.
+inline uint32_t crc32c(const void *data, std::size_t len, uint32_t crc = 0) {
+    const auto *p = static_cast<const unsigned char *>(data);
+#if defined(SRD_CRC32C_X86)
+    static const bool hw = __builtin_cpu_supports("sse4.2");
+    if (hw) return ~detail::crc32c_sse42(p, len, ~crc);
+#endif
+    return ~detail::crc32c_table(p, len, ~crc);
+}
+
+}  // namespace srd::common
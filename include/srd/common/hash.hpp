@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace srd::common {
+
+// 64-bit finalizer from MurmurHash3: spreads every input bit over the word.
+inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Bumped whenever hash_bytes/mix64 change their output. Anything persisted
+// that depends on hash values (Bloom filter bits) records it and is
+// rebuilt on mismatch.
+inline constexpr uint32_t HASH_VERSION = 1;
+
+// Fast non-cryptographic hash of a byte range, 8 bytes per step. Good
+// enough to drive radix partitioning, open addressing and Bloom filters;
+// not stable across HASH_VERSIONs, so never persist raw hash values
+// without it.
+inline uint64_t hash_bytes(const void *data, std::size_t len,
+                           uint64_t seed = 0) {
+    const auto *p = static_cast<const unsigned char *>(data);
+    uint64_t h = seed ^ (len * 0x9e3779b97f4a7c15ULL);
+    while (len >= 8) {
+        uint64_t w = 0;
+        std::memcpy(&w, p, 8);
+        h = mix64(h ^ w) * 0x9e3779b97f4a7c15ULL;
+        p += 8;
+        len -= 8;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, p, len);
+    return mix64(h ^ tail ^ (uint64_t{len} << 56));
+}
+
+}  // namespace srd::common
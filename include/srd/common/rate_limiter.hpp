@@ -0,0 +1,39 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace srd::common {
+
+// Paces a background I/O loop to a byte rate. Each acquire() books its
+// bytes on a virtual clock and sleeps until the clock says they may go, so
+// the long-run rate never exceeds bytes_per_sec; up to 'burst' of idle
+// time can be caught up on at once. A rate of 0 disables the limit. Not
+// thread-safe: meant to be owned by the one thread doing the I/O.
+class RateLimiter {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RateLimiter(std::uint64_t bytes_per_sec,
+                         std::chrono::milliseconds burst =
+                             std::chrono::milliseconds(50))
+        : bytes_per_sec_(bytes_per_sec), burst_(burst), next_(Clock::now()) {}
+
+    void acquire(std::uint64_t bytes) {
+        if (bytes_per_sec_ == 0 || bytes == 0) return;
+        const auto now = Clock::now();
+        next_ = std::max(next_, now - burst_);
+        next_ += std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(bytes) /
+                                          static_cast<double>(bytes_per_sec_)));
+        if (next_ > now) std::this_thread::sleep_until(next_);
+    }
+
+   private:
+    std::uint64_t bytes_per_sec_;
+    Clock::duration burst_;
+    Clock::time_point next_;
+};
+
+}  // namespace srd::common
@@ -0,0 +1,18 @@
+#pragma once
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace srd::common {
+
+// Unique name for a scratch file in 'dir' (spill files, sorted runs).
+// Unique across threads and processes; the caller removes the file.
+inline std::string temp_path(const std::string &dir, const char *tag) {
+    static std::atomic<uint64_t> counter{0};
+    return dir + "/srd_" + tag + "_" + std::to_string(::getpid()) + "_" +
+           std::to_string(counter.fetch_add(1)) + ".tmp";
+}
+
+}  // namespace srd::common
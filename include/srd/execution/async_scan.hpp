@@ -0,0 +1,105 @@
+#pragma once
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "srd/execution/scheduler.hpp"
+#include "srd/execution/task.hpp"
+#include "srd/storage/storage_manager.hpp"
+
+namespace srd::execution {
+
+using PageBatch = std::vector<std::unique_ptr<storage::SlottedPage>>;
+
+// co_await load_pages_async(...) reads pages [first, first + count) on the
+// scheduler's I/O pool and resumes on a worker with them.
+inline auto load_pages_async(Scheduler &s, storage::StorageManager &sm,
+                             std::uint64_t first, std::size_t count) {
+    return s.offload(
+        [&sm, first, count] { return sm.load_range(first, count); });
+}
+
+// Ordered stream of page batches over [first, end) that keeps up to
+// 'prefetch' batches of 'batch_pages' pages in flight on the I/O pool, so
+// the consumer's work on one batch overlaps the reads of the next ones.
+//
+//     PageStream stream(sched, sm);
+//     for (;;) {
+//         PageBatch batch = co_await stream.next();
+//         if (batch.empty()) break;
+//         ...
+//     }
+//
+// One consumer at a time. The destructor waits for reads still in flight,
+// so 'sm' must outlive the stream.
+class PageStream {
+   public:
+    // end == 0 means sm.num_pages() at construction.
+    PageStream(Scheduler &s, storage::StorageManager &sm,
+               std::uint64_t first = 0, std::uint64_t end = 0,
+               std::size_t batch_pages = 8, std::size_t prefetch = 4);
+    ~PageStream();
+
+    PageStream(const PageStream &) = delete;
+    PageStream &operator=(const PageStream &) = delete;
+
+    // Awaitable yielding the next batch in page order; empty at the end.
+    // Page ids of a batch start at page_id().
+    auto next() {
+        struct Awaiter {
+            PageStream &stream;
+            bool await_ready() {
+                return stream.front_ready_();
+            }
+            bool await_suspend(std::coroutine_handle<> h) {
+                return stream.park_(h);
+            }
+            PageBatch await_resume() {
+                return stream.pop_();
+            }
+        };
+        return Awaiter{*this};
+    }
+
+    // First page id of the batch last returned by next().
+    std::uint64_t page_id() const noexcept {
+        return current_;
+    }
+
+    // Convenience: the records of the next batch (copied out of the
+    // pages); false at the end of the stream.
+    Task<bool> next_records(std::vector<std::string> &out);
+
+   private:
+    struct Load {
+        std::uint64_t first = 0;
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool ready = false;
+        PageBatch pages;
+        std::exception_ptr error;
+        std::coroutine_handle<> waiter;
+    };
+
+    void issue_();
+    bool front_ready_();
+    bool park_(std::coroutine_handle<> h);
+    PageBatch pop_();
+
+    Scheduler &s_;
+    storage::StorageManager &sm_;
+    std::uint64_t next_page_;
+    std::uint64_t end_;
+    std::size_t batch_pages_;
+    std::size_t prefetch_;
+    std::uint64_t current_ = 0;
+    std::deque<std::shared_ptr<Load>> inflight_;
+};
+
+}  // namespace srd::execution
@@ -0,0 +1,171 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "srd/record/field.hpp"
+
+namespace srd::execution {
+
+enum class ExprOp : uint8_t {
+    COLUMN,
+    CONSTANT,
+    ADD,
+    SUB,
+    MUL,
+    EQ,
+    NE,
+    LT,
+    LE,
+    GT,
+    GE,
+    AND,
+    OR,
+    NOT
+};
+
+// Value type of an expression. INT and FLOAT columns widen to 64 bits, so
+// arithmetic on them neither overflows (INT wraps) nor loses precision
+// early; comparisons and AND/OR/NOT yield BOOL.
+enum class ExprType : uint8_t { BOOL, INT, FLOAT, STRING };
+
+// Immutable expression tree over the fields of one record: column refs,
+// constants, + - *, comparisons and AND/OR/NOT. Copies share nodes. Built
+// with the static factories, e.g.
+//
+//   auto pred = Expr::logical_and(
+//       Expr::lt(Expr::column(2, FieldType::INT), Expr::constant(100)),
+//       Expr::eq(Expr::column(0, FieldType::STRING), Expr::constant("EU")));
+//
+// Types are checked when the tree is built: arithmetic takes INT/FLOAT
+// (mixing them gives FLOAT), ordering compares two numbers or two strings,
+// AND/OR/NOT take BOOL. A mismatch throws std::runtime_error.
+class Expr {
+   public:
+    // Field 'index' of the record, expected to hold 'type'.
+    static Expr column(std::size_t index, record::FieldType type);
+    static Expr constant(int value);
+    static Expr constant(std::int64_t value);
+    static Expr constant(double value);
+    static Expr constant(std::string value);
+    static Expr constant(const char *value) {
+        return constant(std::string(value));
+    }
+    static Expr constant(bool value);
+
+    static Expr add(Expr a, Expr b);
+    static Expr sub(Expr a, Expr b);
+    static Expr mul(Expr a, Expr b);
+    static Expr eq(Expr a, Expr b);
+    static Expr ne(Expr a, Expr b);
+    static Expr lt(Expr a, Expr b);
+    static Expr le(Expr a, Expr b);
+    static Expr gt(Expr a, Expr b);
+    static Expr ge(Expr a, Expr b);
+    static Expr logical_and(Expr a, Expr b);
+    static Expr logical_or(Expr a, Expr b);
+    static Expr logical_not(Expr a);
+
+    ExprOp op() const noexcept {
+        return node_->op;
+    }
+    ExprType type() const noexcept {
+        return node_->type;
+    }
+    // Operands; the second is only set for binary ops.
+    const Expr &left() const;
+    const Expr &right() const;
+
+    // COLUMN: field index and the field type it expects.
+    std::size_t column_index() const noexcept {
+        return node_->column;
+    }
+    record::FieldType column_type() const noexcept {
+        return node_->field_type;
+    }
+
+    // CONSTANT: the value matching type() (BOOL is stored in int_value).
+    std::int64_t int_value() const noexcept {
+        return node_->int_value;
+    }
+    double float_value() const noexcept {
+        return node_->float_value;
+    }
+    const std::string &string_value() const noexcept {
+        return node_->string_value;
+    }
+
+   private:
+    struct Node {
+        ExprOp op = ExprOp::CONSTANT;
+        ExprType type = ExprType::BOOL;
+        std::size_t column = 0;
+        record::FieldType field_type = record::FieldType::INT;
+        std::int64_t int_value = 0;
+        double float_value = 0.0;
+        std::string string_value;
+        std::vector<Expr> args;
+    };
+
+    explicit Expr(std::shared_ptr<const Node> node) : node_(std::move(node)) {}
+    static Expr binary(ExprOp op, Expr a, Expr b);
+
+    std::shared_ptr<const Node> node_;
+};
+
+// Values of an expression over a batch of rows, in the vector matching
+// 'type' (BOOL in 'bools' as 0/1). valid[i] is 0 where row i lacks a
+// column the expression reads, or holds another type there; the value of
+// such a row is unspecified. String values view the input records.
+struct ExprColumn {
+    ExprType type = ExprType::BOOL;
+    std::vector<uint8_t> valid;
+    std::vector<uint8_t> bools;
+    std::vector<std::int64_t> ints;
+    std::vector<double> floats;
+    std::vector<std::string_view> strings;
+};
+
+// An Expr compiled once for evaluation over many rows. Constant subtrees
+// are folded and the rest is lowered into a flat list of steps, each a
+// kernel instantiated for its exact operand types and for whether each
+// operand is a column vector or a constant. Rows are processed in batches:
+// the referenced fields of every row are decoded into typed column arrays
+// in one pass per record, then each step runs one tight, branch-free loop
+// over the batch that the compiler can vectorize.
+//
+// Thread-safe for concurrent evaluation; each call uses its own scratch.
+class CompiledExpr {
+   public:
+    explicit CompiledExpr(Expr expr);
+    ~CompiledExpr();
+    CompiledExpr(CompiledExpr &&) noexcept;
+    CompiledExpr &operator=(CompiledExpr &&) noexcept;
+
+    ExprType type() const noexcept {
+        return expr_.type();
+    }
+
+    // Evaluate over serialized tuples (Tuple::serialize layout), replacing
+    // the contents of 'out'. Malformed records throw std::runtime_error.
+    void evaluate(std::span<const std::string_view> rows,
+                  ExprColumn &out) const;
+
+    // BOOL expressions only: append to 'selected' the indexes of the rows
+    // that are valid and true. Returns how many were appended.
+    std::size_t filter(std::span<const std::string_view> rows,
+                       std::vector<uint32_t> &selected) const;
+
+   private:
+    struct Program;
+
+    Expr expr_;
+    std::unique_ptr<Program> program_;
+};
+
+}  // namespace srd::execution
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "srd/record/key_encoder.hpp"
+#include "srd/storage/storage_manager.hpp"
+
+namespace srd::execution {
+
+struct ExternalSortOptions {
+    // Sort key columns, most significant first, each ASC or DESC; records
+    // are ordered by their record::KeyEncoder keys. Within a column, tuples
+    // without it sort first, then INT < FLOAT < STRING by type, then by
+    // value (DESC reverses all of that).
+    std::vector<record::KeyColumn> keys;
+    // Single ascending sort column, used when 'keys' is empty.
+    std::size_t column = 0;
+    // Record bytes plus sort entries held in memory at once, split evenly
+    // between the run-generation threads, each of which holds at most 4 GiB
+    // (UINT32_MAX bytes) before spilling a run. Also bounds merge
+    // read-ahead.
+    std::size_t memory_budget = std::size_t{64} << 20;
+    // Run-generation threads; 0 means std::thread::hardware_concurrency().
+    std::size_t threads = 0;
+    // Directory for the temporary run files (removed when done, also when
+    // the sort throws).
+    std::string temp_dir = ".";
+    // Pages per load_range when reading the input and each run.
+    std::size_t read_ahead_pages = 8;
+    // Most runs merged in one pass; also capped by what fits the budget.
+    std::size_t max_fan_in = 64;
+};
+
+struct ExternalSortStats {
+    std::uint64_t records = 0;
+    std::size_t initial_runs = 0;
+    std::size_t merge_passes = 0;
+    std::uint64_t output_pages = 0;
+};
+
+// External merge sort over the records of a StorageManager file.
+// 1. Run generation: each thread scans a contiguous share of the input
+//    pages, copies normalized keys and records into an arena and sorts
+//    small (key prefix, offset) entries rather than Tuple objects; ties on
+//    the prefix are settled by one memcmp of the full keys. A full arena
+//    is spilled as a sorted run to its own temporary page file.
+// 2. Merge: runs are merged with a loser tree, each run read ahead
+//    read_ahead_pages at a time. Extra passes happen only when there are
+//    more runs than the fan-in.
+class ExternalSort {
+   public:
+    explicit ExternalSort(ExternalSortOptions options = {});
+
+    // Write every record of 'input' to 'output' in key order, starting at
+    // output page 0; use a new or empty output file, since pages past
+    // stats.output_pages are left as they were. 'input' and 'output' must
+    // be different files.
+    ExternalSortStats sort(storage::StorageManager &input,
+                           storage::StorageManager &output);
+
+   private:
+    ExternalSortOptions options_;
+};
+
+}  // namespace srd::execution
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "srd/record/tuple_view.hpp"
+#include "srd/storage/storage_manager.hpp"
+
+namespace srd::execution {
+
+enum class AggregateOp : uint8_t { COUNT = 0, SUM = 1, MIN = 2, MAX = 3 };
+
+struct AggregateSpec {
+    AggregateOp op = AggregateOp::COUNT;
+    // Input column; ignored by COUNT, which counts rows.
+    std::size_t column = 0;
+};
+
+// Result of one aggregate for one group. SUM/MIN/MAX fold INT and FLOAT
+// values separately (a column normally holds only one of them); STRING
+// values and rows missing the column are ignored.
+struct AggregateValue {
+    // COUNT: rows in the group.
+    uint64_t count = 0;
+    // INT values seen and their sum/min/max (as int64).
+    uint64_t int_count = 0;
+    int64_t int_value = 0;
+    // FLOAT values seen and their sum/min/max (as double).
+    uint64_t float_count = 0;
+    double float_value = 0.0;
+};
+
+struct HashAggregateOptions {
+    // Grouping columns. Rows missing any of them are skipped.
+    std::vector<std::size_t> group_by;
+    std::vector<AggregateSpec> aggregates;
+    // Bytes of partial aggregates buffered between the two phases; beyond
+    // this, workers spill partials to per-partition temporary files. In
+    // phase 2 each merging thread keeps a table of at most
+    // memory_budget / threads bytes (16 KiB at least).
+    std::size_t memory_budget = std::size_t{64} << 20;
+    // Groups held by each worker's pre-aggregation table before it is
+    // flushed; small enough to stay in cache.
+    std::size_t local_groups = 1024;
+    // Global partitions (rounded up to a power of two), merged in parallel.
+    std::size_t partitions = 64;
+    // 0 means hardware_concurrency().
+    std::size_t threads = 0;
+    std::string temp_dir = ".";
+    std::size_t read_ahead_pages = 8;
+};
+
+struct HashAggregateStats {
+    std::uint64_t records = 0;
+    std::uint64_t skipped_records = 0;
+    std::uint64_t groups = 0;
+    // Partial groups flushed out of the pre-aggregation tables.
+    std::uint64_t partials = 0;
+    bool spilled = false;
+    // Phase-2 merges that outgrew their memory share and were split into
+    // sub-partitions on disk.
+    std::uint64_t respills = 0;
+};
+
+// Called once per group on the thread that called run(). 'group' views a
+// serialized tuple of the group-by fields; 'values' follows the order of
+// HashAggregateOptions::aggregates. Both are valid only during the call.
+using AggregateCallback = std::function<void(
+    const record::TupleView &group, std::span<const AggregateValue> values)>;
+
+// Two-phase parallel hash aggregation (GROUP BY ... COUNT/SUM/MIN/MAX).
+// 1. Workers scan page shares and pre-aggregate into a small thread-local
+//    table: each row's group is found by a hash-table probe, and the
+//    accumulators are updated batch-at-a-time, one scatter loop per
+//    aggregate. A full table is flushed as partial groups into hash
+//    partitions.
+// 2. Partitions are merged into global tables in parallel, one worker per
+//    partition, including partials spilled to disk under memory pressure.
+//    A table that outgrows its share of the budget is split on disk into
+//    sub-partitions, which are merged in turn.
+class HashAggregate {
+   public:
+    explicit HashAggregate(HashAggregateOptions options);
+
+    HashAggregateStats run(storage::StorageManager &input,
+                           const AggregateCallback &emit);
+
+   private:
+    HashAggregateOptions options_;
+};
+
+}  // namespace srd::execution
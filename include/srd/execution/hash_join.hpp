@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "srd/record/tuple_view.hpp"
+#include "srd/storage/storage_manager.hpp"
+
+namespace srd::execution {
+
+struct HashJoinOptions {
+    // Equi-join build.field(build_column) == probe.field(probe_column).
+    // Keys match only if type and value are equal (INT 3 != FLOAT 3.0);
+    // tuples missing the column never match.
+    std::size_t build_column = 0;
+    std::size_t probe_column = 0;
+    // Build-side bytes held in memory at once. Larger build inputs are
+    // joined Grace-style: both sides are partitioned to temporary files and
+    // joined one partition pair at a time.
+    std::size_t memory_budget = std::size_t{64} << 20;
+    // Most spill files one partitioning pass opens; also kept within half
+    // of RLIMIT_NOFILE. Pairs still over budget are partitioned again.
+    std::size_t max_spill_files = 256;
+    // Target build bytes per radix partition when everything fits in
+    // memory, so each partition's table stays cache-resident.
+    std::size_t partition_bytes = std::size_t{256} << 10;
+    // Partitioning/build threads; 0 means hardware_concurrency().
+    std::size_t threads = 0;
+    std::string temp_dir = ".";
+    std::size_t read_ahead_pages = 8;
+};
+
+struct HashJoinStats {
+    std::uint64_t build_records = 0;
+    std::uint64_t probe_records = 0;
+    std::uint64_t matches = 0;
+    std::size_t partitions = 0;
+    bool spilled = false;
+    // Spilled pairs partitioned again because their build side was over
+    // budget, and pairs hashing could not split (a hot key), which were
+    // joined in budget-sized chunks of the build side.
+    std::uint64_t repartitions = 0;
+    std::uint64_t chunked_pairs = 0;
+};
+
+// Called once per matching (build, probe) pair, always on the thread that
+// called run(). The views are only valid during the call.
+using JoinCallback = std::function<void(const record::TupleView &build,
+                                        const record::TupleView &probe)>;
+
+// Partitioned hash join of two StorageManager files.
+// 1. Partition: worker threads scan page shares of the build side and
+//    radix-partition records by key hash, into memory or, when the build
+//    side exceeds memory_budget, into per-partition spill files (the probe
+//    side is then partitioned the same way). A spilled pair that is still
+//    over budget is partitioned again on a rehashed key.
+// 2. Build: one open-addressing table (linear probing, 8-byte slots with a
+//    hash tag) per partition; in-memory partitions are built in parallel.
+// 3. Probe: probe records are hashed to their partition and looked up.
+class HashJoin {
+   public:
+    explicit HashJoin(HashJoinOptions options = {});
+
+    HashJoinStats run(storage::StorageManager &build,
+                      storage::StorageManager &probe,
+                      const JoinCallback &emit);
+
+   private:
+    HashJoinOptions options_;
+};
+
+}  // namespace srd::execution
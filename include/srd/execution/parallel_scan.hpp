@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+#include "srd/storage/storage_manager.hpp"
+
+namespace srd::execution {
+
+// Worker count for an operator: 'requested', or hardware_concurrency() if
+// 0, but never more than there are pages to hand out (and at least 1).
+std::size_t resolve_threads(std::size_t requested, std::uint64_t pages);
+
+// Split the pages of 'sm' into 'threads' contiguous shares and call
+// fn(worker, record) for every live record, on one thread per share.
+// 'worker' is in [0, threads); calls with the same worker never overlap,
+// so per-worker state needs no locking. If given, done(worker) runs on the
+// same thread after its share (e.g. to flush per-worker buffers). Rethrows
+// the first exception a worker hit. Returns the number of records seen.
+std::uint64_t parallel_scan(
+    storage::StorageManager &sm, std::size_t threads,
+    std::size_t read_ahead_pages,
+    const std::function<void(std::size_t, std::string_view)> &fn,
+    const std::function<void(std::size_t)> &done = {});
+
+}  // namespace srd::execution
@@ -0,0 +1,145 @@
+#pragma once
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "srd/execution/task.hpp"
+
+namespace srd::execution {
+
+// A few CPU worker threads that resume ready coroutines, plus a small pool
+// of I/O threads for blocking calls. A coroutine that needs I/O hands the
+// call to the I/O pool with offload() and suspends; its worker moves on to
+// other coroutines, and the I/O thread re-queues it when the call returns.
+// Many concurrent scans thus share a fixed set of threads, and their I/O
+// overlaps with each other's tuple processing.
+class Scheduler {
+   public:
+    // 0 workers means hardware_concurrency().
+    explicit Scheduler(std::size_t workers = 0, std::size_t io_threads = 4);
+    // Waits for every spawned task, then stops the threads.
+    ~Scheduler();
+
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    std::size_t workers() const noexcept {
+        return workers_.size();
+    }
+
+    // co_await schedule() continues the coroutine on a worker thread.
+    auto schedule() noexcept {
+        struct Awaiter {
+            Scheduler &s;
+            bool await_ready() const noexcept {
+                return false;
+            }
+            void await_suspend(std::coroutine_handle<> h) {
+                s.post(h);
+            }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    // co_await offload(fn) runs fn() on an I/O thread and continues on a
+    // worker with its result (or exception).
+    template <typename F>
+    auto offload(F fn) {
+        using R = std::invoke_result_t<F &>;
+        static_assert(!std::is_void_v<R>, "offload: fn must return a value");
+        struct Awaiter {
+            Scheduler &s;
+            F fn;
+            std::optional<R> result;
+            std::exception_ptr error;
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+            void await_suspend(std::coroutine_handle<> h) {
+                s.post_io([this, h] {
+                    try {
+                        result.emplace(fn());
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                    s.post(h);
+                });
+            }
+            R await_resume() {
+                if (error) std::rethrow_exception(error);
+                return std::move(*result);
+            }
+        };
+        return Awaiter{*this, std::move(fn), std::nullopt, nullptr};
+    }
+
+    // Start 'task' on a worker. It runs independently; an exception it
+    // throws is kept and rethrown by wait_idle().
+    void spawn(Task<void> task);
+
+    // Run 'task' on the workers and block the calling thread (which must
+    // not be a worker) until it finishes; returns its value or rethrows.
+    template <typename T>
+    T block_on(Task<T> task) {
+        std::promise<T> done;
+        auto result = done.get_future();
+        drive_(*this, std::move(task), std::move(done));
+        return result.get();
+    }
+
+    // Block until every spawned task has finished; rethrows the first
+    // exception one of them threw.
+    void wait_idle();
+
+    // Queue a coroutine to be resumed on a worker.
+    void post(std::coroutine_handle<> h);
+    // Queue a blocking job for the I/O pool.
+    void post_io(std::function<void()> job);
+
+   private:
+    template <typename T>
+    static detail::Detached drive_(Scheduler &s, Task<T> task,
+                                   std::promise<T> done) {
+        co_await s.schedule();
+        try {
+            if constexpr (std::is_void_v<T>) {
+                co_await std::move(task);
+                done.set_value();
+            } else {
+                done.set_value(co_await std::move(task));
+            }
+        } catch (...) {
+            done.set_exception(std::current_exception());
+        }
+    }
+
+    static detail::Detached run_spawned_(Scheduler &s, Task<void> task);
+    void task_done_(std::exception_ptr error);
+
+    std::mutex mutex_;
+    std::condition_variable ready_cv_;
+    std::deque<std::coroutine_handle<>> ready_;
+    std::condition_variable io_cv_;
+    std::deque<std::function<void()>> io_jobs_;
+    bool stopping_ = false;
+
+    std::condition_variable idle_cv_;
+    std::size_t spawned_ = 0;
+    std::exception_ptr error_;
+
+    std::vector<std::thread> workers_;
+    std::vector<std::thread> io_threads_;
+};
+
+}  // namespace srd::execution
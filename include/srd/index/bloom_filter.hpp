@@ -0,0 +1,233 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "srd/record/field.hpp"
+#include "srd/record/tuple_view.hpp"
+#include "srd/storage/slotted_page.hpp"
+#include "srd/storage/storage_manager.hpp"
+
+namespace srd::index {
+
+// Split-block Bloom filter. Each key maps to one 32-byte block of eight
+// 32-bit words and sets one bit per word, so a probe touches a single cache
+// line and the eight bit positions are independent lanes (one multiply and
+// shift each) that compilers turn into a handful of SIMD instructions.
+class BloomFilter {
+   public:
+    static constexpr std::size_t WORDS_PER_BLOCK = 8;
+    static constexpr std::size_t BLOCK_BYTES = WORDS_PER_BLOCK * 4;
+
+    // Sized so 'expected_keys' distinct keys give about 'fpp' false
+    // positives per lookup of an absent key.
+    BloomFilter(std::size_t expected_keys, double fpp);
+    // An empty filter of exactly 'blocks' blocks (at least 1).
+    explicit BloomFilter(std::size_t blocks);
+
+    // Fewest blocks that keep the expected false-positive rate for 'keys'
+    // keys at or below 'fpp'.
+    static std::size_t blocks_for(std::size_t keys, double fpp);
+    // Expected false-positive rate with 'keys' keys in 'blocks' blocks.
+    static double expected_fpp(std::size_t keys, std::size_t blocks);
+
+    void insert(uint64_t hash) noexcept;
+    // Same as insert() but safe against concurrent inserts.
+    void insert_concurrent(uint64_t hash) noexcept;
+    bool may_contain(uint64_t hash) const noexcept;
+
+    std::size_t num_blocks() const noexcept {
+        return blocks_;
+    }
+    std::size_t memory_bytes() const noexcept {
+        return blocks_ * BLOCK_BYTES;
+    }
+
+    // Raw words, for persistence.
+    uint32_t *data() noexcept {
+        return words_.get();
+    }
+    const uint32_t *data() const noexcept {
+        return words_.get();
+    }
+
+   private:
+    struct AlignedDeleter {
+        void operator()(uint32_t *p) const noexcept;
+    };
+
+    std::size_t block_of_(uint64_t hash) const noexcept {
+        // Multiply-shift range reduction on the high half; the low half
+        // picks the bits inside the block.
+        return static_cast<std::size_t>(((hash >> 32) * blocks_) >> 32);
+    }
+
+    std::size_t blocks_;
+    std::unique_ptr<uint32_t[], AlignedDeleter> words_;
+};
+
+// Hash of a key as BloomIndex stores it: type and value, so INT 3 and
+// FLOAT 3.0 are different keys.
+uint64_t bloom_key_hash(record::FieldType type, std::string_view payload);
+uint64_t bloom_key_hash(const record::Field &key);
+
+struct BloomOptions {
+    // Key column of the filtered tuples.
+    std::size_t column = 0;
+    // Pages covered by one filter; lookups skip whole ranges.
+    std::size_t pages_per_range = 64;
+    double fpp = 0.01;
+    // Keys a range's filter is sized for when it is created by incremental
+    // inserts rather than a bulk build().
+    std::size_t expected_keys_per_range = 64 * 32;
+};
+
+struct BloomIndexStats {
+    std::size_t ranges = 0;
+    // Bytes held by all filters.
+    std::size_t memory_bytes = 0;
+    // Keys inserted (duplicates count once per insert).
+    std::uint64_t keys = 0;
+    // Ranges whose filter holds more keys than it was sized for, so their
+    // expected false-positive rate is above BloomOptions::fpp. This only
+    // happens through attach(); build() sizes them again.
+    std::size_t overfull_ranges = 0;
+    // Highest expected false-positive rate of any range.
+    double worst_fpp = 0.0;
+};
+
+struct BloomLookupStats {
+    std::uint64_t ranges_skipped = 0;
+    std::uint64_t pages_read = 0;
+    std::uint64_t matches = 0;
+};
+
+// Blocked Bloom filters over one key column of a StorageManager file, one
+// per range of pages, persisted next to it (<path>.bloom). Point lookups
+// read only the ranges whose filter may hold the key.
+//
+// build() sizes every filter for the keys actually present. Incremental
+// maintenance goes through a PageObserver: attach() a page and its inserts
+// are added to its range's filter (deletes leave stale bits, which only
+// cost false positives). Filters created by attach() are sized for
+// expected_keys_per_range and do not grow; stats() shows when they are
+// overfull, and the next build() sizes them for their keys. A range
+// without a filter is always read.
+//
+// The side file holds the filters as of the last save() or load(); the
+// first key added after that (by an observer or build()) removes it, so it
+// never lacks a key the pages have. Keys written to pages that are not
+// attached are not seen: build() after that.
+//
+// Thread safety: pages of one range may be written concurrently, also
+// while build() replaces the filters (flush attached pages first: build()
+// reads 'sm'). lookup() and save() must not overlap writes that create new
+// ranges.
+class BloomIndex {
+   public:
+    explicit BloomIndex(std::string data_path, BloomOptions options = {});
+
+    BloomIndex(const BloomIndex &) = delete;
+    BloomIndex &operator=(const BloomIndex &) = delete;
+
+    static std::string side_path(const std::string &data_path) {
+        return data_path + ".bloom";
+    }
+
+    // Read the side file, before any page is attached (throws
+    // std::runtime_error after an attach()). Returns false (leaving the
+    // index as it was) if there is none, it was written with other
+    // options, or by an incompatible hash. It is removed again on the
+    // next insert.
+    bool load();
+    // Write the side file, replacing it atomically.
+    void save() const;
+
+    // Rebuild every range's filter from 'sm', sized for its key count.
+    void build(storage::StorageManager &sm);
+    // Route 'page's inserts into its range's filter.
+    void attach(std::uint64_t page_id, storage::SlottedPage &page);
+
+    std::size_t num_ranges() const;
+    const BloomOptions &options() const noexcept {
+        return options_;
+    }
+    // Bytes held by all filters.
+    std::size_t memory_bytes() const;
+    BloomIndexStats stats() const;
+
+    // False only if none of the first 'pages' pages can hold 'key', so a
+    // lookup needs no I/O at all.
+    bool may_contain(std::uint64_t pages, const record::Field &key) const;
+
+    // Call fn(page_id, record) for every tuple of 'sm' whose key column
+    // equals 'key', reading only ranges whose filter may hold it.
+    BloomLookupStats lookup(
+        storage::StorageManager &sm, const record::Field &key,
+        const std::function<void(std::uint64_t, std::string_view)> &fn) const;
+
+   private:
+    struct Range;
+
+    class Observer : public storage::PageObserver {
+       public:
+        Observer(const BloomIndex &index, Range &range)
+            : index_(index), range_(range) {}
+        void on_insert(std::string_view record) override;
+        void on_erase(std::string_view) override {}
+        void on_compact(const std::vector<std::string_view> &) override {}
+
+       private:
+        const BloomIndex &index_;
+        Range &range_;
+    };
+
+    struct Range {
+        Range(const BloomIndex &index, BloomFilter f)
+            : filter(std::move(f)), observer(index, *this) {}
+
+        // Inserts share it; build() takes it to replace 'filter'.
+        std::shared_mutex latch;
+        BloomFilter filter;
+        std::atomic<std::uint64_t> keys{0};
+        Observer observer;
+        // While build() recomputes the range, inserts are also kept in
+        // 'pending' (under pending_mutex) for the new filter.
+        std::atomic<bool> rebuilding{false};
+        std::mutex pending_mutex;
+        std::vector<std::uint64_t> pending;
+    };
+
+    // Whether range r's filter may hold the key (true if r has none).
+    bool range_may_contain_(std::size_t r, std::uint64_t hash) const;
+    // Hash of the key column of 'record'; false if it has none.
+    bool key_hash_(std::string_view record, std::uint64_t &hash) const;
+    // Append the key hashes of range r's pages in 'sm' to 'hashes'.
+    void read_keys_(storage::StorageManager &sm, std::size_t r,
+                    std::vector<std::uint64_t> &hashes) const;
+    // A filter sized for, and holding, the distinct keys of 'hashes'
+    // (which it sorts and deduplicates).
+    BloomFilter make_filter_(std::vector<std::uint64_t> &hashes) const;
+    // A key is about to be added: drop the side file if it matches.
+    void changed_() const;
+
+    std::string path_;
+    BloomOptions options_;
+    std::deque<Range> ranges_;
+    // Set by attach(): observers point into ranges_ from then on.
+    bool attached_ = false;
+    // build() in progress: ranges attach() creates start rebuilding.
+    bool building_ = false;
+    mutable std::mutex mutex_;
+    // The side file holds the current filters (see changed_()).
+    mutable std::atomic<bool> saved_{false};
+};
+
+}  // namespace srd::index
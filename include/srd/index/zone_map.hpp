@@ -0,0 +1,176 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "srd/record/tuple_view.hpp"
+#include "srd/storage/slotted_page.hpp"
+#include "srd/storage/storage_manager.hpp"
+
+namespace srd::index {
+
+// Summary of one column over the rows of one page. Each value type keeps
+// its own range, which is empty (min > max) while its count is 0. STRING
+// ranges are over 8-byte big-endian prefixes, so they bound but do not
+// decide string comparisons. Ranges only widen as rows come and go; they
+// are recomputed exactly on compaction and refresh/rebuild.
+struct ColumnZone {
+    uint64_t string_min = std::numeric_limits<uint64_t>::max();
+    uint64_t string_max = 0;
+    uint32_t rows = 0;
+    // Rows that do not have the column (the "null" count).
+    uint32_t missing = 0;
+    uint32_t int_count = 0;
+    int32_t int_min = std::numeric_limits<int32_t>::max();
+    int32_t int_max = std::numeric_limits<int32_t>::min();
+    uint32_t float_count = 0;
+    float float_min = std::numeric_limits<float>::infinity();
+    float float_max = -std::numeric_limits<float>::infinity();
+    uint32_t string_count = 0;
+};
+
+// A single-column filter: rows whose column has the predicate's type and
+// lies in [lo, hi], or, for missing(), rows without the column.
+class RangePredicate {
+   public:
+    static RangePredicate int_range(std::size_t column, int32_t lo,
+                                    int32_t hi);
+    static RangePredicate float_range(std::size_t column, float lo,
+                                      float hi);
+    static RangePredicate string_range(std::size_t column, std::string lo,
+                                       std::string hi);
+    static RangePredicate missing(std::size_t column);
+
+    std::size_t column() const noexcept {
+        return column_;
+    }
+
+    // False only if no row summarized by 'zone' can match.
+    bool may_match(const ColumnZone &zone) const;
+    bool matches(const record::TupleView &row) const;
+
+   private:
+    enum class Kind : uint8_t { INT, FLOAT, STRING, MISSING };
+
+    std::size_t column_ = 0;
+    Kind kind_ = Kind::INT;
+    int32_t int_lo_ = 0, int_hi_ = 0;
+    float float_lo_ = 0, float_hi_ = 0;
+    std::string string_lo_, string_hi_;
+};
+
+struct ZoneScanStats {
+    std::uint64_t pages = 0;
+    std::uint64_t pages_skipped = 0;
+    std::uint64_t records = 0;  // rows that matched
+};
+
+// Per-page min/max/missing summaries of selected columns of a StorageManager
+// file, kept in a side file next to it (<path>.zmap).
+//
+// Summaries follow page changes through a PageObserver: attach() a page
+// after loading it and every addTuple/addRecord/updateRecord/deleteTuple
+// widens its summary. Pages whose records are not plain tuples (e.g.
+// VersionedPage) are marked opaque and never skipped.
+//
+// The side file matches the summaries as of the last save() or load():
+// the first change after that (through an observer, refresh() or
+// rebuild()) removes it, so a crash before the next save() leaves no file
+// rather than a stale one. Writing pages that are not attached makes it
+// stale unnoticed; rebuild() after that.
+//
+// Thread safety: observers of different pages may run concurrently, and
+// attach() may be called from any thread. scan()/may_match()/save() must
+// not overlap page writes.
+class ZoneMap {
+   public:
+    ZoneMap(std::string data_path, std::vector<std::size_t> columns);
+
+    ZoneMap(const ZoneMap &) = delete;
+    ZoneMap &operator=(const ZoneMap &) = delete;
+
+    static std::string side_path(const std::string &data_path) {
+        return data_path + ".zmap";
+    }
+
+    // Read the side file, before any page is attached. Returns false
+    // (leaving the map as it was) if there is none or it summarizes
+    // different columns. It is removed again on the next change.
+    bool load();
+    // Write the side file, replacing it atomically. Summaries describe the
+    // pages as last changed in memory, so save after flushing them.
+    void save() const;
+
+    // Recompute every page's summary exactly from 'sm'.
+    void rebuild(storage::StorageManager &sm);
+    // Recompute one page's summary exactly.
+    void refresh(std::uint64_t page_id, const storage::SlottedPage &page);
+    // Route 'page's changes into page_id's summary.
+    void attach(std::uint64_t page_id, storage::SlottedPage &page);
+
+    std::size_t num_pages() const;
+    const std::vector<std::size_t> &columns() const noexcept {
+        return columns_;
+    }
+    // Summary of columns()[index] on page_id (which must be < num_pages()).
+    const ColumnZone &zone(std::uint64_t page_id, std::size_t index) const;
+
+    // False only if page_id has a summary proving no row matches 'pred'.
+    bool may_match(std::uint64_t page_id, const RangePredicate &pred) const;
+
+    // Call fn(page_id, record) for every row of 'sm' matching 'pred',
+    // loading only pages the summaries cannot exclude (in runs of up to
+    // 'batch_pages' pages).
+    ZoneScanStats scan(
+        storage::StorageManager &sm, const RangePredicate &pred,
+        const std::function<void(std::uint64_t, std::string_view)> &fn,
+        std::size_t batch_pages = 16) const;
+
+   private:
+    struct PageZones;
+
+    class Observer : public storage::PageObserver {
+       public:
+        Observer(const ZoneMap &map, PageZones &zones)
+            : map_(map), zones_(zones) {}
+        void on_insert(std::string_view record) override;
+        void on_erase(std::string_view record) override;
+        void on_compact(const std::vector<std::string_view> &live) override;
+
+       private:
+        const ZoneMap &map_;
+        PageZones &zones_;
+    };
+
+    struct PageZones {
+        PageZones(const ZoneMap &map, std::size_t n)
+            : columns(n), observer(map, *this) {}
+
+        std::vector<ColumnZone> columns;
+        // Some record did not parse as a tuple: never skip this page.
+        bool opaque = false;
+        Observer observer;
+    };
+
+    PageZones &page_(std::uint64_t page_id);
+    // A summary is about to change: drop the side file if it matches.
+    void changed_() const;
+    void add_(PageZones &z, std::string_view record, int sign) const;
+    void reset_(PageZones &z) const;
+
+    std::string path_;
+    std::vector<std::size_t> columns_;
+    // A deque so PageZones (and their observers) never move once created.
+    std::deque<PageZones> pages_;
+    mutable std::mutex mutex_;
+    // The side file holds the current summaries (see changed_()).
+    mutable std::atomic<bool> saved_{false};
+};
+
+}  // namespace srd::index
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "srd/record/field.hpp"
+#include "srd/storage/storage_manager.hpp"
+
+namespace srd::ingest {
+
+struct CsvOptions {
+    // Type of each column; every row must have exactly this many fields.
+    std::vector<record::FieldType> schema;
+    char delimiter = ',';
+    // Fields may be quoted; "" inside quotes is a literal quote. Quoted
+    // fields must not contain line breaks (chunks are split at newlines).
+    char quote = '"';
+    // Skip the first line.
+    bool header = false;
+    // Count malformed rows in CsvImportStats::bad_rows instead of throwing.
+    bool skip_bad_rows = false;
+    // Parser threads; 0 means hardware_concurrency().
+    std::size_t threads = 0;
+    // Input is split into chunks of about this size (cut at newlines) that
+    // are parsed independently.
+    std::size_t chunk_bytes = 8 << 20;
+};
+
+struct CsvImportStats {
+    std::uint64_t rows = 0;
+    std::uint64_t bad_rows = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t pages = 0;
+    // Page id of the first page written.
+    std::uint64_t first_page = 0;
+};
+
+// Bulk loader for delimited text. The input is memory-mapped and cut into
+// chunks at line boundaries; worker threads parse chunks independently,
+// scanning for delimiters, quotes and newlines with SIMD (AVX2 when the CPU
+// has it, otherwise SSE2, otherwise scalar), converting numbers with
+// std::from_chars, and encoding each row straight into the serialized
+// Tuple format in a SlottedPage. Finished chunks are appended to 'sm' in
+// input order, so rows keep the file's order. The data pages start at
+// sm.num_pages(), or at page 0 when the file is a fresh, empty one.
+//
+// Throws std::runtime_error if the input cannot be read, or on the first
+// malformed row (wrong field count, bad number) unless skip_bad_rows.
+class CsvImporter {
+   public:
+    explicit CsvImporter(CsvOptions options);
+
+    CsvImportStats import(const std::string &path,
+                          storage::StorageManager &sm) const;
+
+   private:
+    CsvOptions options_;
+};
+
+}  // namespace srd::ingest
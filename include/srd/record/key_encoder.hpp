@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "srd/record/field.hpp"
+#include "srd/record/tuple.hpp"
+#include "srd/record/tuple_view.hpp"
+
+namespace srd::record {
+
+enum class SortOrder : uint8_t { ASC = 0, DESC = 1 };
+
+struct KeyColumn {
+    std::size_t column = 0;
+    SortOrder order = SortOrder::ASC;
+};
+
+// Turns the key columns of a row into a normalized byte string whose
+// memcmp order (shorter-is-smaller on a common prefix) is the logical row
+// order, so sort/index/join code compares keys without type dispatch or
+// materializing Fields. Per column:
+//   [tag] 0x00 missing, 0x01 INT, 0x02 FLOAT, 0x03 STRING (missing values
+//         sort first, then by type like ExternalSort always has)
+//   INT    4 bytes big-endian, sign bit flipped
+//   FLOAT  4 bytes big-endian IEEE bits: negatives inverted, positives
+//          with the sign bit set (-0.0 sorts just before +0.0)
+//   STRING bytes with 0x00 escaped as 0x00 0xFF, then 0x00 0x00
+// A DESC column has all of its bytes (tag included) inverted. Every column
+// encoding is prefix-free, so a key never is a proper prefix of another.
+class KeyEncoder {
+   public:
+    explicit KeyEncoder(std::vector<KeyColumn> columns);
+
+    const std::vector<KeyColumn> &columns() const noexcept {
+        return columns_;
+    }
+
+    // Replace 'out' with the key of 'row'. Malformed records throw like
+    // TupleView.
+    void encode(const TupleView &row, std::string &out) const;
+    void encode(const Tuple &row, std::string &out) const;
+
+    // Building blocks, e.g. for probe keys assembled from loose values.
+    static void append(const FieldView &field, SortOrder order,
+                       std::string &out);
+    static void append(const Field &field, SortOrder order, std::string &out);
+    static void append_missing(SortOrder order, std::string &out);
+
+    // Order of two encoded keys: <0, 0 or >0.
+    static int compare(std::string_view a, std::string_view b) noexcept {
+        return a.compare(b);
+    }
+
+    // First 8 key bytes as a big-endian integer, zero-padded. Since no key
+    // is a proper prefix of another, differing prefixes decide the order
+    // and equal ones tie only if both keys are at most 8 bytes.
+    static uint64_t prefix(std::string_view key) noexcept;
+
+   private:
+    std::vector<KeyColumn> columns_;
+};
+
+}  // namespace srd::record
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+#include "srd/record/field.hpp"
+
+namespace srd::record {
+
+// Read-only view of one serialized field; 'payload' points into the record.
+struct FieldView {
+    FieldType type = FieldType::INT;
+    std::string_view payload;
+
+    int asInt() const;
+    float asFloat() const;
+    // Without the trailing null terminator that Field stores.
+    std::string_view asString() const;
+};
+
+// Non-owning, non-allocating view over the bytes of Tuple::serialize(), for
+// code that inspects records straight out of a page (sort, join, scans)
+// without building Field objects. The viewed bytes must outlive the view.
+// Malformed input throws std::runtime_error, like Tuple::deserialize.
+class TupleView {
+   public:
+    TupleView() = default;
+    explicit TupleView(std::string_view record);
+
+    std::size_t size() const noexcept {
+        return count_;
+    }
+
+    // Walks the record up to field 'index'; throws std::out_of_range if the
+    // tuple has fewer fields.
+    FieldView field(std::size_t index) const;
+
+    std::string_view bytes() const noexcept {
+        return record_;
+    }
+
+   private:
+    std::string_view record_;
+    uint32_t count_ = 0;
+};
+
+}  // namespace srd::record
@@ -0,0 +1,91 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "srd/storage/storage_manager.hpp"
+
+namespace srd::storage {
+
+struct CheckpointOptions {
+    // Cap on background write bandwidth in bytes per second (0: unlimited),
+    // so checkpoints do not compete with foreground I/O in bursts.
+    std::uint64_t bytes_per_sec = std::uint64_t{64} << 20;
+    // How long dirty pages may collect before a round starts on its own.
+    // Pages dirtied again within the interval are written once.
+    std::chrono::milliseconds interval{200};
+    // Pages per flush_pages call; the rate limit is charged per batch.
+    std::size_t batch_pages = 128;
+};
+
+struct CheckpointStats {
+    std::uint64_t rounds = 0;
+    std::uint64_t pages_written = 0;
+    // flush_range calls, i.e. runs of adjacent pages.
+    std::uint64_t runs = 0;
+    // Rounds that failed; their pages went back into the dirty set.
+    std::uint64_t failed_rounds = 0;
+};
+
+// Fuzzy checkpointer: writes dirty pages back in the background while the
+// foreground keeps modifying them. A round takes the current dirty set,
+// writes it in page order through flush_pages (each page under its shared
+// latch, so the image is consistent per page but not across pages), then
+// syncs. A page dirtied again during a round is written again in the next.
+// A round that fails puts its pages back into the dirty set (unless they
+// were marked again meanwhile), so later rounds retry them.
+//
+// Pages are not copied: a page passed to mark_dirty() must stay alive
+// until a checkpoint() that follows the last mark_dirty() of it returns,
+// or the Checkpointer is destroyed.
+class Checkpointer {
+   public:
+    explicit Checkpointer(StorageManager &sm, CheckpointOptions options = {});
+    // Runs a last round for pages still dirty, then stops the thread.
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer &) = delete;
+    Checkpointer &operator=(const Checkpointer &) = delete;
+
+    // Note that 'page' holds new contents for 'page_id'. Cheap: one map
+    // update under a mutex, no I/O.
+    void mark_dirty(std::uint64_t page_id, const SlottedPage *page);
+
+    // Start a round now and wait until every page marked before the call
+    // is written and synced. Rethrows the I/O error if every round since
+    // the call failed; the pages stay dirty, and the next call retries
+    // them. Concurrent callers waiting on a failed round all see it.
+    void checkpoint();
+
+    // Pages marked but not yet taken by a round.
+    std::size_t dirty_pages() const;
+
+    CheckpointStats stats() const;
+
+   private:
+    void run_();
+
+    StorageManager &sm_;
+    CheckpointOptions options_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::unordered_map<std::uint64_t, const SlottedPage *> dirty_;
+    // Rounds begun and finished; checkpoint() waits for a round that began
+    // after it was called. last_ok_round_ is the latest that succeeded.
+    std::uint64_t rounds_started_ = 0;
+    std::uint64_t rounds_done_ = 0;
+    std::uint64_t last_ok_round_ = 0;
+    std::uint64_t requested_ = 0;
+    bool stop_ = false;
+    // Failure of the latest failed round.
+    std::exception_ptr error_;
+    CheckpointStats stats_;
+    std::thread thread_;
+};
+
+}  // namespace srd::storage
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace srd::storage {
+
+// Byte-oriented LZ77 codec in the style of the LZ4 block format, sized for
+// single pages: greedy matching through a 4-byte hash table, no entropy
+// stage. Slotted pages compress well with it because the gap between the
+// slot directory and the payload tail is one long run of zeros, which
+// becomes a single overlapping match.
+//
+// A block is a sequence of [token][literal length ext][literals]
+// [u16 offset][match length ext], where the token's high nibble is the
+// literal length and its low nibble the match length minus 4 (15 means
+// more length bytes follow, each added until one is below 255). The last
+// sequence has literals only.
+class PageCodec {
+   public:
+    // Upper bound of compress() output for 'n' input bytes.
+    static constexpr std::size_t max_compressed_size(std::size_t n) {
+        return n + n / 255 + 16;
+    }
+
+    // Replace 'out' with the compressed form of 'in' (at most 64 KiB).
+    static void compress(std::string_view in, std::string &out);
+
+    // Decode 'in' into exactly 'out_size' bytes at 'out'. Throws
+    // std::runtime_error if the block is malformed or does not produce
+    // exactly out_size bytes.
+    static void decompress(std::string_view in, char *out,
+                           std::size_t out_size);
+};
+
+}  // namespace srd::storage
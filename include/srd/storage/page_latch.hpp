@@ -0,0 +1,181 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+namespace srd::storage {
+
+// Compact (8-byte) reader/writer latch with an optimistic read mode, meant to
+// sit next to every in-memory page. One word holds everything:
+// +------------------------------+--------------+---------+--------+
+// | version (48 bits)            | readers (14) | waiting | writer |
+// +------------------------------+--------------+---------+--------+
+//   bit 63                  16     bit 15     2    bit 1     bit 0
+// - Exclusive (lock/unlock): waits for readers and writers to drain; unlock
+//   bumps the version. A writer kept out by readers sets 'waiting', which
+//   holds off new shared lockers, so a stream of readers cannot starve it.
+// - Shared (lock_shared/unlock_shared): blocks writers only. Not recursive:
+//   a thread that takes it twice on one page can deadlock against a
+//   waiting writer.
+// - Optimistic (read_begin/validate): takes nothing. The reader copies what it
+//   needs with load_bytes() and then checks that no writer held or released
+//   the latch in the meantime; if validation fails the copy must be
+//   discarded. Writers store bytes such readers may look at with
+//   store_bytes(). Both use relaxed atomic word accesses, so the overlap is
+//   not a data race in the C++ memory model (nor a ThreadSanitizer report),
+//   only a copy that validate() rejects.
+// Satisfies Lockable and SharedLockable, so std::unique_lock and
+// std::shared_lock work with it. Waiting spins briefly, then yields.
+class PageLatch {
+   public:
+    PageLatch() = default;
+    PageLatch(const PageLatch &) = delete;
+    PageLatch &operator=(const PageLatch &) = delete;
+
+    void lock() noexcept {
+        for (unsigned spins = 0;; ++spins) {
+            uint64_t s = state_.load(std::memory_order_relaxed);
+            if ((s & (WRITER | READER_MASK)) == 0) {
+                if (state_.compare_exchange_weak(s, (s | WRITER) & ~WAITING,
+                                                 std::memory_order_acquire)) {
+                    // Make the writer bit visible before any page
+                    // modification.
+                    std::atomic_thread_fence(std::memory_order_release);
+                    return;
+                }
+            } else if ((s & READER_MASK) != 0 && (s & WAITING) == 0) {
+                // Readers are in and no one has asked them to stop yet.
+                state_.fetch_or(WAITING, std::memory_order_relaxed);
+            }
+            backoff_(spins);
+        }
+    }
+
+    bool try_lock() noexcept {
+        uint64_t s = state_.load(std::memory_order_relaxed);
+        if ((s & (WRITER | READER_MASK)) != 0) return false;
+        if (!state_.compare_exchange_strong(s, (s | WRITER) & ~WAITING,
+                                            std::memory_order_acquire)) {
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        return true;
+    }
+
+    void unlock() noexcept {
+        // Clear the writer bit and advance the version in one step.
+        state_.fetch_add(VERSION_ONE - WRITER, std::memory_order_release);
+    }
+
+    void lock_shared() noexcept {
+        for (unsigned spins = 0;; ++spins) {
+            uint64_t s = state_.load(std::memory_order_relaxed);
+            if ((s & (WRITER | WAITING)) == 0 &&
+                (s & READER_MASK) != READER_MASK &&
+                state_.compare_exchange_weak(s, s + READER_ONE,
+                                             std::memory_order_acquire)) {
+                return;
+            }
+            backoff_(spins);
+        }
+    }
+
+    bool try_lock_shared() noexcept {
+        uint64_t s = state_.load(std::memory_order_relaxed);
+        if ((s & (WRITER | WAITING)) != 0 ||
+            (s & READER_MASK) == READER_MASK) {
+            return false;
+        }
+        return state_.compare_exchange_strong(s, s + READER_ONE,
+                                              std::memory_order_acquire);
+    }
+
+    void unlock_shared() noexcept {
+        state_.fetch_sub(READER_ONE, std::memory_order_release);
+    }
+
+    // Start an optimistic read. Returns false while a writer holds the latch;
+    // otherwise stores the version to pass to validate().
+    bool read_begin(uint64_t &version) const noexcept {
+        const uint64_t s = state_.load(std::memory_order_acquire);
+        if ((s & WRITER) != 0) return false;
+        version = s >> VERSION_SHIFT;
+        return true;
+    }
+
+    // True if no writer has touched the page since read_begin(version).
+    bool validate(uint64_t version) const noexcept {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t s = state_.load(std::memory_order_relaxed);
+        return (s & WRITER) == 0 && (s >> VERSION_SHIFT) == version;
+    }
+
+    // Number of completed exclusive sections (wraps at 2^48).
+    uint64_t version() const noexcept {
+        return state_.load(std::memory_order_acquire) >> VERSION_SHIFT;
+    }
+
+    // Copy 'n' bytes an optimistic reader shares with writers out of
+    // 'src', with relaxed atomic loads of aligned words.
+    static void load_bytes(void *dst, const void *src, std::size_t n) noexcept {
+        auto *d = static_cast<unsigned char *>(dst);
+        const auto *s = static_cast<const unsigned char *>(src);
+        for (; n > 0 && !aligned_(s); --n) {
+            *d++ = __atomic_load_n(s++, __ATOMIC_RELAXED);
+        }
+        for (; n >= 8; n -= 8, s += 8, d += 8) {
+            const uint64_t w = __atomic_load_n(
+                reinterpret_cast<const uint64_t *>(s), __ATOMIC_RELAXED);
+            std::memcpy(d, &w, 8);
+        }
+        for (; n > 0; --n) *d++ = __atomic_load_n(s++, __ATOMIC_RELAXED);
+    }
+
+    // Copy 'n' bytes into 'dst', which optimistic readers may be loading,
+    // with relaxed atomic stores of aligned words; 'src' == nullptr stores
+    // zeros. Copies front to back, so 'dst' may overlap 'src' if it lies
+    // before it. Caller holds the latch exclusively.
+    static void store_bytes(void *dst, const void *src,
+                            std::size_t n) noexcept {
+        auto *d = static_cast<unsigned char *>(dst);
+        const auto *s = static_cast<const unsigned char *>(src);
+        auto next = [&s]() -> unsigned char { return s ? *s++ : 0; };
+        for (; n > 0 && !aligned_(d); --n) {
+            __atomic_store_n(d++, next(), __ATOMIC_RELAXED);
+        }
+        for (; n >= 8; n -= 8, d += 8) {
+            uint64_t w = 0;
+            if (s) {
+                std::memcpy(&w, s, 8);
+                s += 8;
+            }
+            __atomic_store_n(reinterpret_cast<uint64_t *>(d), w,
+                             __ATOMIC_RELAXED);
+        }
+        for (; n > 0; --n) __atomic_store_n(d++, next(), __ATOMIC_RELAXED);
+    }
+
+   private:
+    static constexpr uint64_t WRITER = 1;
+    static constexpr uint64_t WAITING = uint64_t{1} << 1;
+    static constexpr uint64_t READER_ONE = uint64_t{1} << 2;
+    static constexpr uint64_t READER_MASK = uint64_t{0x3FFF} << 2;
+    static constexpr unsigned VERSION_SHIFT = 16;
+    static constexpr uint64_t VERSION_ONE = uint64_t{1} << VERSION_SHIFT;
+
+    static bool aligned_(const void *p) noexcept {
+        return reinterpret_cast<std::uintptr_t>(p) % 8 == 0;
+    }
+
+    static void backoff_(unsigned spins) noexcept {
+        if (spins < 64) return;
+        std::this_thread::yield();
+    }
+
+    std::atomic<uint64_t> state_{0};
+};
+static_assert(sizeof(PageLatch) == 8, "PageLatch should stay one word");
+
+}  // namespace srd::storage
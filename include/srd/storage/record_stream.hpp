@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "srd/storage/storage_manager.hpp"
+
+namespace srd::storage {
+
+// Appends records (raw slot bytes, usually Tuple::serialize()) to
+// consecutive pages of a StorageManager, starting at 'first_page' and
+// growing the file as needed. Filled pages are written 'batch_pages' at a
+// time with flush_range. Used for sorted runs, spill files and bulk loads.
+class RecordWriter {
+   public:
+    explicit RecordWriter(StorageManager &sm, std::uint64_t first_page = 0,
+                          std::size_t batch_pages = 16);
+
+    RecordWriter(const RecordWriter &) = delete;
+    RecordWriter &operator=(const RecordWriter &) = delete;
+
+    // Throws std::length_error if the record cannot fit even an empty page.
+    void append(std::string_view record);
+
+    // Write out the partially filled page and any pending batch. Returns the
+    // number of pages written so far. Call before the writer goes away.
+    std::uint64_t finish();
+
+    std::uint64_t records() const noexcept {
+        return records_;
+    }
+
+   private:
+    void write_pending_();
+
+    StorageManager &sm_;
+    std::uint64_t next_page_;
+    std::size_t batch_pages_;
+    std::uint64_t pages_written_ = 0;
+    std::uint64_t records_ = 0;
+    std::vector<std::unique_ptr<SlottedPage>> pending_;
+    std::unique_ptr<SlottedPage> current_;
+    // Records on current_ and the end of its last one.
+    std::size_t current_records_ = 0;
+    std::size_t current_tail_ = 0;
+};
+
+// Sequential reader over the live records of pages [first_page, end_page),
+// in page/slot order. Reads 'read_ahead_pages' at a time with load_range.
+class RecordReader {
+   public:
+    // end_page == 0 means "up to num_pages() at construction".
+    explicit RecordReader(StorageManager &sm, std::uint64_t first_page = 0,
+                          std::uint64_t end_page = 0,
+                          std::size_t read_ahead_pages = 8);
+
+    // Copy the next record into 'record'; false once the range is exhausted.
+    bool next(std::string &record);
+
+    // Location of the record last returned by next().
+    std::uint64_t page_id() const noexcept {
+        return batch_first_ + batch_index_;
+    }
+    std::size_t slot() const noexcept {
+        return slot_ - 1;
+    }
+
+   private:
+    StorageManager &sm_;
+    std::uint64_t next_page_;
+    std::uint64_t end_page_;
+    std::size_t read_ahead_;
+    std::vector<std::unique_ptr<SlottedPage>> batch_;
+    std::uint64_t batch_first_ = 0;
+    std::size_t batch_index_ = 0;
+    std::size_t slot_ = 0;
+};
+
+}  // namespace srd::storage
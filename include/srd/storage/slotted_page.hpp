@@ -1,7 +1,14 @@
 #pragma once
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/spdlog.h"
 #include "srd/record/tuple.hpp"
+#include "srd/storage/page_latch.hpp"
 
 using srd::record::Tuple;
 
@@ -10,6 +17,24 @@ namespace srd::storage {
 inline constexpr size_t PAGE_SIZE = 4096;
 inline constexpr size_t MAX_SLOTS = 128;
 inline constexpr uint16_t INVALID_VALUE = 0xFFFF;
+// Page buffers are aligned for O_DIRECT, which needs the buffer, file offset
+// and length all aligned to the device's logical block size.
+inline constexpr size_t PAGE_ALIGNMENT = 4096;
+
+struct AlignedPageDeleter {
+    void operator()(char *p) const noexcept {
+        ::operator delete[](p, std::align_val_t{PAGE_ALIGNMENT});
+    }
+};
+using PageBuffer = std::unique_ptr<char[], AlignedPageDeleter>;
+
+// Allocate a zeroed, PAGE_ALIGNMENT-aligned buffer of PAGE_SIZE bytes.
+inline PageBuffer make_page_buffer() {
+    PageBuffer buf(static_cast<char *>(
+        ::operator new[](PAGE_SIZE, std::align_val_t{PAGE_ALIGNMENT})));
+    std::memset(buf.get(), 0, PAGE_SIZE);
+    return buf;
+}
 
 // Slot metadata stored at the beginning of each page
 struct Slot {
@@ -20,6 +45,20 @@ struct Slot {
 static_assert(sizeof(Slot) == 6,
               "Slot size changed: update metadata_size() math");
 
+// Receives every change to a page's records, so side structures (e.g. zone
+// maps) can follow the page without rescanning it. A page may have several
+// observers (say a zone map and a Bloom index), called in the order they
+// were added. Calls are made under the page's exclusive latch, so they are
+// serialized per page; an observer must not call back into the page.
+class PageObserver {
+   public:
+    virtual ~PageObserver() = default;
+    virtual void on_insert(std::string_view record) = 0;
+    virtual void on_erase(std::string_view record) = 0;
+    // The page was compacted; 'live' holds every record still on it.
+    virtual void on_compact(const std::vector<std::string_view> &live) = 0;
+};
+
 // Slotted page with a fixed slot directory placed at the page start.
 // Tuple bytes are the result of Tuple::serialize()
 // +---------------------------+  offset 0
@@ -32,6 +71,14 @@ static_assert(sizeof(Slot) == 6,
 // | Tuple bytes ...           |
 // | ...                       |
 // +---------------------------+  offset = PAGE_SIZE - 1
+//
+// Concurrency: every page carries a PageLatch. Mutators (addTuple,
+// deleteTuple, addRecord, updateRecord) take it exclusively, so writers only
+// block writers and readers of the same page. getTuple/getRecord read
+// optimistically (copy the record, then validate the latch version) and only
+// fall back to a shared latch after repeated conflicts.
+// Code touching raw_data() directly must hold latch() itself, and store
+// through PageLatch::store_bytes while other threads can read the page.
 class SlottedPage {
    public:
     SlottedPage();
@@ -40,9 +87,16 @@ class SlottedPage {
     // Non-copyable
     SlottedPage(const SlottedPage &) = delete;
     SlottedPage &operator=(const SlottedPage &) = delete;
-    // Movable
-    SlottedPage(SlottedPage &&) noexcept = default;
-    SlottedPage &operator=(SlottedPage &&) noexcept = default;
+    // Movable. The buffer and observers move; the latch stays behind, so a
+    // page must not be moved while other threads can reach it.
+    SlottedPage(SlottedPage &&other) noexcept
+        : page_data_(std::move(other.page_data_)),
+          observers_(std::exchange(other.observers_, {})) {}
+    SlottedPage &operator=(SlottedPage &&other) noexcept {
+        page_data_ = std::move(other.page_data_);
+        observers_ = std::exchange(other.observers_, {});
+        return *this;
+    }
 
     // Insert a tuple into the first slot that has enough capacity
     // Returns true if inserted, false if it doesn't fit anywhere or page full.
@@ -53,6 +107,17 @@ class SlottedPage {
 
     bool getTuple(size_t index, srd::record::Tuple &out) const;
 
+    // Record-level access for layers that keep their own bytes in a slot
+    // (e.g. a header in front of the serialized tuple). A record is any
+    // non-empty byte string of at most 64 KiB - 1 bytes.
+    // addRecord reports the slot it used in 'slot'.
+    bool addRecord(std::string_view record, size_t &slot);
+    bool getRecord(size_t index, std::string &out) const;
+    // Replace the record in a live slot, keeping its slot id. Shrinking
+    // rewrites in place; growing relocates (compacting if needed). Returns
+    // false, leaving the old record intact, if the new one does not fit.
+    bool updateRecord(size_t index, std::string_view record);
+
     void print() const;
 
     size_t metadata_size() const {
@@ -67,6 +132,18 @@ class SlottedPage {
         return page_data_.get();
     }
 
+    PageLatch &latch() const noexcept {
+        return latch_;
+    }
+
+    // Attach an observer (once; adding it again is a no-op) or detach one.
+    // Not owned; it must outlive the page or be removed first. These take
+    // the latch, so they may race with writers but not be called by an
+    // observer.
+    void add_observer(PageObserver *observer);
+    void remove_observer(PageObserver *observer);
+    void clear_observers();
+
     // Useful introspection (not strictly required, but handy in tests)
     std::size_t used_bytes() const;   // sum of live tuple lengths
     std::size_t free_bytes() const {  // available payload space
@@ -76,7 +153,25 @@ class SlottedPage {
     }
 
    private:
-    std::unique_ptr<char[]> page_data_ = std::make_unique<char[]>(PAGE_SIZE);
+    // A slot holds a tuple only if it is marked non-empty and points at a
+    // non-zero-length record. The length check also covers the all-zero slot
+    // directory of a page that was grown on disk but never written.
+    static bool in_use_(const Slot &s) {
+        return !s.empty && s.offset != INVALID_VALUE &&
+               s.length != INVALID_VALUE && s.length != 0;
+    }
+
+    // Put 'record' into slot 'slot_id' at the tail, compacting first if
+    // that is the only way to make it fit (reported through 'compacted').
+    // Caller holds the latch.
+    bool place_(Slot *slots, size_t slot_id, std::string_view record,
+                bool *compacted = nullptr);
+    // Copy slot 'index' into 'out' (optimistically, see class comment).
+    bool read_record_(size_t index, std::string &out) const;
+
+    PageBuffer page_data_ = make_page_buffer();
+    mutable PageLatch latch_;
+    std::vector<PageObserver *> observers_;
     size_t used_bytes_(const Slot *slot_array) const;
     size_t tail_end_(const Slot *slot_array) const;
     void compact_();
@@ -1,23 +1,99 @@
 #pragma once
 
-#include <fstream>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "srd/storage/slotted_page.hpp"
 
 namespace srd::storage {
 
+// How the backing file grows once the logical page count outruns the space
+// already reserved on disk. Reservations go through fallocate (or a sparse
+// ftruncate when the filesystem cannot preallocate), so growing by a chunk
+// costs one system call rather than one write per page. While reserved
+// pages lie past the logical end, the logical page count is also kept in
+// the side file logical_size_path(path), so that the reservation is not
+// mistaken for data if the process dies before the file is closed.
+struct GrowthPolicy {
+    enum class Kind : uint8_t { FIXED = 0, GEOMETRIC = 1 };
+
+    Kind kind = Kind::GEOMETRIC;
+    // FIXED: reserve exactly this many pages per step.
+    // GEOMETRIC: lower bound of a step.
+    std::size_t chunk_pages = 256;
+    // GEOMETRIC: a step is this fraction of the current capacity ...
+    double factor = 0.5;
+    // ... capped at this many pages.
+    std::size_t max_chunk_pages = 64 * 1024;
+};
+
+struct StorageOptions {
+    GrowthPolicy growth;
+    // Open the file with O_DIRECT so page reads and writes bypass the kernel
+    // page cache; caching is then entirely up to the caller. Falls back to
+    // buffered I/O (with a warning) where the filesystem refuses O_DIRECT.
+    bool direct_io = false;
+    // Store every page PageCodec-compressed in a variable-size extent
+    // instead of as a raw PAGE_SIZE image, trading CPU for I/O bandwidth
+    // and space on read-mostly files. Every write of a page goes to a fresh
+    // extent, so reads and crashes never see a half-written image: one left
+    // free by earlier rewrites (reusable once sync() has saved a map that no
+    // longer points at it) or else the end of the file. A page id -> extent
+    // map is kept in the side file page_map_path(path).
+    // The mode is a property of the file: a compressed file must always be
+    // opened compressed. Implies buffered I/O.
+    bool compressed = false;
+};
+
+struct SnapshotOptions {
+    // Try a reflink clone (FICLONE) first. On filesystems that share
+    // extents (btrfs, XFS) it is one system call however big the file is;
+    // elsewhere the pages are copied.
+    bool reflink = true;
+    // Cap on the copier's bandwidth in bytes per second (0: unlimited), so
+    // a backup does not starve foreground I/O.
+    std::uint64_t bytes_per_sec = 0;
+    // Pages copied per step. A writer that needs a page of the step in
+    // progress waits for that step.
+    std::size_t chunk_pages = 64;
+};
+
+struct SnapshotStats {
+    std::uint64_t pages = 0;
+    bool reflinked = false;
+    // Pages whose pre-snapshot image a writer saved before overwriting it.
+    std::uint64_t copied_by_writers = 0;
+};
+
 class StorageManager {
    public:
-    explicit StorageManager(std::string path = "srd.dat");
+    explicit StorageManager(std::string path = "srd.dat",
+                            StorageOptions options = {});
 
     StorageManager(const StorageManager &) = delete;
     StorageManager &operator=(const StorageManager &) = delete;
 
-    // getter function for the num_pages_
+    // Logical page count: pages handed out by extend_to / extend_one.
     std::size_t num_pages() const noexcept {
-        return num_pages_;
+        return num_pages_.load(std::memory_order_acquire);
+    }
+
+    // Physical page count: pages reserved in the backing file. Always
+    // >= num_pages(); the surplus is trimmed when the manager is closed.
+    // After a crash the file is reopened with its reservation: the logical
+    // count is the one recorded at the last sync() or reservation, plus any
+    // written pages past it (pages never written read as all zeros).
+    std::size_t capacity_pages() const noexcept {
+        return capacity_pages_.load(std::memory_order_acquire);
     }
 
     // Ensure the file has at least (page_id + 1) pages (0-based page IDs).
@@ -33,22 +109,175 @@ class StorageManager {
     // Write the given page to disk at 'page_id'. Page must be PAGE_SIZE bytes.
     void flush(std::uint64_t page_id, const SlottedPage &page);
 
+    // Read pages [first, first + count) into new SlottedPages with vectored
+    // reads: one preadv per run of up to IOV_MAX pages.
+    // Throws std::out_of_range if the range extends past num_pages().
+    std::vector<std::unique_ptr<SlottedPage>> load_range(std::uint64_t first,
+                                                         std::size_t count);
+
+    // Write pages[i] to page (first + i) with vectored writes.
+    // Throws std::out_of_range if the range extends past num_pages().
+    void flush_range(std::uint64_t first,
+                     std::span<const SlottedPage *const> pages);
+
+    // Flush an unordered set of dirty pages. Page ids are sorted and runs of
+    // adjacent ids are merged into single flush_range calls, so a checkpoint
+    // turns into a few large sequential writes. If a page id appears more
+    // than once the last entry wins. Returns the number of runs written.
+    std::size_t flush_pages(
+        std::vector<std::pair<std::uint64_t, const SlottedPage *>> pages);
+
+    // Make every completed write durable (fdatasync). Writes are otherwise
+    // only ordered by the kernel, not persisted. A compressed file also
+    // saves its page map.
+    void sync();
+
+    // Write a point-in-time image of the file to 'target' (replaced if it
+    // exists) while other threads keep writing. The image holds every write
+    // that completed before the call and none that started after it.
+    // Without a reflink, the calling thread copies the pages in order, and
+    // a write to a page not yet copied first saves the page's old image
+    // (copy-before-write). So writers only pay on the first write to each
+    // page, and never wait for the whole copy. For a compressed file the
+    // page map is written next to the image; its copy fallback holds
+    // writers off until it is done. Returns once the image is durable.
+    // Throws std::runtime_error if a snapshot is already in progress.
+    SnapshotStats snapshot_to(const std::string &target,
+                              const SnapshotOptions &options = {});
+
     // Path of the backing file (useful in tests / logging)
     const std::string &path() const noexcept {
         return path_;
     }
 
+    const StorageOptions &options() const noexcept {
+        return options_;
+    }
+
+    // Whether the file is actually open for direct I/O.
+    bool direct_io() const noexcept {
+        return direct_io_;
+    }
+
+    bool compressed() const noexcept {
+        return options_.compressed;
+    }
+
+    // Bytes of the backing file in use: pages for a raw file, extents
+    // (including free ones left by rewrites) for a compressed one.
+    std::uint64_t file_bytes() const;
+
+    // Side file holding the page map of a compressed file.
+    static std::string page_map_path(const std::string &path) {
+        return path + ".pmap";
+    }
+
+    // Side file holding the logical page count of a raw file while it has
+    // reserved pages; removed once a clean close has trimmed them.
+    static std::string logical_size_path(const std::string &path) {
+        return path + ".lsize";
+    }
+
     ~StorageManager();
 
    private:
     void open_or_create_();
     void recompute_pages_();
+    // Grow the logical page count to 'pages', reserving more of the file
+    // first if needed. Caller holds io_mutex_.
+    void grow_to_(std::size_t pages);
+    void reserve_(std::size_t pages);
+    // Durably record num_pages() in logical_size_path(path_). Caller holds
+    // io_mutex_.
+    void save_logical_size_();
+    // The recorded logical page count: nullopt without a side file, 0 if
+    // it is unreadable.
+    std::optional<std::size_t> load_logical_size_() const;
+    // One past the last page in [from, to) that is not all zeros, or
+    // 'from' if there is none.
+    std::size_t written_end_(std::size_t from, std::size_t to) const;
+    std::size_t next_capacity_(std::size_t needed) const;
+    void check_range_(const char *what, std::uint64_t first,
+                      std::size_t count) const;
+    // Transfer 'count' whole pages starting at page 'first' to/from the
+    // given buffers, batching them into preadv/pwritev calls.
+    void transfer_(bool write, std::uint64_t first, char *const *buffers,
+                   std::size_t count);
+
+    // Compressed mode (see StorageOptions::compressed).
+    struct Extent {
+        std::uint64_t offset = UNWRITTEN;
+        std::uint32_t capacity = 0;
+    };
+    static constexpr std::uint64_t UNWRITTEN = ~std::uint64_t{0};
+    void open_compressed_();
+    bool load_map_();
+    // Encoded page map. Caller holds map_mutex_.
+    std::string map_image_() const;
+    // Write the page map of the data file at 'data_path'.
+    void save_map_(const std::string &data_path) const;
+    void write_map_(const std::string &data_path,
+                    const std::string &image) const;
+    // sync() of a compressed file, which then frees the retired extents
+    // the saved map no longer points at.
+    void sync_compressed_();
+    void scan_extents_();
+    // Free the extents between mapped ones in [0, data_end_), left by
+    // rewrites, and raise next_seq_ past their sequence numbers.
+    void collect_free_();
+    void read_extents_(std::uint64_t first, char *const *buffers,
+                       std::size_t count) const;
+    void write_extents_(std::uint64_t first, char *const *buffers,
+                        std::size_t count);
+
+    // Snapshot copy in progress (see snapshot_to).
+    struct Snapshot;
+    // Save the pre-snapshot image of the pages in [first, first + count)
+    // that the copier has not reached yet. Caller holds write_gate_ shared.
+    void preserve_(std::uint64_t first, std::size_t count);
+    // Copy pages [first, first + count) to the snapshot, skipping ones
+    // already copied. Caller holds the snapshot's mutex.
+    std::uint64_t copy_to_snapshot_(Snapshot &snap, std::uint64_t first,
+                                    std::size_t count);
 
    private:
     std::string path_;
-    std::fstream file_;
-    std::size_t num_pages_ = 0;
+    StorageOptions options_;
+    int fd_ = -1;
+    bool direct_io_ = false;
+    std::atomic<std::size_t> num_pages_{0};
+    std::atomic<std::size_t> capacity_pages_{0};
+    // Serializes file growth; page reads and writes use positional I/O and
+    // do not take it.
     mutable std::mutex io_mutex_;
+    // Raw files with a reservation: the count last written to the side
+    // file, and whether there is one. Guarded by io_mutex_.
+    std::size_t saved_logical_ = 0;
+    bool has_logical_file_ = false;
+    // Compressed mode: extent of every page, the end of the data and the
+    // sequence number of the next extent written, guarded by map_mutex_
+    // (shared for lookups).
+    std::vector<Extent> extents_;
+    std::uint64_t data_end_ = 0;
+    std::uint64_t next_seq_ = 1;
+    // Extents that writes moved pages away from. They stay intact until
+    // sync() has saved a map that no longer points at them; then they go
+    // to free_ (capacity -> offset) for later writes. Guarded by
+    // map_mutex_.
+    std::vector<Extent> retired_;
+    std::multimap<std::uint32_t, std::uint64_t> free_;
+    mutable std::shared_mutex map_mutex_;
+    // Held shared by a compressed read from its map lookup until its
+    // extents are read. sync() takes it exclusively before freeing retired
+    // extents, so no read still uses them.
+    mutable std::shared_mutex readers_;
+    // One compressed sync() at a time, so maps are saved in order.
+    std::mutex sync_mutex_;
+    // Held shared by every page write and exclusively while a snapshot
+    // starts (and for a whole compressed-file copy), which makes the start
+    // of a snapshot a single point between writes.
+    std::shared_mutex write_gate_;
+    std::unique_ptr<Snapshot> snapshot_;
 };
 
-}  // namespace srd::storage
\ No newline at end of file
+}  // namespace srd::storage
@@ -0,0 +1,140 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "srd/storage/slotted_page.hpp"
+
+namespace srd::storage {
+
+inline constexpr uint64_t TS_INFINITY = UINT64_MAX;
+
+// Hands out commit timestamps and tracks open snapshots.
+// A snapshot with timestamp S sees exactly the writes with commit ts <= S.
+// Writes in flight are never visible: a new snapshot is capped just below
+// the oldest write that has not finished yet.
+class VersionClock {
+   public:
+    // 'start' must exceed every timestamp already stored in loaded pages.
+    explicit VersionClock(uint64_t start = 1) : next_ts_(start) {}
+
+    VersionClock(const VersionClock &) = delete;
+    VersionClock &operator=(const VersionClock &) = delete;
+
+    uint64_t begin_snapshot();
+    void end_snapshot(uint64_t ts);
+
+    // Reserve a commit timestamp / publish the write that used it.
+    uint64_t begin_write();
+    void end_write(uint64_t ts);
+
+    // Versions that ended at or before this timestamp are invisible to every
+    // open and future snapshot, so they can be reclaimed.
+    uint64_t oldest_active() const;
+
+   private:
+    uint64_t visible_() const;
+
+    mutable std::mutex mutex_;
+    uint64_t next_ts_;
+    std::set<uint64_t> writes_;
+    std::multiset<uint64_t> snapshots_;
+};
+
+// RAII snapshot registration.
+class Snapshot {
+   public:
+    explicit Snapshot(VersionClock &clock)
+        : clock_(clock), ts_(clock.begin_snapshot()) {}
+    ~Snapshot() {
+        clock_.end_snapshot(ts_);
+    }
+
+    Snapshot(const Snapshot &) = delete;
+    Snapshot &operator=(const Snapshot &) = delete;
+
+    uint64_t ts() const noexcept {
+        return ts_;
+    }
+
+   private:
+    VersionClock &clock_;
+    uint64_t ts_;
+};
+
+// Header in front of every tuple stored by a VersionedPage.
+// Record layout: [u64 begin_ts][u64 end_ts][Tuple::serialize() bytes]
+// A version is visible to snapshot S iff begin_ts <= S < end_ts.
+struct VersionHeader {
+    uint64_t begin_ts = 0;
+    uint64_t end_ts = TS_INFINITY;
+};
+static_assert(sizeof(VersionHeader) == 16, "VersionHeader is on-disk format");
+
+// Multi-version view of a SlottedPage (newest-to-oldest, delta store).
+// - The newest version of each row lives in the page, in the row's slot, so
+//   the slot index is a stable row id and flushing the page persists it.
+// - Superseded versions move to an in-memory undo chain per slot. They are
+//   only needed by snapshots older than the update, none of which survive a
+//   restart, so the chains are never written out.
+// - Readers never latch the page (optimistic getRecord) and only touch the
+//   undo chains, under a short shared lock, when the newest version is too
+//   new for them. Writers serialize among themselves per page.
+// - collect_garbage() drops undo versions and deleted rows no open snapshot
+//   can see. It also runs automatically when an insert or update does not
+//   fit, so the page's own compaction can reclaim the dead rows' space.
+class VersionedPage {
+   public:
+    explicit VersionedPage(VersionClock &clock,
+                           std::unique_ptr<SlottedPage> page =
+                               std::make_unique<SlottedPage>());
+
+    VersionedPage(const VersionedPage &) = delete;
+    VersionedPage &operator=(const VersionedPage &) = delete;
+
+    // Each write commits on its own and returns false if it does not fit or
+    // the row does not exist (or is already deleted).
+    bool insert(const Tuple &tuple, size_t &slot);
+    bool update(size_t slot, const Tuple &tuple);
+    bool remove(size_t slot);
+
+    // Read the version of row 'slot' visible at snapshot 'ts'.
+    bool read(size_t slot, uint64_t ts, Tuple &out) const;
+
+    // Returns the number of versions (undo entries and deleted rows)
+    // reclaimed.
+    size_t collect_garbage();
+
+    // Number of superseded versions currently kept in the undo chains.
+    size_t undo_versions() const;
+
+    // The underlying page, e.g. for StorageManager::flush.
+    SlottedPage &page() noexcept {
+        return *page_;
+    }
+
+   private:
+    struct UndoVersion {
+        uint64_t begin_ts;
+        uint64_t end_ts;
+        std::string tuple_bytes;
+    };
+
+    static std::string encode_(const VersionHeader &h, std::string_view tuple);
+    static bool decode_(std::string_view record, VersionHeader &h);
+    static bool deserialize_(std::string_view tuple_bytes, Tuple &out);
+    size_t collect_locked_();
+
+    VersionClock &clock_;
+    std::unique_ptr<SlottedPage> page_;
+    std::mutex write_mutex_;
+    mutable std::shared_mutex undo_mutex_;
+    // Per slot, oldest first.
+    std::unordered_map<size_t, std::vector<UndoVersion>> undo_;
+};
+
+}  // namespace srd::storage
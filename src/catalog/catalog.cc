@@ -0,0 +1,342 @@
+#include "srd/catalog/catalog.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include "srd/common/checksum.hpp"
+
+namespace srd::catalog {
+
+using srd::common::crc32c;
+using srd::record::FieldType;
+using srd::storage::PAGE_SIZE;
+using srd::storage::SlottedPage;
+
+namespace {
+
+constexpr uint64_t SUPER_MAGIC = 0x474c544143445253ULL;  // "SRDCATLG"
+constexpr uint32_t SUPER_VERSION = 1;
+constexpr uint64_t SUPER_PAGES = 2;
+
+template <typename T>
+void put(std::string &out, const T &v) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+void put_string(std::string &out, std::string_view s) {
+    put(out, static_cast<uint32_t>(s.size()));
+    out.append(s);
+}
+
+// Bounds-checked reader over a serialized blob.
+class Cursor {
+   public:
+    explicit Cursor(std::string_view bytes) : bytes_(bytes) {}
+
+    template <typename T>
+    T get() {
+        T v;
+        std::memcpy(&v, take_(sizeof(T)), sizeof(T));
+        return v;
+    }
+
+    std::string get_string() {
+        const auto len = get<uint32_t>();
+        return std::string(take_(len), len);
+    }
+
+    bool done() const noexcept {
+        return pos_ == bytes_.size();
+    }
+
+   private:
+    const char *take_(std::size_t n) {
+        if (n > bytes_.size() - pos_) {
+            throw std::runtime_error("Catalog: truncated catalog");
+        }
+        const char *p = bytes_.data() + pos_;
+        pos_ += n;
+        return p;
+    }
+
+    std::string_view bytes_;
+    std::size_t pos_ = 0;
+};
+
+// Catalog blob: table count, then per table its name, path, schema
+// (name, type), root page, free-space summary and indexes.
+std::string serialize(const std::map<std::string, TableDef, std::less<>> &t) {
+    std::string out;
+    put(out, static_cast<uint32_t>(t.size()));
+    for (const auto &[name, table] : t) {
+        put_string(out, name);
+        put_string(out, table.path);
+        put(out, static_cast<uint32_t>(table.schema.size()));
+        for (const auto &col : table.schema) {
+            put_string(out, col.name);
+            put(out, static_cast<uint8_t>(col.type));
+        }
+        put(out, table.root_page);
+        put(out, table.free_space.pages);
+        put(out, table.free_space.free_bytes);
+        put(out, table.free_space.first_free_page);
+        put(out, static_cast<uint32_t>(table.indexes.size()));
+        for (const auto &idx : table.indexes) {
+            put_string(out, idx.name);
+            put_string(out, idx.kind);
+            put(out, idx.column);
+            put(out, idx.root_page);
+        }
+    }
+    return out;
+}
+
+std::map<std::string, TableDef, std::less<>> deserialize(
+    std::string_view bytes) {
+    std::map<std::string, TableDef, std::less<>> tables;
+    Cursor in(bytes);
+    const auto count = in.get<uint32_t>();
+    for (uint32_t i = 0; i < count; ++i) {
+        TableDef table;
+        table.name = in.get_string();
+        table.path = in.get_string();
+        const auto ncols = in.get<uint32_t>();
+        for (uint32_t c = 0; c < ncols; ++c) {
+            ColumnDef col;
+            col.name = in.get_string();
+            const auto type = in.get<uint8_t>();
+            if (type > static_cast<uint8_t>(FieldType::STRING)) {
+                throw std::runtime_error("Catalog: bad column type");
+            }
+            col.type = static_cast<FieldType>(type);
+            table.schema.push_back(std::move(col));
+        }
+        table.root_page = in.get<uint64_t>();
+        table.free_space.pages = in.get<uint64_t>();
+        table.free_space.free_bytes = in.get<uint64_t>();
+        table.free_space.first_free_page = in.get<uint64_t>();
+        const auto nidx = in.get<uint32_t>();
+        for (uint32_t x = 0; x < nidx; ++x) {
+            IndexDef idx;
+            idx.name = in.get_string();
+            idx.kind = in.get_string();
+            idx.column = in.get<uint32_t>();
+            idx.root_page = in.get<uint64_t>();
+            table.indexes.push_back(std::move(idx));
+        }
+        std::string key = table.name;
+        tables.emplace(std::move(key), std::move(table));
+    }
+    if (!in.done()) throw std::runtime_error("Catalog: trailing bytes");
+    return tables;
+}
+
+bool all_zero(const char *p, std::size_t n) {
+    return std::all_of(p, p + n, [](char c) { return c == 0; });
+}
+
+}  // namespace
+
+Catalog::Catalog(storage::StorageManager &sm) : sm_(sm) {
+    Superblock copies[SUPER_PAGES];
+    bool valid[SUPER_PAGES] = {};
+    for (uint64_t i = 0; i < SUPER_PAGES && i < sm_.num_pages(); ++i) {
+        valid[i] = read_superblock_(i, copies[i]);
+    }
+
+    if (!valid[0] && !valid[1]) {
+        const bool blank = sm_.num_pages() == 1 &&
+                           all_zero(sm_.load(0)->raw_data(), PAGE_SIZE);
+        if (!blank) {
+            throw std::runtime_error("Catalog: no valid superblock in " +
+                                     sm_.path());
+        }
+        // Format: an empty catalog needs no blob pages.
+        sm_.extend_to(SUPER_PAGES - 1);
+        current_.generation = 1;
+        write_superblock_(current_);
+        sm_.sync();
+        spdlog::info("Catalog: formatted '{}'", sm_.path());
+        return;
+    }
+
+    // Newest copy first. Fall back to the older one only if the newest
+    // blob does not check out; its extent is untouched until the next
+    // commit reuses it.
+    std::size_t order[SUPER_PAGES] = {0, 1};
+    if (!valid[0] ||
+        (valid[1] && copies[1].generation > copies[0].generation)) {
+        std::swap(order[0], order[1]);
+    }
+    for (std::size_t i : order) {
+        if (!valid[i]) continue;
+        try {
+            load_catalog_(copies[i]);
+            current_ = copies[i];
+            spdlog::info("Catalog: opened '{}', generation={}, tables={}",
+                         sm_.path(), current_.generation, tables_.size());
+            return;
+        } catch (const std::exception &e) {
+            spdlog::warn("Catalog: generation {} unusable: {}",
+                         copies[i].generation, e.what());
+        }
+    }
+    throw std::runtime_error("Catalog: catalog is corrupt in " + sm_.path());
+}
+
+// Superblock page: magic, format version, page size, generation, catalog
+// extent (first, pages, bytes, crc), spare extent (first, pages), then the
+// CRC of all of the above. The rest of the page is zero.
+bool Catalog::read_superblock_(uint64_t page_id, Superblock &sb) {
+    const auto page = sm_.load(page_id);
+    Cursor in(std::string_view(page->raw_data(), PAGE_SIZE));
+    if (in.get<uint64_t>() != SUPER_MAGIC) return false;
+    if (in.get<uint32_t>() != SUPER_VERSION) return false;
+    if (in.get<uint32_t>() != PAGE_SIZE) return false;
+    sb.generation = in.get<uint64_t>();
+    sb.catalog_first = in.get<uint64_t>();
+    sb.catalog_pages = in.get<uint64_t>();
+    sb.catalog_bytes = in.get<uint64_t>();
+    sb.catalog_crc = in.get<uint32_t>();
+    sb.spare_first = in.get<uint64_t>();
+    sb.spare_pages = in.get<uint64_t>();
+    constexpr std::size_t body = 8 + 4 + 4 + 8 * 4 + 4 + 8 * 2;
+    const auto crc = in.get<uint32_t>();
+    return crc == crc32c(page->raw_data(), body);
+}
+
+void Catalog::write_superblock_(const Superblock &sb) {
+    std::string out;
+    put(out, SUPER_MAGIC);
+    put(out, SUPER_VERSION);
+    put(out, static_cast<uint32_t>(PAGE_SIZE));
+    put(out, sb.generation);
+    put(out, sb.catalog_first);
+    put(out, sb.catalog_pages);
+    put(out, sb.catalog_bytes);
+    put(out, sb.catalog_crc);
+    put(out, sb.spare_first);
+    put(out, sb.spare_pages);
+    put(out, crc32c(out.data(), out.size()));
+    // Alternate between the two copies so the previous one stays intact.
+    write_pages_(sb.generation % SUPER_PAGES, out);
+}
+
+void Catalog::load_catalog_(const Superblock &sb) {
+    if (sb.catalog_bytes > sb.catalog_pages * PAGE_SIZE) {
+        throw std::runtime_error("Catalog: bad catalog extent");
+    }
+    std::string bytes;
+    if (sb.catalog_bytes > 0) {
+        const auto used = (sb.catalog_bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+        const auto pages = sm_.load_range(sb.catalog_first, used);
+        bytes.reserve(used * PAGE_SIZE);
+        for (const auto &p : pages) bytes.append(p->raw_data(), PAGE_SIZE);
+        bytes.resize(sb.catalog_bytes);
+    }
+    if (crc32c(bytes.data(), bytes.size()) != sb.catalog_crc) {
+        throw std::runtime_error("Catalog: catalog checksum mismatch");
+    }
+    tables_ = bytes.empty() ? decltype(tables_){} : deserialize(bytes);
+}
+
+void Catalog::write_pages_(uint64_t first, const std::string &bytes) {
+    const std::size_t count = (bytes.size() + PAGE_SIZE - 1) / PAGE_SIZE;
+    std::vector<std::unique_ptr<SlottedPage>> pages;
+    std::vector<const SlottedPage *> ptrs;
+    for (std::size_t i = 0; i < count; ++i) {
+        auto page = std::make_unique<SlottedPage>();
+        const std::size_t off = i * PAGE_SIZE;
+        const std::size_t n = std::min(PAGE_SIZE, bytes.size() - off);
+        std::memset(page->raw_data(), 0, PAGE_SIZE);
+        std::memcpy(page->raw_data(), bytes.data() + off, n);
+        ptrs.push_back(page.get());
+        pages.push_back(std::move(page));
+    }
+    sm_.flush_range(first, ptrs);
+}
+
+const TableDef *Catalog::find(std::string_view name) const {
+    auto it = tables_.find(name);
+    return it == tables_.end() ? nullptr : &it->second;
+}
+
+std::vector<std::string> Catalog::table_names() const {
+    std::vector<std::string> names;
+    names.reserve(tables_.size());
+    for (const auto &[name, table] : tables_) names.push_back(name);
+    return names;
+}
+
+void Catalog::create_table(TableDef table) {
+    if (tables_.count(table.name) != 0) {
+        throw std::runtime_error("Catalog: table exists: " + table.name);
+    }
+    std::string key = table.name;
+    tables_.emplace(std::move(key), std::move(table));
+    dirty_ = true;
+}
+
+void Catalog::update_table(TableDef table) {
+    auto it = tables_.find(table.name);
+    if (it == tables_.end()) {
+        throw std::out_of_range("Catalog: no table: " + table.name);
+    }
+    it->second = std::move(table);
+    dirty_ = true;
+}
+
+void Catalog::drop_table(std::string_view name) {
+    auto it = tables_.find(name);
+    if (it == tables_.end()) {
+        throw std::out_of_range("Catalog: no table: " + std::string(name));
+    }
+    tables_.erase(it);
+    dirty_ = true;
+}
+
+void Catalog::commit() {
+    if (!dirty_) return;
+    const std::string blob = serialize(tables_);
+    const uint64_t needed = (blob.size() + PAGE_SIZE - 1) / PAGE_SIZE;
+
+    Superblock next;
+    next.generation = current_.generation + 1;
+    next.catalog_bytes = blob.size();
+    next.catalog_crc = crc32c(blob.data(), blob.size());
+    if (needed <= current_.spare_pages) {
+        next.catalog_first = current_.spare_first;
+        next.catalog_pages = current_.spare_pages;
+        next.spare_first = current_.catalog_first;
+        next.spare_pages = current_.catalog_pages;
+    } else {
+        // Grow at the end of the file, with slack so a growing catalog
+        // does not relocate on every commit. Of the two extents now free
+        // the larger is kept as the spare; the other is abandoned.
+        next.catalog_first = std::max<uint64_t>(sm_.num_pages(), SUPER_PAGES);
+        next.catalog_pages = needed + needed / 2;
+        sm_.extend_to(next.catalog_first + next.catalog_pages - 1);
+        const bool keep_current =
+            current_.catalog_pages >= current_.spare_pages;
+        next.spare_first =
+            keep_current ? current_.catalog_first : current_.spare_first;
+        next.spare_pages =
+            keep_current ? current_.catalog_pages : current_.spare_pages;
+    }
+
+    // Shadow write: the blob lands where no valid superblock points, and
+    // is durable before the superblock that publishes it is written.
+    write_pages_(next.catalog_first, blob);
+    sm_.sync();
+    write_superblock_(next);
+    sm_.sync();
+
+    current_ = next;
+    dirty_ = false;
+}
+
+}  // namespace srd::catalog
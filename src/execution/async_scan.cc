@@ -0,0 +1,104 @@
+#include "srd/execution/async_scan.hpp"
+
+#include <algorithm>
+
+namespace srd::execution {
+
+using srd::storage::MAX_SLOTS;
+using srd::storage::StorageManager;
+
+PageStream::PageStream(Scheduler &s, StorageManager &sm, std::uint64_t first,
+                       std::uint64_t end, std::size_t batch_pages,
+                       std::size_t prefetch)
+    : s_(s),
+      sm_(sm),
+      next_page_(first),
+      end_(end != 0 ? end : sm.num_pages()),
+      batch_pages_(std::max<std::size_t>(batch_pages, 1)),
+      prefetch_(std::max<std::size_t>(prefetch, 1)) {
+    while (inflight_.size() < prefetch_ && next_page_ < end_) issue_();
+}
+
+PageStream::~PageStream() {
+    for (auto &load : inflight_) {
+        std::unique_lock<std::mutex> lock(load->mutex);
+        load->cv.wait(lock, [&] { return load->ready; });
+    }
+}
+
+// Start reading the next batch. The job holds its own reference to the
+// Load, so it can finish even if the stream is gone by then.
+void PageStream::issue_() {
+    auto load = std::make_shared<Load>();
+    load->first = next_page_;
+    const std::size_t count = static_cast<std::size_t>(
+        std::min<std::uint64_t>(batch_pages_, end_ - next_page_));
+    next_page_ += count;
+    inflight_.push_back(load);
+
+    StorageManager &sm = sm_;
+    Scheduler &s = s_;
+    s_.post_io([load, &sm, &s, count] {
+        PageBatch pages;
+        std::exception_ptr error;
+        try {
+            pages = sm.load_range(load->first, count);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        std::coroutine_handle<> waiter;
+        {
+            std::lock_guard<std::mutex> lock(load->mutex);
+            load->pages = std::move(pages);
+            load->error = error;
+            load->ready = true;
+            waiter = std::exchange(load->waiter, nullptr);
+        }
+        load->cv.notify_all();
+        if (waiter) s.post(waiter);
+    });
+}
+
+bool PageStream::front_ready_() {
+    if (inflight_.empty()) return true;
+    std::lock_guard<std::mutex> lock(inflight_.front()->mutex);
+    return inflight_.front()->ready;
+}
+
+// Register 'h' to be resumed when the front batch lands. Returns false
+// (resume right away) if it landed in the meantime.
+bool PageStream::park_(std::coroutine_handle<> h) {
+    Load &load = *inflight_.front();
+    std::lock_guard<std::mutex> lock(load.mutex);
+    if (load.ready) return false;
+    load.waiter = h;
+    return true;
+}
+
+PageBatch PageStream::pop_() {
+    if (inflight_.empty()) return {};
+    auto load = std::move(inflight_.front());
+    inflight_.pop_front();
+    // Keep the pipeline full before handing the batch to the consumer.
+    if (next_page_ < end_) issue_();
+
+    std::lock_guard<std::mutex> lock(load->mutex);
+    if (load->error) std::rethrow_exception(load->error);
+    current_ = load->first;
+    return std::move(load->pages);
+}
+
+Task<bool> PageStream::next_records(std::vector<std::string> &out) {
+    out.clear();
+    PageBatch batch = co_await next();
+    if (batch.empty()) co_return false;
+    std::string rec;
+    for (const auto &page : batch) {
+        for (std::size_t slot = 0; slot < MAX_SLOTS; ++slot) {
+            if (page->getRecord(slot, rec)) out.push_back(rec);
+        }
+    }
+    co_return true;
+}
+
+}  // namespace srd::execution
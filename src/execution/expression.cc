@@ -0,0 +1,724 @@
+#include "srd/execution/expression.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace srd::execution {
+
+using srd::record::FieldType;
+
+namespace {
+
+// Rows per batch: column arrays of this length stay in L1/L2.
+constexpr std::size_t BATCH = 1024;
+constexpr std::size_t FIELD_HEADER = sizeof(uint8_t) + sizeof(uint32_t);
+
+bool is_number(ExprType t) {
+    return t == ExprType::INT || t == ExprType::FLOAT;
+}
+
+const char *type_name(ExprType t) {
+    switch (t) {
+        case ExprType::BOOL: return "BOOL";
+        case ExprType::INT: return "INT";
+        case ExprType::FLOAT: return "FLOAT";
+        case ExprType::STRING: return "STRING";
+    }
+    return "?";
+}
+
+// Result type of a binary op, or throws if the operands do not fit it.
+ExprType check_binary(ExprOp op, ExprType a, ExprType b) {
+    switch (op) {
+        case ExprOp::ADD:
+        case ExprOp::SUB:
+        case ExprOp::MUL:
+            if (is_number(a) && is_number(b)) {
+                return a == ExprType::INT && b == ExprType::INT
+                           ? ExprType::INT
+                           : ExprType::FLOAT;
+            }
+            break;
+        case ExprOp::EQ:
+        case ExprOp::NE:
+            if ((is_number(a) && is_number(b)) || a == b) {
+                return ExprType::BOOL;
+            }
+            break;
+        case ExprOp::LT:
+        case ExprOp::LE:
+        case ExprOp::GT:
+        case ExprOp::GE:
+            if ((is_number(a) && is_number(b)) ||
+                (a == ExprType::STRING && b == ExprType::STRING)) {
+                return ExprType::BOOL;
+            }
+            break;
+        case ExprOp::AND:
+        case ExprOp::OR:
+            if (a == ExprType::BOOL && b == ExprType::BOOL) {
+                return ExprType::BOOL;
+            }
+            break;
+        default: break;
+    }
+    throw std::runtime_error(std::string("Expr: operands ") + type_name(a) +
+                             " and " + type_name(b) +
+                             " do not fit the operator");
+}
+
+// ---- operators, shared by the batch kernels and constant folding ----
+
+// INT arithmetic wraps instead of overflowing.
+struct AddOp {
+    int64_t operator()(int64_t a, int64_t b) const {
+        return static_cast<int64_t>(static_cast<uint64_t>(a) +
+                                    static_cast<uint64_t>(b));
+    }
+    double operator()(double a, double b) const {
+        return a + b;
+    }
+};
+struct SubOp {
+    int64_t operator()(int64_t a, int64_t b) const {
+        return static_cast<int64_t>(static_cast<uint64_t>(a) -
+                                    static_cast<uint64_t>(b));
+    }
+    double operator()(double a, double b) const {
+        return a - b;
+    }
+};
+struct MulOp {
+    int64_t operator()(int64_t a, int64_t b) const {
+        return static_cast<int64_t>(static_cast<uint64_t>(a) *
+                                    static_cast<uint64_t>(b));
+    }
+    double operator()(double a, double b) const {
+        return a * b;
+    }
+};
+struct EqOp {
+    template <class T>
+    uint8_t operator()(const T &a, const T &b) const {
+        return a == b;
+    }
+};
+struct NeOp {
+    template <class T>
+    uint8_t operator()(const T &a, const T &b) const {
+        return a != b;
+    }
+};
+struct LtOp {
+    template <class T>
+    uint8_t operator()(const T &a, const T &b) const {
+        return a < b;
+    }
+};
+struct LeOp {
+    template <class T>
+    uint8_t operator()(const T &a, const T &b) const {
+        return a <= b;
+    }
+};
+struct GtOp {
+    template <class T>
+    uint8_t operator()(const T &a, const T &b) const {
+        return a > b;
+    }
+};
+struct GeOp {
+    template <class T>
+    uint8_t operator()(const T &a, const T &b) const {
+        return a >= b;
+    }
+};
+// Bitwise on 0/1 bytes: no short circuit, so no branch.
+struct AndOp {
+    uint8_t operator()(uint8_t a, uint8_t b) const {
+        return a & b;
+    }
+};
+struct OrOp {
+    uint8_t operator()(uint8_t a, uint8_t b) const {
+        return a | b;
+    }
+};
+
+// C++ value type of each ExprType.
+template <ExprType T>
+struct Repr;
+template <>
+struct Repr<ExprType::BOOL> {
+    using type = uint8_t;
+};
+template <>
+struct Repr<ExprType::INT> {
+    using type = int64_t;
+};
+template <>
+struct Repr<ExprType::FLOAT> {
+    using type = double;
+};
+template <>
+struct Repr<ExprType::STRING> {
+    using type = std::string_view;
+};
+
+// A step input or output: a column array in the frame, or a constant.
+struct Operand {
+    ExprType type = ExprType::BOOL;
+    bool scalar = false;
+    uint32_t slot = 0;
+    int64_t i = 0;
+    double d = 0.0;
+    std::string_view s;
+
+    template <class T>
+    T get() const {
+        if constexpr (std::is_same_v<T, uint8_t>) {
+            return static_cast<uint8_t>(i);
+        } else if constexpr (std::is_same_v<T, int64_t>) {
+            return i;
+        } else if constexpr (std::is_same_v<T, double>) {
+            return d;
+        } else {
+            return s;
+        }
+    }
+
+    template <class T>
+    void set(T v) {
+        scalar = true;
+        if constexpr (std::is_same_v<T, double>) {
+            d = v;
+        } else if constexpr (std::is_same_v<T, std::string_view>) {
+            s = v;
+        } else {
+            i = static_cast<int64_t>(v);
+        }
+    }
+};
+
+// Per-call scratch: one BATCH-long array per slot, pooled by type, plus
+// the row validity mask.
+struct Frame {
+    explicit Frame(const uint32_t (&slots)[4]) : valid(BATCH) {
+        bools.assign(slots[0], std::vector<uint8_t>(BATCH));
+        ints.assign(slots[1], std::vector<int64_t>(BATCH));
+        floats.assign(slots[2], std::vector<double>(BATCH));
+        strings.assign(slots[3], std::vector<std::string_view>(BATCH));
+    }
+
+    template <class T>
+    T *at(uint32_t slot) {
+        if constexpr (std::is_same_v<T, uint8_t>) {
+            return bools[slot].data();
+        } else if constexpr (std::is_same_v<T, int64_t>) {
+            return ints[slot].data();
+        } else if constexpr (std::is_same_v<T, double>) {
+            return floats[slot].data();
+        } else {
+            return strings[slot].data();
+        }
+    }
+
+    std::vector<uint8_t> valid;
+    std::vector<std::vector<uint8_t>> bools;
+    std::vector<std::vector<int64_t>> ints;
+    std::vector<std::vector<double>> floats;
+    std::vector<std::vector<std::string_view>> strings;
+};
+
+struct Step;
+using Kernel = void (*)(const Step &, Frame &, std::size_t);
+
+struct Step {
+    Kernel fn = nullptr;
+    Operand a;
+    Operand b;
+    uint32_t out = 0;
+};
+
+// ---- kernels: one loop each, specialized on types and constant sides ----
+
+template <class Op, class T, bool AS, bool BS>
+void binary_kernel(const Step &s, Frame &f, std::size_t n) {
+    using R = decltype(Op{}(std::declval<T>(), std::declval<T>()));
+    R *out = f.at<R>(s.out);
+    const Op op;
+    if constexpr (AS) {
+        const T a = s.a.get<T>();
+        const T *b = f.at<T>(s.b.slot);
+        for (std::size_t i = 0; i < n; ++i) out[i] = op(a, b[i]);
+    } else if constexpr (BS) {
+        const T *a = f.at<T>(s.a.slot);
+        const T b = s.b.get<T>();
+        for (std::size_t i = 0; i < n; ++i) out[i] = op(a[i], b);
+    } else {
+        const T *a = f.at<T>(s.a.slot);
+        const T *b = f.at<T>(s.b.slot);
+        for (std::size_t i = 0; i < n; ++i) out[i] = op(a[i], b[i]);
+    }
+}
+
+void not_kernel(const Step &s, Frame &f, std::size_t n) {
+    const uint8_t *a = f.at<uint8_t>(s.a.slot);
+    uint8_t *out = f.at<uint8_t>(s.out);
+    for (std::size_t i = 0; i < n; ++i) out[i] = a[i] ^ 1;
+}
+
+void to_float_kernel(const Step &s, Frame &f, std::size_t n) {
+    const int64_t *a = f.at<int64_t>(s.a.slot);
+    double *out = f.at<double>(s.out);
+    for (std::size_t i = 0; i < n; ++i) out[i] = static_cast<double>(a[i]);
+}
+
+template <class Op, class T>
+Kernel pick_kernel(bool a_scalar, bool b_scalar) {
+    if (a_scalar) return binary_kernel<Op, T, true, false>;
+    if (b_scalar) return binary_kernel<Op, T, false, true>;
+    return binary_kernel<Op, T, false, false>;
+}
+
+// Call f(Op{}) for the functor of a binary op.
+template <class F>
+decltype(auto) with_op(ExprOp op, F &&f) {
+    switch (op) {
+        case ExprOp::ADD: return f(AddOp{});
+        case ExprOp::SUB: return f(SubOp{});
+        case ExprOp::MUL: return f(MulOp{});
+        case ExprOp::EQ: return f(EqOp{});
+        case ExprOp::NE: return f(NeOp{});
+        case ExprOp::LT: return f(LtOp{});
+        case ExprOp::LE: return f(LeOp{});
+        case ExprOp::GT: return f(GtOp{});
+        case ExprOp::GE: return f(GeOp{});
+        case ExprOp::AND: return f(AndOp{});
+        case ExprOp::OR: return f(OrOp{});
+        default: break;
+    }
+    throw std::logic_error("CompiledExpr: not a binary op");
+}
+
+// Call f(T{}) for the representation of an operand type.
+template <class F>
+decltype(auto) with_repr(ExprType t, F &&f) {
+    switch (t) {
+        case ExprType::BOOL: return f(Repr<ExprType::BOOL>::type{});
+        case ExprType::INT: return f(Repr<ExprType::INT>::type{});
+        case ExprType::FLOAT: return f(Repr<ExprType::FLOAT>::type{});
+        case ExprType::STRING: return f(Repr<ExprType::STRING>::type{});
+    }
+    throw std::logic_error("CompiledExpr: bad type");
+}
+
+std::size_t pool_of(ExprType t) {
+    return static_cast<std::size_t>(t);
+}
+
+// Field of the record the expression reads, decoded into 'slot'.
+struct ColumnLoad {
+    std::size_t index = 0;
+    FieldType type = FieldType::INT;
+    uint32_t slot = 0;
+};
+
+}  // namespace
+
+struct CompiledExpr::Program {
+    // Sorted by field index, so a row is decoded in one forward walk.
+    std::vector<ColumnLoad> columns;
+    std::vector<Step> steps;
+    Operand result;
+    // Slots per type pool, indexed by ExprType.
+    uint32_t slots[4] = {};
+
+    Operand new_slot(ExprType t) {
+        Operand o;
+        o.type = t;
+        o.slot = slots[pool_of(t)]++;
+        return o;
+    }
+
+    Operand lower(const Expr &e) {
+        switch (e.op()) {
+            case ExprOp::CONSTANT: {
+                Operand o;
+                o.type = e.type();
+                o.scalar = true;
+                o.i = e.int_value();
+                o.d = e.float_value();
+                o.s = e.string_value();  // views the node, which expr_ owns
+                return o;
+            }
+            case ExprOp::COLUMN: return load(e);
+            case ExprOp::NOT: {
+                Operand a = lower(e.left());
+                if (a.scalar) {
+                    a.i ^= 1;
+                    return a;
+                }
+                Step s;
+                s.fn = not_kernel;
+                s.a = a;
+                const Operand out = new_slot(ExprType::BOOL);
+                s.out = out.slot;
+                steps.push_back(s);
+                return out;
+            }
+            default: break;
+        }
+
+        Operand a = lower(e.left());
+        Operand b = lower(e.right());
+        // Mixed INT/FLOAT: widen the INT side.
+        if (a.type != b.type) {
+            a = to_float(a);
+            b = to_float(b);
+        }
+        return with_op(e.op(), [&](auto op) -> Operand {
+            using Op = decltype(op);
+            return with_repr(a.type, [&](auto repr) -> Operand {
+                using T = decltype(repr);
+                if constexpr (std::is_invocable_v<Op, T, T>) {
+                    using R = std::invoke_result_t<Op, T, T>;
+                    if (a.scalar && b.scalar) {
+                        Operand out;
+                        out.type = e.type();
+                        out.set<R>(op(a.get<T>(), b.get<T>()));
+                        return out;
+                    }
+                    Step s;
+                    s.fn = pick_kernel<Op, T>(a.scalar, b.scalar);
+                    s.a = a;
+                    s.b = b;
+                    const Operand out = new_slot(e.type());
+                    s.out = out.slot;
+                    steps.push_back(s);
+                    return out;
+                } else {
+                    throw std::logic_error("CompiledExpr: unchecked types");
+                }
+            });
+        });
+    }
+
+    Operand to_float(const Operand &a) {
+        if (a.type != ExprType::INT) return a;
+        if (a.scalar) {
+            Operand o = a;
+            o.type = ExprType::FLOAT;
+            o.d = static_cast<double>(a.i);
+            return o;
+        }
+        Step s;
+        s.fn = to_float_kernel;
+        s.a = a;
+        const Operand out = new_slot(ExprType::FLOAT);
+        s.out = out.slot;
+        steps.push_back(s);
+        return out;
+    }
+
+    Operand load(const Expr &e) {
+        for (const auto &c : columns) {
+            if (c.index != e.column_index()) continue;
+            if (c.type != e.column_type()) {
+                throw std::runtime_error(
+                    "CompiledExpr: column " + std::to_string(c.index) +
+                    " is referenced with two types");
+            }
+            Operand o;
+            o.type = e.type();
+            o.slot = c.slot;
+            return o;
+        }
+        const Operand o = new_slot(e.type());
+        columns.push_back({e.column_index(), e.column_type(), o.slot});
+        return o;
+    }
+
+    // Decode the referenced fields of rows[0, n) into their slots and set
+    // frame.valid. A row missing a field, or holding another type there,
+    // is marked invalid and gets zero values.
+    void decode(const std::string_view *rows, std::size_t n,
+                Frame &f) const {
+        for (std::size_t r = 0; r < n; ++r) {
+            const std::string_view rec = rows[r];
+            if (rec.size() < sizeof(uint32_t)) {
+                throw std::runtime_error("CompiledExpr: record too short");
+            }
+            uint32_t count = 0;
+            std::memcpy(&count, rec.data(), sizeof(count));
+            uint8_t ok = 1;
+            std::size_t pos = sizeof(uint32_t);
+            std::size_t field = 0;
+            for (const ColumnLoad &c : columns) {
+                std::string_view payload;
+                uint8_t type = 0xff;
+                if (c.index < count) {
+                    // Walk forward to field c.index.
+                    for (;;) {
+                        if (pos + FIELD_HEADER > rec.size()) {
+                            throw std::runtime_error(
+                                "CompiledExpr: truncated field header");
+                        }
+                        uint32_t len = 0;
+                        std::memcpy(&len, rec.data() + pos + 1, sizeof(len));
+                        if (len > rec.size() - pos - FIELD_HEADER) {
+                            throw std::runtime_error(
+                                "CompiledExpr: truncated field payload");
+                        }
+                        if (field == c.index) {
+                            type = static_cast<uint8_t>(rec[pos]);
+                            payload = rec.substr(pos + FIELD_HEADER, len);
+                            break;
+                        }
+                        pos += FIELD_HEADER + len;
+                        ++field;
+                    }
+                }
+                const bool match = type == static_cast<uint8_t>(c.type);
+                switch (c.type) {
+                    case FieldType::INT: {
+                        int v = 0;
+                        const bool good = match && payload.size() == sizeof(v);
+                        if (good) std::memcpy(&v, payload.data(), sizeof(v));
+                        f.at<int64_t>(c.slot)[r] = v;
+                        ok &= good;
+                        break;
+                    }
+                    case FieldType::FLOAT: {
+                        float v = 0.0f;
+                        const bool good = match && payload.size() == sizeof(v);
+                        if (good) std::memcpy(&v, payload.data(), sizeof(v));
+                        f.at<double>(c.slot)[r] = v;
+                        ok &= good;
+                        break;
+                    }
+                    case FieldType::STRING: {
+                        // Without the trailing null terminator Field stores.
+                        if (!payload.empty() && payload.back() == '\0') {
+                            payload.remove_suffix(1);
+                        }
+                        f.at<std::string_view>(c.slot)[r] =
+                            match ? payload : std::string_view();
+                        ok &= match;
+                        break;
+                    }
+                }
+            }
+            f.valid[r] = ok;
+        }
+    }
+
+    // Decode and evaluate rows in batches, calling sink(base, n, frame)
+    // after each; the result is in 'result' (a slot or a constant).
+    template <class Sink>
+    void run(std::span<const std::string_view> rows, Sink &&sink) const {
+        Frame f(slots);
+        for (std::size_t base = 0; base < rows.size(); base += BATCH) {
+            const std::size_t n = std::min(BATCH, rows.size() - base);
+            decode(rows.data() + base, n, f);
+            for (const Step &s : steps) s.fn(s, f, n);
+            sink(base, n, f);
+        }
+    }
+};
+
+// ---- Expr ----
+
+Expr Expr::column(std::size_t index, FieldType type) {
+    auto n = std::make_shared<Node>();
+    n->op = ExprOp::COLUMN;
+    n->column = index;
+    n->field_type = type;
+    switch (type) {
+        case FieldType::INT: n->type = ExprType::INT; break;
+        case FieldType::FLOAT: n->type = ExprType::FLOAT; break;
+        case FieldType::STRING: n->type = ExprType::STRING; break;
+    }
+    return Expr(std::move(n));
+}
+
+Expr Expr::constant(int value) {
+    return constant(static_cast<std::int64_t>(value));
+}
+
+Expr Expr::constant(std::int64_t value) {
+    auto n = std::make_shared<Node>();
+    n->type = ExprType::INT;
+    n->int_value = value;
+    return Expr(std::move(n));
+}
+
+Expr Expr::constant(double value) {
+    auto n = std::make_shared<Node>();
+    n->type = ExprType::FLOAT;
+    n->float_value = value;
+    return Expr(std::move(n));
+}
+
+Expr Expr::constant(std::string value) {
+    auto n = std::make_shared<Node>();
+    n->type = ExprType::STRING;
+    n->string_value = std::move(value);
+    return Expr(std::move(n));
+}
+
+Expr Expr::constant(bool value) {
+    auto n = std::make_shared<Node>();
+    n->type = ExprType::BOOL;
+    n->int_value = value ? 1 : 0;
+    return Expr(std::move(n));
+}
+
+Expr Expr::binary(ExprOp op, Expr a, Expr b) {
+    auto n = std::make_shared<Node>();
+    n->op = op;
+    n->type = check_binary(op, a.type(), b.type());
+    n->args.push_back(std::move(a));
+    n->args.push_back(std::move(b));
+    return Expr(std::move(n));
+}
+
+Expr Expr::add(Expr a, Expr b) {
+    return binary(ExprOp::ADD, std::move(a), std::move(b));
+}
+Expr Expr::sub(Expr a, Expr b) {
+    return binary(ExprOp::SUB, std::move(a), std::move(b));
+}
+Expr Expr::mul(Expr a, Expr b) {
+    return binary(ExprOp::MUL, std::move(a), std::move(b));
+}
+Expr Expr::eq(Expr a, Expr b) {
+    return binary(ExprOp::EQ, std::move(a), std::move(b));
+}
+Expr Expr::ne(Expr a, Expr b) {
+    return binary(ExprOp::NE, std::move(a), std::move(b));
+}
+Expr Expr::lt(Expr a, Expr b) {
+    return binary(ExprOp::LT, std::move(a), std::move(b));
+}
+Expr Expr::le(Expr a, Expr b) {
+    return binary(ExprOp::LE, std::move(a), std::move(b));
+}
+Expr Expr::gt(Expr a, Expr b) {
+    return binary(ExprOp::GT, std::move(a), std::move(b));
+}
+Expr Expr::ge(Expr a, Expr b) {
+    return binary(ExprOp::GE, std::move(a), std::move(b));
+}
+Expr Expr::logical_and(Expr a, Expr b) {
+    return binary(ExprOp::AND, std::move(a), std::move(b));
+}
+Expr Expr::logical_or(Expr a, Expr b) {
+    return binary(ExprOp::OR, std::move(a), std::move(b));
+}
+
+Expr Expr::logical_not(Expr a) {
+    if (a.type() != ExprType::BOOL) {
+        throw std::runtime_error(std::string("Expr: NOT of ") +
+                                 type_name(a.type()));
+    }
+    auto n = std::make_shared<Node>();
+    n->op = ExprOp::NOT;
+    n->type = ExprType::BOOL;
+    n->args.push_back(std::move(a));
+    return Expr(std::move(n));
+}
+
+const Expr &Expr::left() const {
+    if (node_->args.empty()) throw std::out_of_range("Expr: no operands");
+    return node_->args[0];
+}
+
+const Expr &Expr::right() const {
+    if (node_->args.size() < 2) throw std::out_of_range("Expr: not binary");
+    return node_->args[1];
+}
+
+// ---- CompiledExpr ----
+
+CompiledExpr::CompiledExpr(Expr expr)
+    : expr_(std::move(expr)), program_(std::make_unique<Program>()) {
+    program_->result = program_->lower(expr_);
+    std::sort(program_->columns.begin(), program_->columns.end(),
+              [](const ColumnLoad &a, const ColumnLoad &b) {
+                  return a.index < b.index;
+              });
+}
+
+CompiledExpr::~CompiledExpr() = default;
+CompiledExpr::CompiledExpr(CompiledExpr &&) noexcept = default;
+CompiledExpr &CompiledExpr::operator=(CompiledExpr &&) noexcept = default;
+
+void CompiledExpr::evaluate(std::span<const std::string_view> rows,
+                            ExprColumn &out) const {
+    out.type = type();
+    out.valid.resize(rows.size());
+    out.bools.clear();
+    out.ints.clear();
+    out.floats.clear();
+    out.strings.clear();
+    const Operand &res = program_->result;
+    with_repr(type(), [&](auto repr) {
+        using T = decltype(repr);
+        std::vector<T> *values = nullptr;
+        if constexpr (std::is_same_v<T, uint8_t>) {
+            values = &out.bools;
+        } else if constexpr (std::is_same_v<T, int64_t>) {
+            values = &out.ints;
+        } else if constexpr (std::is_same_v<T, double>) {
+            values = &out.floats;
+        } else {
+            values = &out.strings;
+        }
+        values->resize(rows.size());
+        program_->run(rows, [&](std::size_t base, std::size_t n, Frame &f) {
+            std::copy_n(f.valid.data(), n, out.valid.data() + base);
+            if (res.scalar) {
+                std::fill_n(values->data() + base, n, res.get<T>());
+            } else {
+                std::copy_n(f.at<T>(res.slot), n, values->data() + base);
+            }
+        });
+    });
+}
+
+std::size_t CompiledExpr::filter(std::span<const std::string_view> rows,
+                                 std::vector<uint32_t> &selected) const {
+    if (type() != ExprType::BOOL) {
+        throw std::runtime_error(
+            "CompiledExpr::filter needs a BOOL expression");
+    }
+    const Operand &res = program_->result;
+    const std::size_t first = selected.size();
+    std::size_t k = first;
+    selected.resize(first + rows.size());
+    uint32_t *sel = selected.data();
+    program_->run(rows, [&](std::size_t base, std::size_t n, Frame &f) {
+        const uint8_t *valid = f.valid.data();
+        if (res.scalar) {
+            const auto c = static_cast<uint8_t>(res.i);
+            for (std::size_t i = 0; i < n; ++i) {
+                sel[k] = static_cast<uint32_t>(base + i);
+                k += valid[i] & c;
+            }
+        } else {
+            const uint8_t *hit = f.at<uint8_t>(res.slot);
+            // Write every index, advance only on a hit: no branch.
+            for (std::size_t i = 0; i < n; ++i) {
+                sel[k] = static_cast<uint32_t>(base + i);
+                k += valid[i] & hit[i];
+            }
+        }
+    });
+    selected.resize(k);
+    return k - first;
+}
+
+}  // namespace srd::execution
@@ -0,0 +1,304 @@
+#include "srd/execution/external_sort.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "srd/common/temp_path.hpp"
+#include "srd/execution/parallel_scan.hpp"
+#include "srd/record/key_encoder.hpp"
+#include "srd/record/tuple_view.hpp"
+#include "srd/storage/record_stream.hpp"
+
+namespace srd::execution {
+
+using srd::common::temp_path;
+using srd::record::KeyColumn;
+using srd::record::KeyEncoder;
+using srd::record::TupleView;
+using srd::storage::RecordReader;
+using srd::storage::RecordWriter;
+using srd::storage::StorageManager;
+
+namespace {
+
+// In-memory sort entry: the first 8 bytes of the normalized key and where
+// the key and record sit in the arena (key bytes, then record bytes).
+// 24 bytes, so sorting moves entries, never records; most comparisons are
+// decided by the prefix alone. The 32-bit offsets are why an arena is
+// capped at MAX_ARENA bytes.
+struct Entry {
+    uint64_t prefix;
+    uint32_t offset;
+    uint32_t key_length;
+    uint32_t length;
+};
+
+constexpr std::size_t MAX_ARENA = std::numeric_limits<uint32_t>::max();
+
+// Tournament tree of losers over k sources. less(a, b) says whether source
+// a's current item goes first; exhausted sources must never be less.
+template <typename Less>
+class LoserTree {
+   public:
+    LoserTree(std::size_t k, Less less) : k_(k), tree_(k), less_(less) {
+        if (k_ == 0) return;
+        std::vector<std::size_t> win(2 * k_);
+        for (std::size_t i = 0; i < k_; ++i) win[k_ + i] = i;
+        for (std::size_t n = k_ - 1; n >= 1; --n) {
+            const std::size_t a = win[2 * n], b = win[2 * n + 1];
+            const bool a_first = less_(a, b);
+            win[n] = a_first ? a : b;
+            tree_[n] = a_first ? b : a;
+        }
+        tree_[0] = (k_ == 1) ? 0 : win[1];
+    }
+
+    std::size_t winner() const noexcept {
+        return tree_[0];
+    }
+
+    // Re-seat the winner after its source advanced.
+    void replay() {
+        std::size_t w = tree_[0];
+        for (std::size_t n = (w + k_) / 2; n >= 1; n /= 2) {
+            if (less_(tree_[n], w)) std::swap(tree_[n], w);
+        }
+        tree_[0] = w;
+    }
+
+   private:
+    std::size_t k_;
+    std::vector<std::size_t> tree_;
+    Less less_;
+};
+
+// One sorted run being read back during a merge.
+struct RunCursor {
+    RunCursor(const std::string &path, const KeyEncoder &encoder,
+              std::size_t read_ahead)
+        : sm(std::make_unique<StorageManager>(path)),
+          reader(*sm, 0, 0, read_ahead),
+          encoder(encoder) {
+        advance();
+    }
+
+    void advance() {
+        done = !reader.next(record);
+        if (!done) encoder.encode(TupleView(record), key);
+    }
+
+    std::unique_ptr<StorageManager> sm;
+    RecordReader reader;
+    const KeyEncoder &encoder;
+    std::string record;
+    std::string key;
+    bool done = false;
+};
+
+// Owns every run file it hands out: the ones not merged away yet are
+// removed when the job goes away, also when a sort is abandoned by an
+// exception.
+class SortJob {
+   public:
+    explicit SortJob(const ExternalSortOptions &o)
+        : o_(o), encoder_(o.keys.empty()
+                              ? std::vector<KeyColumn>{{o.column}}
+                              : o.keys) {}
+
+    SortJob(const SortJob &) = delete;
+    SortJob &operator=(const SortJob &) = delete;
+
+    ~SortJob() {
+        for (const auto &p : files_) {
+            std::error_code ec;
+            std::filesystem::remove(p, ec);
+        }
+    }
+
+    // Name for a new run file, removed by merge() or the destructor.
+    std::string new_run_path() {
+        std::string path = temp_path(o_.temp_dir, "sort");
+        std::lock_guard<std::mutex> lock(runs_mutex_);
+        files_.insert(path);
+        return path;
+    }
+
+    // Per-worker run buffer: record bytes plus their sort entries.
+    struct Arena {
+        std::string bytes;
+        std::vector<Entry> entries;
+        std::string key;  // scratch for the record being added
+    };
+
+    // Add one record, first spilling the arena as a run if the record
+    // would push it past 'budget' bytes.
+    void add(Arena &a, std::string_view rec, std::size_t budget) {
+        encoder_.encode(TupleView(rec), a.key);
+        const std::size_t footprint = a.bytes.size() + a.key.size() +
+                                      rec.size() +
+                                      (a.entries.size() + 1) * sizeof(Entry);
+        if (footprint > budget && !a.entries.empty()) spill(a);
+        a.entries.push_back(Entry{KeyEncoder::prefix(a.key),
+                                  static_cast<uint32_t>(a.bytes.size()),
+                                  static_cast<uint32_t>(a.key.size()),
+                                  static_cast<uint32_t>(rec.size())});
+        a.bytes.append(a.key);
+        a.bytes.append(rec);
+    }
+
+    // Merge 'paths' into 'out'; the run files are removed afterwards.
+    void merge(const std::vector<std::string> &paths, RecordWriter &out,
+               std::size_t read_ahead) {
+        std::vector<std::unique_ptr<RunCursor>> cursors;
+        cursors.reserve(paths.size());
+        for (const auto &p : paths) {
+            cursors.push_back(
+                std::make_unique<RunCursor>(p, encoder_, read_ahead));
+        }
+        auto less = [&](std::size_t a, std::size_t b) {
+            const RunCursor &x = *cursors[a], &y = *cursors[b];
+            if (x.done || y.done) return !x.done && y.done;
+            const int c = KeyEncoder::compare(x.key, y.key);
+            return c < 0 || (c == 0 && a < b);
+        };
+        LoserTree<decltype(less)> tree(cursors.size(), less);
+        for (;;) {
+            RunCursor &c = *cursors[tree.winner()];
+            if (c.done) break;
+            out.append(c.record);
+            c.advance();
+            tree.replay();
+        }
+        cursors.clear();
+        for (const auto &p : paths) {
+            std::filesystem::remove(p);
+            std::lock_guard<std::mutex> lock(runs_mutex_);
+            files_.erase(p);
+        }
+    }
+
+    std::vector<std::string> take_runs() {
+        std::lock_guard<std::mutex> lock(runs_mutex_);
+        return std::move(runs_);
+    }
+
+    // Sort the arena's entries and write its records out as one run.
+    void spill(Arena &a) {
+        if (a.entries.empty()) return;
+        const std::string &arena = a.bytes;
+        std::vector<Entry> &entries = a.entries;
+        std::sort(entries.begin(), entries.end(),
+                  [&](const Entry &x, const Entry &y) {
+                      if (x.prefix != y.prefix) return x.prefix < y.prefix;
+                      if (x.key_length <= 8 && y.key_length <= 8) {
+                          return false;
+                      }
+                      return KeyEncoder::compare(
+                                 std::string_view(arena.data() + x.offset,
+                                                  x.key_length),
+                                 std::string_view(arena.data() + y.offset,
+                                                  y.key_length)) < 0;
+                  });
+
+        const std::string path = new_run_path();
+        {
+            StorageManager run(path);
+            RecordWriter w(run, 0, o_.read_ahead_pages);
+            for (const Entry &e : entries) {
+                w.append(std::string_view(
+                    arena.data() + e.offset + e.key_length, e.length));
+            }
+            w.finish();
+        }
+        {
+            std::lock_guard<std::mutex> lock(runs_mutex_);
+            runs_.push_back(path);
+        }
+        a.bytes.clear();
+        a.entries.clear();
+    }
+
+   private:
+    const ExternalSortOptions &o_;
+    KeyEncoder encoder_;
+    std::mutex runs_mutex_;
+    std::vector<std::string> runs_;
+    // Run files that still exist, guarded by runs_mutex_.
+    std::set<std::string> files_;
+};
+
+}  // namespace
+
+ExternalSort::ExternalSort(ExternalSortOptions options)
+    : options_(std::move(options)) {}
+
+ExternalSortStats ExternalSort::sort(StorageManager &input,
+                                     StorageManager &output) {
+    ExternalSortStats stats;
+    SortJob job(options_);
+
+    // ---- run generation, one contiguous page share per thread ----
+    const std::size_t threads =
+        resolve_threads(options_.threads, input.num_pages());
+    const std::size_t budget = std::min(
+        std::max<std::size_t>(options_.memory_budget / threads,
+                              storage::PAGE_SIZE),
+        MAX_ARENA);
+    std::vector<SortJob::Arena> arenas(threads);
+    stats.records = parallel_scan(
+        input, threads, options_.read_ahead_pages,
+        [&](std::size_t t, std::string_view rec) {
+            job.add(arenas[t], rec, budget);
+        },
+        [&](std::size_t t) { job.spill(arenas[t]); });
+
+    std::vector<std::string> runs = job.take_runs();
+    stats.initial_runs = runs.size();
+    if (runs.empty()) return stats;
+
+    // ---- merge ----
+    // Every open run holds read_ahead pages; keep that within the budget.
+    const std::size_t read_ahead = std::max<std::size_t>(
+        options_.read_ahead_pages, 1);
+    const std::size_t fan_in = std::max<std::size_t>(
+        2, std::min(options_.max_fan_in,
+                    options_.memory_budget /
+                        (read_ahead * storage::PAGE_SIZE)));
+
+    while (runs.size() > fan_in) {
+        std::vector<std::string> next;
+        for (std::size_t i = 0; i < runs.size(); i += fan_in) {
+            const auto last = std::min(runs.size(), i + fan_in);
+            std::vector<std::string> group(runs.begin() + i,
+                                           runs.begin() + last);
+            if (group.size() == 1) {
+                next.push_back(group.front());
+                continue;
+            }
+            const std::string path = job.new_run_path();
+            {
+                StorageManager run(path);
+                RecordWriter w(run, 0, read_ahead);
+                job.merge(group, w, read_ahead);
+                w.finish();
+            }
+            next.push_back(path);
+        }
+        runs = std::move(next);
+        ++stats.merge_passes;
+    }
+
+    RecordWriter out(output, 0, read_ahead);
+    job.merge(runs, out, read_ahead);
+    stats.output_pages = out.finish();
+    ++stats.merge_passes;
+    return stats;
+}
+
+}  // namespace srd::execution
@@ -0,0 +1,723 @@
+#include "srd/execution/hash_aggregate.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "srd/common/hash.hpp"
+#include "srd/common/temp_path.hpp"
+#include "srd/execution/parallel_scan.hpp"
+#include "srd/storage/record_stream.hpp"
+
+namespace srd::execution {
+
+using srd::common::hash_bytes;
+using srd::common::temp_path;
+using srd::record::FieldType;
+using srd::record::TupleView;
+using srd::storage::RecordReader;
+using srd::storage::RecordWriter;
+using srd::storage::StorageManager;
+
+namespace {
+
+constexpr std::size_t MAX_PARTITIONS = 1024;
+// Rows buffered before the accumulators are updated in one pass.
+constexpr std::size_t BATCH = 256;
+constexpr std::size_t FIELD_HEADER = sizeof(uint8_t) + sizeof(uint32_t);
+constexpr uint32_t NO_GROUP = std::numeric_limits<uint32_t>::max();
+// Bytes of one aggregate's state per group: int count and value, float
+// count and value.
+constexpr std::size_t STATE_BYTES = 32;
+// Phase 2: how deep an oversized partition is split again, and into how
+// many sub-partitions each time.
+constexpr unsigned MAX_LEVELS = 4;
+constexpr std::size_t SUB_PARTITIONS = 16;
+
+// Identity element of each op, so rows without a value can go through the
+// same update as rows with one.
+constexpr int64_t int_identity(AggregateOp op) {
+    switch (op) {
+        case AggregateOp::MIN: return std::numeric_limits<int64_t>::max();
+        case AggregateOp::MAX: return std::numeric_limits<int64_t>::min();
+        default: return 0;
+    }
+}
+
+constexpr double float_identity(AggregateOp op) {
+    switch (op) {
+        case AggregateOp::MIN: return std::numeric_limits<double>::infinity();
+        case AggregateOp::MAX: return -std::numeric_limits<double>::infinity();
+        default: return 0.0;
+    }
+}
+
+// Serialize the group-by fields of 'rec' into 'key' in Tuple layout, so the
+// key bytes compare and hash as the group identity and read back through
+// TupleView. Returns false if a column is missing.
+bool build_key(std::string_view rec, const std::vector<std::size_t> &columns,
+               std::string &key) {
+    const TupleView view(rec);
+    const auto count = static_cast<uint32_t>(columns.size());
+    key.assign(reinterpret_cast<const char *>(&count), sizeof(count));
+    for (std::size_t c : columns) {
+        if (c >= view.size()) return false;
+        const auto f = view.field(c);
+        key.append(f.payload.data() - FIELD_HEADER,
+                   FIELD_HEADER + f.payload.size());
+    }
+    return true;
+}
+
+// Partial state of one aggregate, kept column-wise across groups so batch
+// updates walk flat arrays. COUNT keeps its rows in int_count.
+struct Accumulator {
+    std::vector<uint64_t> int_count;
+    std::vector<int64_t> int_value;
+    std::vector<uint64_t> float_count;
+    std::vector<double> float_value;
+
+    void push(AggregateOp op) {
+        int_count.push_back(0);
+        int_value.push_back(int_identity(op));
+        float_count.push_back(0);
+        float_value.push_back(float_identity(op));
+    }
+
+    void clear() {
+        int_count.clear();
+        int_value.clear();
+        float_count.clear();
+        float_value.clear();
+    }
+};
+
+// Fold one partial state into group g.
+void combine(AggregateOp op, Accumulator &acc, uint32_t g, uint64_t ic,
+             int64_t iv, uint64_t fc, double fv) {
+    acc.int_count[g] += ic;
+    acc.float_count[g] += fc;
+    switch (op) {
+        case AggregateOp::COUNT: break;
+        case AggregateOp::SUM:
+            acc.int_value[g] += iv;
+            acc.float_value[g] += fv;
+            break;
+        case AggregateOp::MIN:
+            acc.int_value[g] = std::min(acc.int_value[g], iv);
+            acc.float_value[g] = std::min(acc.float_value[g], fv);
+            break;
+        case AggregateOp::MAX:
+            acc.int_value[g] = std::max(acc.int_value[g], iv);
+            acc.float_value[g] = std::max(acc.float_value[g], fv);
+            break;
+    }
+}
+
+// Open-addressing group table (linear probing, 8-byte slots with a hash
+// tag). With a group limit it never grows and reports when it is full;
+// without one it doubles at half load.
+class GroupTable {
+   public:
+    GroupTable(const std::vector<AggregateSpec> &specs, std::size_t limit)
+        : specs_(specs), limit_(limit), acc_(specs.size()) {
+        resize_(std::bit_ceil(std::max<std::size_t>(16, limit * 2)));
+    }
+
+    std::size_t size() const noexcept {
+        return hashes_.size();
+    }
+
+    // Index of the group with this key, inserting it if needed. NO_GROUP
+    // if the key is new and the table is at its limit.
+    uint32_t find_or_insert(std::string_view key, uint64_t hash) {
+        const uint32_t tag = static_cast<uint32_t>(hash);
+        std::size_t idx = index_(hash);
+        for (; slots_[idx].ref != 0; idx = (idx + 1) & mask_) {
+            if (slots_[idx].tag != tag) continue;
+            const uint32_t g = slots_[idx].ref - 1;
+            if (hashes_[g] == hash && this->key(g) == key) return g;
+        }
+        if (limit_ != 0 && size() >= limit_) return NO_GROUP;
+
+        const auto g = static_cast<uint32_t>(size());
+        slots_[idx] = Slot{tag, g + 1};
+        hashes_.push_back(hash);
+        key_offsets_.push_back(static_cast<uint32_t>(keys_.size()));
+        keys_.append(key);
+        for (std::size_t a = 0; a < specs_.size(); ++a) {
+            acc_[a].push(specs_[a].op);
+        }
+        if (limit_ == 0 && size() * 2 > slots_.size()) {
+            resize_(slots_.size() * 2);
+        }
+        return g;
+    }
+
+    std::string_view key(uint32_t g) const {
+        const uint32_t end = g + 1 < key_offsets_.size()
+                                 ? key_offsets_[g + 1]
+                                 : static_cast<uint32_t>(keys_.size());
+        return std::string_view(keys_).substr(key_offsets_[g],
+                                              end - key_offsets_[g]);
+    }
+
+    uint64_t hash(uint32_t g) const {
+        return hashes_[g];
+    }
+
+    // Approximate heap bytes held: slots, per-group bookkeeping and
+    // accumulators, and keys.
+    std::size_t memory_bytes() const noexcept {
+        return slots_.size() * sizeof(Slot) +
+               hashes_.size() * (sizeof(uint64_t) + sizeof(uint32_t) +
+                                 acc_.size() * STATE_BYTES) +
+               keys_.size();
+    }
+
+    Accumulator &acc(std::size_t a) {
+        return acc_[a];
+    }
+
+    void clear() {
+        std::fill(slots_.begin(), slots_.end(), Slot{0, 0});
+        hashes_.clear();
+        key_offsets_.clear();
+        keys_.clear();
+        for (auto &a : acc_) a.clear();
+    }
+
+   private:
+    struct Slot {
+        uint32_t tag;
+        uint32_t ref;  // group index + 1, 0 = empty
+    };
+
+    // High bits: the low ones pick the partition.
+    std::size_t index_(uint64_t hash) const noexcept {
+        return static_cast<std::size_t>(hash >> 32) & mask_;
+    }
+
+    void resize_(std::size_t slots) {
+        slots_.assign(slots, Slot{0, 0});
+        mask_ = slots - 1;
+        for (uint32_t g = 0; g < hashes_.size(); ++g) {
+            std::size_t idx = index_(hashes_[g]);
+            while (slots_[idx].ref != 0) idx = (idx + 1) & mask_;
+            slots_[idx] = Slot{static_cast<uint32_t>(hashes_[g]), g + 1};
+        }
+    }
+
+    const std::vector<AggregateSpec> &specs_;
+    std::size_t limit_;
+    std::vector<Slot> slots_;
+    std::size_t mask_ = 0;
+    std::vector<uint64_t> hashes_;
+    std::vector<uint32_t> key_offsets_;
+    std::string keys_;
+    std::vector<Accumulator> acc_;
+};
+
+// Rows waiting to be folded into a GroupTable: their group index and, per
+// aggregate, the input value already replaced by the op's identity when
+// the row has none (count 0), so the update loops need no branches.
+struct Batch {
+    explicit Batch(std::size_t aggregates)
+        : int_count(aggregates * BATCH),
+          int_value(aggregates * BATCH),
+          float_count(aggregates * BATCH),
+          float_value(aggregates * BATCH) {}
+
+    std::size_t size = 0;
+    uint32_t group[BATCH] = {};
+    std::vector<uint8_t> int_count;
+    std::vector<int64_t> int_value;
+    std::vector<uint8_t> float_count;
+    std::vector<double> float_value;
+};
+
+void stage(Batch &b, uint32_t g, const TupleView &view,
+           const std::vector<AggregateSpec> &specs) {
+    const std::size_t i = b.size++;
+    b.group[i] = g;
+    for (std::size_t a = 0; a < specs.size(); ++a) {
+        const std::size_t at = a * BATCH + i;
+        const AggregateOp op = specs[a].op;
+        b.int_count[at] = 0;
+        b.int_value[at] = int_identity(op);
+        b.float_count[at] = 0;
+        b.float_value[at] = float_identity(op);
+        if (op == AggregateOp::COUNT) {
+            b.int_count[at] = 1;
+            continue;
+        }
+        if (specs[a].column >= view.size()) continue;
+        const auto f = view.field(specs[a].column);
+        if (f.type == FieldType::INT) {
+            b.int_count[at] = 1;
+            b.int_value[at] = f.asInt();
+        } else if (f.type == FieldType::FLOAT) {
+            b.float_count[at] = 1;
+            b.float_value[at] = f.asFloat();
+        }
+    }
+}
+
+// One loop per aggregate and value kind over the staged rows. Each is a
+// scatter into the accumulators by group index: no per-row branches, but
+// not SIMD either; the group lookups were per-row probes in stage()'s
+// caller.
+void apply(Batch &b, GroupTable &table,
+           const std::vector<AggregateSpec> &specs) {
+    const std::size_t n = b.size;
+    const uint32_t *g = b.group;
+    for (std::size_t a = 0; a < specs.size(); ++a) {
+        Accumulator &acc = table.acc(a);
+        const uint8_t *ic = b.int_count.data() + a * BATCH;
+        const int64_t *iv = b.int_value.data() + a * BATCH;
+        const uint8_t *fc = b.float_count.data() + a * BATCH;
+        const double *fv = b.float_value.data() + a * BATCH;
+        uint64_t *acc_ic = acc.int_count.data();
+        int64_t *acc_iv = acc.int_value.data();
+        uint64_t *acc_fc = acc.float_count.data();
+        double *acc_fv = acc.float_value.data();
+
+        for (std::size_t i = 0; i < n; ++i) acc_ic[g[i]] += ic[i];
+        if (specs[a].op == AggregateOp::COUNT) continue;
+        for (std::size_t i = 0; i < n; ++i) acc_fc[g[i]] += fc[i];
+        switch (specs[a].op) {
+            case AggregateOp::SUM:
+                for (std::size_t i = 0; i < n; ++i) acc_iv[g[i]] += iv[i];
+                for (std::size_t i = 0; i < n; ++i) acc_fv[g[i]] += fv[i];
+                break;
+            case AggregateOp::MIN:
+                for (std::size_t i = 0; i < n; ++i) {
+                    acc_iv[g[i]] = std::min(acc_iv[g[i]], iv[i]);
+                }
+                for (std::size_t i = 0; i < n; ++i) {
+                    acc_fv[g[i]] = std::min(acc_fv[g[i]], fv[i]);
+                }
+                break;
+            case AggregateOp::MAX:
+                for (std::size_t i = 0; i < n; ++i) {
+                    acc_iv[g[i]] = std::max(acc_iv[g[i]], iv[i]);
+                }
+                for (std::size_t i = 0; i < n; ++i) {
+                    acc_fv[g[i]] = std::max(acc_fv[g[i]], fv[i]);
+                }
+                break;
+            case AggregateOp::COUNT: break;
+        }
+    }
+    b.size = 0;
+}
+
+// Partial group record: [u32 key length][key][per aggregate: u64 int
+// count, i64 int value, u64 float count, f64 float value].
+
+template <typename T>
+void put(std::string &out, T v) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+template <typename T>
+T get(const char *&p) {
+    T v;
+    std::memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return v;
+}
+
+// Append group g of 'table' to 'out'; returns the record's length.
+std::size_t append_partial(std::string &out, GroupTable &table, uint32_t g,
+                           std::size_t aggregates) {
+    const std::size_t begin = out.size();
+    const std::string_view key = table.key(g);
+    put(out, static_cast<uint32_t>(key.size()));
+    out.append(key);
+    for (std::size_t a = 0; a < aggregates; ++a) {
+        const Accumulator &acc = table.acc(a);
+        put(out, acc.int_count[g]);
+        put(out, acc.int_value[g]);
+        put(out, acc.float_count[g]);
+        put(out, acc.float_value[g]);
+    }
+    return out.size() - begin;
+}
+
+// Length of the partial record starting at 'p'.
+std::size_t partial_length(const char *p, std::size_t aggregates) {
+    const auto key_len = get<uint32_t>(p);
+    return sizeof(uint32_t) + key_len + aggregates * STATE_BYTES;
+}
+
+// Call f(key, states) for each whole partial record at the front of
+// 'bytes', 'states' pointing at its aggregate states. Returns the bytes
+// consumed; a trailing incomplete record is left for the caller.
+template <typename F>
+std::size_t for_each_partial(std::string_view bytes, std::size_t aggregates,
+                             F &&f) {
+    std::size_t pos = 0;
+    while (bytes.size() - pos >= sizeof(uint32_t)) {
+        const char *p = bytes.data() + pos;
+        const std::size_t len = partial_length(p, aggregates);
+        if (bytes.size() - pos < len) break;
+        const auto key_len = get<uint32_t>(p);
+        f(std::string_view(p, key_len), p + key_len);
+        pos += len;
+    }
+    return pos;
+}
+
+// Fold one partial record's states into 'table'.
+void fold_partial(std::string_view key, const char *states,
+                  GroupTable &table, const std::vector<AggregateSpec> &specs) {
+    const uint32_t g =
+        table.find_or_insert(key, hash_bytes(key.data(), key.size()));
+    for (std::size_t a = 0; a < specs.size(); ++a) {
+        const auto ic = get<uint64_t>(states);
+        const auto iv = get<int64_t>(states);
+        const auto fc = get<uint64_t>(states);
+        const auto fv = get<double>(states);
+        combine(specs[a].op, table.acc(a), g, ic, iv, fc, fv);
+    }
+}
+
+// Spill files grow with their data; the default growth chunk would
+// preallocate a megabyte for every partition up front.
+storage::StorageOptions spill_options() {
+    storage::StorageOptions so;
+    so.growth.chunk_pages = 8;
+    return so;
+}
+
+// Largest record a page takes, and so the size spilled bytes are cut to.
+constexpr std::size_t SPILL_RECORD =
+    storage::PAGE_SIZE - storage::MAX_SLOTS * sizeof(storage::Slot);
+
+// Partial records of one partition spilled to their own file. They are
+// written as a byte stream cut into page-sized records, so one partial may
+// span records and no group key or aggregate count is too big to spill.
+// The file is removed when this goes away, also on errors.
+struct SpillFile {
+    explicit SpillFile(const std::string &dir)
+        : path(temp_path(dir, "agg")),
+          sm(std::make_unique<StorageManager>(path, spill_options())),
+          writer(std::make_unique<RecordWriter>(*sm, 0, 2)) {}
+
+    ~SpillFile() {
+        writer.reset();
+        sm.reset();
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+
+    // Append whole partial records. Callers serialize appends.
+    void append(std::string_view bytes) {
+        for (std::size_t pos = 0; pos < bytes.size(); pos += SPILL_RECORD) {
+            writer->append(bytes.substr(pos, SPILL_RECORD));
+        }
+    }
+
+    std::string path;
+    std::unique_ptr<StorageManager> sm;
+    std::unique_ptr<RecordWriter> writer;
+    std::mutex mutex;
+};
+
+using SpillFiles = std::vector<std::unique_ptr<SpillFile>>;
+
+// Group hash for splitting at 'level': level 0 partitions on the hash's low
+// bits; deeper levels rehash so they split on fresh bits.
+uint64_t level_hash(uint64_t hash, unsigned level) {
+    return level == 0 ? hash
+                      : common::mix64(hash ^ (level * 0x9e3779b97f4a7c15ULL));
+}
+
+// Merges the partial records of one partition into a table of at most
+// 'limit' bytes. Past the limit the table's groups move out to
+// SUB_PARTITIONS spill files, split on a rehash of the group key, and
+// merging goes on with an empty table; each sub-partition is merged later
+// on its own, with the same limit. At MAX_LEVELS the table may grow.
+class PartitionMerger {
+   public:
+    PartitionMerger(const HashAggregateOptions &o, unsigned level,
+                    std::size_t limit)
+        : o_(o),
+          level_(level),
+          limit_(limit),
+          table_(std::make_unique<GroupTable>(o.aggregates, 0)) {}
+
+    // Fold partial records; one may be cut between this call and the next.
+    void add(std::string_view bytes) {
+        if (carry_.empty()) {
+            const std::size_t n = fold_(bytes);
+            carry_.assign(bytes.substr(n));
+        } else {
+            carry_.append(bytes);
+            carry_.erase(0, fold_(carry_));
+        }
+    }
+
+    void add_file(SpillFile &file) {
+        file.writer->finish();
+        RecordReader reader(*file.sm, 0, 0, o_.read_ahead_pages);
+        std::string rec;
+        while (reader.next(rec)) add(rec);
+    }
+
+    // The merged table, or nullptr and the sub-partitions to merge next.
+    std::unique_ptr<GroupTable> finish(SpillFiles &subs) {
+        if (!carry_.empty()) {
+            throw std::runtime_error("HashAggregate: truncated partial record");
+        }
+        if (subs_.empty()) return std::move(table_);
+        move_out_();
+        subs = std::move(subs_);
+        return nullptr;
+    }
+
+   private:
+    std::size_t fold_(std::string_view bytes) {
+        return for_each_partial(
+            bytes, o_.aggregates.size(),
+            [&](std::string_view key, const char *states) {
+                fold_partial(key, states, *table_, o_.aggregates);
+                if (table_->memory_bytes() > limit_ &&
+                    level_ + 1 < MAX_LEVELS) {
+                    move_out_();
+                }
+            });
+    }
+
+    void move_out_() {
+        if (subs_.empty()) {
+            for (std::size_t p = 0; p < SUB_PARTITIONS; ++p) {
+                subs_.push_back(std::make_unique<SpillFile>(o_.temp_dir));
+            }
+        }
+        std::vector<std::string> out(SUB_PARTITIONS);
+        for (uint32_t g = 0; g < table_->size(); ++g) {
+            const uint64_t h = level_hash(table_->hash(g), level_ + 1);
+            append_partial(out[h & (SUB_PARTITIONS - 1)], *table_, g,
+                           o_.aggregates.size());
+        }
+        for (std::size_t p = 0; p < SUB_PARTITIONS; ++p) {
+            subs_[p]->append(out[p]);
+        }
+        table_ = std::make_unique<GroupTable>(o_.aggregates, 0);
+    }
+
+    const HashAggregateOptions &o_;
+    unsigned level_;
+    std::size_t limit_;
+    std::unique_ptr<GroupTable> table_;
+    std::string carry_;
+    SpillFiles subs_;
+};
+
+}  // namespace
+
+HashAggregate::HashAggregate(HashAggregateOptions options)
+    : options_(std::move(options)) {}
+
+HashAggregateStats HashAggregate::run(StorageManager &input,
+                                      const AggregateCallback &emit) {
+    HashAggregateStats stats;
+    const HashAggregateOptions &o = options_;
+    const std::vector<AggregateSpec> &specs = o.aggregates;
+    const std::size_t aggs = specs.size();
+    const std::size_t partitions = std::bit_ceil(
+        std::clamp<std::size_t>(o.partitions, 1, MAX_PARTITIONS));
+    const std::size_t threads = resolve_threads(o.threads, input.num_pages());
+
+    // ---- phase 1: scan and pre-aggregate per thread ----
+    struct Worker {
+        Worker(const std::vector<AggregateSpec> &specs, std::size_t limit,
+               std::size_t partitions)
+            : local(specs, limit), batch(specs.size()), parts(partitions) {}
+
+        GroupTable local;
+        Batch batch;
+        std::string key;
+        // Partial group records buffered per partition.
+        std::vector<std::string> parts;
+        std::size_t buffered = 0;
+        uint64_t skipped = 0;
+        uint64_t partials = 0;
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (std::size_t t = 0; t < threads; ++t) {
+        workers.push_back(std::make_unique<Worker>(
+            specs, std::max<std::size_t>(o.local_groups, 1), partitions));
+    }
+
+    std::atomic<std::size_t> buffered{0};
+    std::mutex spill_mutex;
+    SpillFiles spills(partitions);
+
+    // Move this worker's buffered partials into the partition files.
+    auto spill = [&](Worker &w) {
+        for (std::size_t p = 0; p < partitions; ++p) {
+            std::string &bytes = w.parts[p];
+            if (bytes.empty()) continue;
+            SpillFile *f = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(spill_mutex);
+                if (!spills[p]) {
+                    spills[p] = std::make_unique<SpillFile>(o.temp_dir);
+                }
+                f = spills[p].get();
+            }
+            {
+                std::lock_guard<std::mutex> lock(f->mutex);
+                f->append(bytes);
+            }
+            bytes.clear();
+            bytes.shrink_to_fit();
+        }
+        buffered -= w.buffered;
+        w.buffered = 0;
+    };
+
+    // Flush the pre-aggregation table into the partition buffers.
+    auto evict = [&](Worker &w) {
+        apply(w.batch, w.local, specs);
+        std::size_t added = 0;
+        for (uint32_t g = 0; g < w.local.size(); ++g) {
+            const std::size_t p = static_cast<std::size_t>(
+                w.local.hash(g) & (partitions - 1));
+            added += append_partial(w.parts[p], w.local, g, aggs);
+        }
+        w.partials += w.local.size();
+        w.local.clear();
+        w.buffered += added;
+        if (buffered.fetch_add(added) + added > o.memory_budget) spill(w);
+    };
+
+    stats.records = parallel_scan(
+        input, threads, o.read_ahead_pages,
+        [&](std::size_t t, std::string_view rec) {
+            Worker &w = *workers[t];
+            if (!build_key(rec, o.group_by, w.key)) {
+                ++w.skipped;
+                return;
+            }
+            const uint64_t h = hash_bytes(w.key.data(), w.key.size());
+            uint32_t g = w.local.find_or_insert(w.key, h);
+            if (g == NO_GROUP) {
+                evict(w);
+                g = w.local.find_or_insert(w.key, h);
+            }
+            stage(w.batch, g, TupleView(rec), specs);
+            if (w.batch.size == BATCH) apply(w.batch, w.local, specs);
+        },
+        [&](std::size_t t) { evict(*workers[t]); });
+
+    for (auto &w : workers) {
+        stats.skipped_records += w->skipped;
+        stats.partials += w->partials;
+    }
+    for (auto &f : spills) {
+        if (f) stats.spilled = true;
+    }
+
+    // ---- phase 2: merge partitions in parallel, emit in waves ----
+    // A wave merges one task per thread: a partition, or a sub-partition
+    // split off a partition whose table outgrew its share of the budget.
+    // So at most 'threads' tables, each bounded, are alive at once.
+    struct MergeTask {
+        std::size_t partition = 0;
+        // Sub-partition file; null for a top-level partition.
+        std::unique_ptr<SpillFile> file;
+        unsigned level = 0;
+    };
+    std::deque<MergeTask> tasks;
+    for (std::size_t p = 0; p < partitions; ++p) tasks.push_back({p, {}, 0});
+    const std::size_t limit =
+        std::max<std::size_t>(o.memory_budget / threads,
+                              4 * storage::PAGE_SIZE);
+
+    std::vector<AggregateValue> values(aggs);
+    while (!tasks.empty()) {
+        const std::size_t wave = std::min(threads, tasks.size());
+        std::vector<MergeTask> current;
+        for (std::size_t i = 0; i < wave; ++i) {
+            current.push_back(std::move(tasks.front()));
+            tasks.pop_front();
+        }
+        std::vector<std::unique_ptr<GroupTable>> tables(wave);
+        std::vector<SpillFiles> subs(wave);
+        std::vector<std::exception_ptr> errors(wave);
+        auto merge = [&](std::size_t i) {
+            try {
+                MergeTask &task = current[i];
+                PartitionMerger merger(o, task.level, limit);
+                if (task.file) {
+                    merger.add_file(*task.file);
+                    task.file.reset();
+                } else {
+                    const std::size_t p = task.partition;
+                    for (auto &w : workers) {
+                        merger.add(w->parts[p]);
+                        std::string().swap(w->parts[p]);
+                    }
+                    if (spills[p]) {
+                        merger.add_file(*spills[p]);
+                        spills[p].reset();
+                    }
+                }
+                tables[i] = merger.finish(subs[i]);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        };
+        std::vector<std::thread> mergers;
+        for (std::size_t i = 1; i < wave; ++i) mergers.emplace_back(merge, i);
+        merge(0);
+        for (auto &m : mergers) m.join();
+        for (auto &e : errors) {
+            if (e) std::rethrow_exception(e);
+        }
+
+        for (std::size_t i = 0; i < wave; ++i) {
+            if (!subs[i].empty()) ++stats.respills;
+            for (auto &f : subs[i]) {
+                tasks.push_back({0, std::move(f), current[i].level + 1});
+            }
+        }
+        for (auto &table : tables) {
+            if (!table) continue;
+            for (uint32_t g = 0; g < table->size(); ++g) {
+                for (std::size_t a = 0; a < aggs; ++a) {
+                    const Accumulator &acc = table->acc(a);
+                    AggregateValue &v = values[a];
+                    v = AggregateValue{};
+                    if (specs[a].op == AggregateOp::COUNT) {
+                        v.count = acc.int_count[g];
+                        continue;
+                    }
+                    v.int_count = acc.int_count[g];
+                    v.float_count = acc.float_count[g];
+                    v.count = v.int_count + v.float_count;
+                    if (v.int_count != 0) v.int_value = acc.int_value[g];
+                    if (v.float_count != 0) v.float_value = acc.float_value[g];
+                }
+                ++stats.groups;
+                emit(TupleView(table->key(g)), values);
+            }
+        }
+    }
+    return stats;
+}
+
+}  // namespace srd::execution
@@ -0,0 +1,470 @@
+#include "srd/execution/hash_join.hpp"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <bit>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "srd/common/hash.hpp"
+#include "srd/common/temp_path.hpp"
+#include "srd/execution/parallel_scan.hpp"
+#include "srd/storage/record_stream.hpp"
+
+namespace srd::execution {
+
+using srd::common::hash_bytes;
+using srd::common::temp_path;
+using srd::record::FieldType;
+using srd::record::TupleView;
+using srd::storage::RecordReader;
+using srd::storage::RecordWriter;
+using srd::storage::StorageManager;
+
+namespace {
+
+constexpr std::size_t MAX_PARTITIONS = 1024;
+
+struct JoinKey {
+    bool valid = false;
+    FieldType type = FieldType::INT;
+    uint64_t hash = 0;
+    // Offset/length of the key payload within the record.
+    uint32_t offset = 0;
+    uint32_t length = 0;
+};
+
+JoinKey key_of(std::string_view rec, std::size_t column) {
+    JoinKey k;
+    const TupleView view(rec);
+    if (column >= view.size()) return k;
+    const auto f = view.field(column);
+    k.valid = true;
+    k.type = f.type;
+    k.offset = static_cast<uint32_t>(f.payload.data() - rec.data());
+    k.length = static_cast<uint32_t>(f.payload.size());
+    k.hash = hash_bytes(f.payload.data(), f.payload.size(),
+                        static_cast<uint64_t>(f.type) + 1);
+    return k;
+}
+
+std::size_t partition_of(uint64_t hash, std::size_t partitions) {
+    return static_cast<std::size_t>(hash & (partitions - 1));
+}
+
+// Build-side records of one radix partition and their hash table.
+// Records stay wherever they were buffered; entries point at them.
+class PartitionTable {
+   public:
+    struct Entry {
+        uint64_t hash;
+        const char *rec;
+        uint32_t rec_length;
+        uint32_t key_offset;
+        uint32_t key_length;
+        FieldType type;
+    };
+
+    void reserve(std::size_t n) {
+        entries_.reserve(n);
+    }
+
+    void add(const Entry &e) {
+        entries_.push_back(e);
+    }
+
+    // Lay out the open-addressing table: a power of two at least twice the
+    // entry count. Slot index comes from the high hash bits because the low
+    // ones picked the partition.
+    void build() {
+        const std::size_t size =
+            std::bit_ceil(std::max<std::size_t>(16, entries_.size() * 2));
+        mask_ = size - 1;
+        slots_.assign(size, Slot{0, 0});
+        for (std::size_t i = 0; i < entries_.size(); ++i) {
+            std::size_t idx = index_(entries_[i].hash);
+            while (slots_[idx].ref != 0) idx = (idx + 1) & mask_;
+            slots_[idx] = Slot{tag_(entries_[i].hash),
+                               static_cast<uint32_t>(i + 1)};
+        }
+    }
+
+    // Call f(record) for every build record whose key equals 'key'.
+    template <typename F>
+    void probe(const JoinKey &key, std::string_view probe_rec, F &&f) const {
+        if (entries_.empty()) return;
+        const std::string_view payload =
+            probe_rec.substr(key.offset, key.length);
+        const uint32_t tag = tag_(key.hash);
+        for (std::size_t idx = index_(key.hash); slots_[idx].ref != 0;
+             idx = (idx + 1) & mask_) {
+            if (slots_[idx].tag != tag) continue;
+            const Entry &e = entries_[slots_[idx].ref - 1];
+            if (e.hash != key.hash || e.type != key.type) continue;
+            if (std::string_view(e.rec + e.key_offset, e.key_length) !=
+                payload) {
+                continue;
+            }
+            f(std::string_view(e.rec, e.rec_length));
+        }
+    }
+
+   private:
+    // 8 bytes: a hash tag to reject most mismatches without touching the
+    // entry, and entry index + 1 (0 = empty).
+    struct Slot {
+        uint32_t tag;
+        uint32_t ref;
+    };
+
+    std::size_t index_(uint64_t hash) const noexcept {
+        return static_cast<std::size_t>(hash >> 32) & mask_;
+    }
+    static uint32_t tag_(uint64_t hash) noexcept {
+        return static_cast<uint32_t>(hash);
+    }
+
+    std::vector<Entry> entries_;
+    std::vector<Slot> slots_;
+    std::size_t mask_ = 0;
+};
+
+// One worker's buffered share of one partition.
+struct Chunk {
+    std::string bytes;
+    std::vector<std::pair<JoinKey, uint32_t>> records;  // key, offset
+    std::vector<uint32_t> lengths;
+};
+
+// Spill files grow with their data; the default growth chunk would
+// preallocate a megabyte for every partition up front.
+storage::StorageOptions spill_options() {
+    storage::StorageOptions so;
+    so.growth.chunk_pages = 8;
+    return so;
+}
+
+// A partition spilled to its own file. The file is removed when this goes
+// away, including when a join is abandoned by an exception. Workers batch
+// records locally and append whole batches under the lock.
+struct SpillFile {
+    explicit SpillFile(const std::string &dir)
+        : path(temp_path(dir, "join")),
+          sm(std::make_unique<StorageManager>(path, spill_options())),
+          writer(std::make_unique<RecordWriter>(*sm, 0, 2)) {}
+
+    ~SpillFile() {
+        writer.reset();
+        sm.reset();
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+
+    // Write out the last records and close the file, so that a pass does
+    // not keep a descriptor per partition once it is done.
+    void close() {
+        writer->finish();
+        records = writer->records();
+        writer.reset();
+        pages = sm->num_pages();
+        sm.reset();
+    }
+
+    StorageManager &reopen() {
+        if (!sm) sm = std::make_unique<StorageManager>(path, spill_options());
+        return *sm;
+    }
+
+    std::string path;
+    std::unique_ptr<StorageManager> sm;
+    std::unique_ptr<RecordWriter> writer;
+    std::uint64_t records = 0;
+    std::uint64_t pages = 0;
+    std::mutex mutex;
+};
+
+using SpillFiles = std::vector<std::unique_ptr<SpillFile>>;
+
+// Spill files one partitioning pass may have open: the configured cap,
+// within half the descriptors the process may open, as a power of two.
+std::size_t spill_fanout(std::size_t configured) {
+    std::size_t cap = std::min(std::max<std::size_t>(configured, 2),
+                               MAX_PARTITIONS);
+    rlimit rl{};
+    if (::getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY) {
+        cap = std::min(cap, static_cast<std::size_t>(rl.rlim_cur / 2));
+    }
+    return std::bit_floor(std::max<std::size_t>(cap, 2));
+}
+
+// Hash that picks a record's partition at recursion level 'level'. Each
+// level rehashes, so a partition that was too big splits again.
+uint64_t level_hash(uint64_t hash, unsigned level) {
+    return level == 0 ? hash
+                      : common::mix64(hash ^ (level * 0x9e3779b97f4a7c15ULL));
+}
+
+// Partition every record of 'input' on 'column' into 'files', which come
+// back closed. Returns the number of records read.
+std::uint64_t spill_partitions(StorageManager &input, std::size_t column,
+                               unsigned level, SpillFiles &files,
+                               std::size_t threads, std::size_t read_ahead) {
+    const std::size_t partitions = files.size();
+    constexpr std::size_t LOCAL_BATCH = storage::PAGE_SIZE / 2;
+    struct Local {
+        std::vector<std::string> bytes;
+        std::vector<std::vector<uint32_t>> ends;
+    };
+    std::vector<Local> locals(threads);
+    for (auto &l : locals) {
+        l.bytes.resize(partitions);
+        l.ends.resize(partitions);
+    }
+
+    auto drain = [&](Local &l, std::size_t p) {
+        SpillFile &f = *files[p];
+        std::lock_guard<std::mutex> lock(f.mutex);
+        uint32_t begin = 0;
+        for (uint32_t end : l.ends[p]) {
+            f.writer->append(
+                std::string_view(l.bytes[p]).substr(begin, end - begin));
+            begin = end;
+        }
+        l.bytes[p].clear();
+        l.ends[p].clear();
+    };
+
+    const auto n = parallel_scan(
+        input, threads, read_ahead,
+        [&](std::size_t t, std::string_view rec) {
+            const JoinKey k = key_of(rec, column);
+            if (!k.valid) return;  // can never match
+            const std::size_t p =
+                partition_of(level_hash(k.hash, level), partitions);
+            Local &l = locals[t];
+            l.bytes[p].append(rec);
+            l.ends[p].push_back(static_cast<uint32_t>(l.bytes[p].size()));
+            if (l.bytes[p].size() >= LOCAL_BATCH) drain(l, p);
+        },
+        [&](std::size_t t) {
+            for (std::size_t p = 0; p < partitions; ++p) drain(locals[t], p);
+        });
+    for (auto &f : files) f->close();
+    return n;
+}
+
+// Joins spilled partition pairs. A pair whose build side still exceeds the
+// budget is partitioned again on a rehashed key, up to MAX_LEVELS deep; a
+// pair that hashing cannot split (one hot key) is joined in budget-sized
+// chunks of its build side instead, rescanning the probe side per chunk.
+class GraceJoin {
+   public:
+    using Emit = std::function<void(std::string_view, std::string_view)>;
+
+    GraceJoin(const HashJoinOptions &o, HashJoinStats &stats, Emit emit)
+        : o_(o),
+          fanout_(spill_fanout(o.max_spill_files)),
+          stats_(stats),
+          emit_(std::move(emit)) {}
+
+    std::size_t fanout() const noexcept {
+        return fanout_;
+    }
+
+    SpillFiles spill(StorageManager &input, std::size_t column,
+                     unsigned level, std::size_t partitions,
+                     std::uint64_t &records) {
+        SpillFiles files;
+        for (std::size_t p = 0; p < partitions; ++p) {
+            files.push_back(std::make_unique<SpillFile>(o_.temp_dir));
+        }
+        records = spill_partitions(
+            input, column, level, files,
+            resolve_threads(o_.threads, input.num_pages()),
+            o_.read_ahead_pages);
+        return files;
+    }
+
+    // Join build[p] with probe[p] for every p, deleting each pair's files
+    // once it is done.
+    void join_pairs(SpillFiles &build, SpillFiles &probe, unsigned level) {
+        for (std::size_t p = 0; p < build.size(); ++p) {
+            if (build[p]->records > 0 && probe[p]->records > 0) {
+                join_pair_(*build[p], *probe[p], level);
+            }
+            build[p].reset();
+            probe[p].reset();
+        }
+    }
+
+   private:
+    static constexpr unsigned MAX_LEVELS = 4;
+
+    void join_pair_(SpillFile &build, SpillFile &probe, unsigned level) {
+        const bool fits = build.pages * storage::PAGE_SIZE <= o_.memory_budget;
+        if (!fits && level + 1 < MAX_LEVELS) {
+            std::uint64_t n = 0;
+            SpillFiles bf = spill(build.reopen(), o_.build_column, level + 1,
+                                  fanout_, n);
+            std::uint64_t largest = 0;
+            for (const auto &f : bf) largest = std::max(largest, f->records);
+            if (largest < build.records) {
+                ++stats_.repartitions;
+                SpillFiles pf = spill(probe.reopen(), o_.probe_column,
+                                      level + 1, fanout_, n);
+                join_pairs(bf, pf, level + 1);
+                return;
+            }
+        }
+        if (!fits) ++stats_.chunked_pairs;
+        join_chunks_(build.reopen(), probe.reopen());
+    }
+
+    // Build tables of up to memory_budget bytes of 'build' at a time and
+    // probe each with all of 'probe'; one round when the build side fits.
+    void join_chunks_(StorageManager &build, StorageManager &probe) {
+        RecordReader build_reader(build, 0, 0, o_.read_ahead_pages);
+        std::string arena;
+        std::vector<std::pair<uint32_t, uint32_t>> spans;  // offset, length
+        std::string rec;
+        bool more = true;
+        while (more) {
+            arena.clear();
+            spans.clear();
+            while (arena.size() < o_.memory_budget &&
+                   (more = build_reader.next(rec))) {
+                spans.emplace_back(static_cast<uint32_t>(arena.size()),
+                                   static_cast<uint32_t>(rec.size()));
+                arena.append(rec);
+            }
+            if (spans.empty()) break;
+            PartitionTable table;
+            table.reserve(spans.size());
+            for (const auto &[off, len] : spans) {
+                const std::string_view b(arena.data() + off, len);
+                const JoinKey k = key_of(b, o_.build_column);
+                table.add({k.hash, b.data(), len, k.offset, k.length, k.type});
+            }
+            table.build();
+
+            RecordReader reader(probe, 0, 0, o_.read_ahead_pages);
+            while (reader.next(rec)) {
+                const JoinKey k = key_of(rec, o_.probe_column);
+                table.probe(k, rec,
+                            [&](std::string_view b) { emit_(b, rec); });
+            }
+        }
+    }
+
+    const HashJoinOptions &o_;
+    const std::size_t fanout_;
+    HashJoinStats &stats_;
+    Emit emit_;
+};
+
+}  // namespace
+
+HashJoin::HashJoin(HashJoinOptions options) : options_(std::move(options)) {}
+
+HashJoinStats HashJoin::run(StorageManager &build, StorageManager &probe,
+                            const JoinCallback &emit) {
+    HashJoinStats stats;
+    const HashJoinOptions &o = options_;
+    // The file size bounds the build side's bytes; good enough to size
+    // partitions without a pre-scan.
+    const std::size_t build_bytes = build.num_pages() * storage::PAGE_SIZE;
+    stats.spilled = build_bytes > o.memory_budget;
+
+    auto emit_match = [&](std::string_view b, std::string_view p) {
+        ++stats.matches;
+        emit(TupleView(b), TupleView(p));
+    };
+
+    if (!stats.spilled) {
+        // ---- in memory: radix partitions sized for the cache ----
+        const std::size_t partitions = std::min(
+            MAX_PARTITIONS,
+            std::bit_ceil(std::max<std::size_t>(
+                1, build_bytes / std::max<std::size_t>(o.partition_bytes, 1))));
+        stats.partitions = partitions;
+        const std::size_t threads =
+            resolve_threads(o.threads, build.num_pages());
+
+        std::vector<std::vector<Chunk>> chunks(
+            threads, std::vector<Chunk>(partitions));
+        stats.build_records = parallel_scan(
+            build, threads, o.read_ahead_pages,
+            [&](std::size_t t, std::string_view rec) {
+                const JoinKey k = key_of(rec, o.build_column);
+                if (!k.valid) return;
+                Chunk &c = chunks[t][partition_of(k.hash, partitions)];
+                c.records.emplace_back(k,
+                                       static_cast<uint32_t>(c.bytes.size()));
+                c.lengths.push_back(static_cast<uint32_t>(rec.size()));
+                c.bytes.append(rec);
+            });
+
+        // Parallel build: worker t owns partitions t, t + threads, ...
+        std::vector<PartitionTable> tables(partitions);
+        auto build_part = [&](std::size_t t) {
+            for (std::size_t p = t; p < partitions; p += threads) {
+                std::size_t n = 0;
+                for (const auto &per_thread : chunks) {
+                    n += per_thread[p].records.size();
+                }
+                tables[p].reserve(n);
+                for (const auto &per_thread : chunks) {
+                    const Chunk &c = per_thread[p];
+                    for (std::size_t i = 0; i < c.records.size(); ++i) {
+                        const auto &[k, off] = c.records[i];
+                        tables[p].add({k.hash, c.bytes.data() + off,
+                                       c.lengths[i], k.offset, k.length,
+                                       k.type});
+                    }
+                }
+                tables[p].build();
+            }
+        };
+        std::vector<std::thread> workers;
+        for (std::size_t t = 1; t < threads; ++t) {
+            workers.emplace_back(build_part, t);
+        }
+        build_part(0);
+        for (auto &w : workers) w.join();
+
+        RecordReader reader(probe, 0, 0, o.read_ahead_pages);
+        std::string rec;
+        while (reader.next(rec)) {
+            ++stats.probe_records;
+            const JoinKey k = key_of(rec, o.probe_column);
+            if (!k.valid) continue;
+            tables[partition_of(k.hash, partitions)].probe(
+                k, rec, [&](std::string_view b) { emit_match(b, rec); });
+        }
+        return stats;
+    }
+
+    // ---- Grace: partition both sides to disk, join pair by pair ----
+    // Aim for partitions of half the budget to leave room for skew; pairs
+    // that still come out too big are split again by GraceJoin.
+    GraceJoin grace(o, stats, emit_match);
+    const std::size_t partitions = std::min(
+        grace.fanout(),
+        std::bit_ceil(std::max<std::size_t>(
+            2, 2 * build_bytes / std::max<std::size_t>(o.memory_budget, 1))));
+    stats.partitions = partitions;
+    // One side at a time, so at most 'partitions' files are open at once.
+    SpillFiles build_files =
+        grace.spill(build, o.build_column, 0, partitions, stats.build_records);
+    SpillFiles probe_files =
+        grace.spill(probe, o.probe_column, 0, partitions, stats.probe_records);
+    grace.join_pairs(build_files, probe_files, 0);
+    return stats;
+}
+
+}  // namespace srd::execution
@@ -0,0 +1,64 @@
+#include "srd/execution/parallel_scan.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "srd/storage/record_stream.hpp"
+
+namespace srd::execution {
+
+std::size_t resolve_threads(std::size_t requested, std::uint64_t pages) {
+    std::size_t n = requested != 0
+                        ? requested
+                        : std::max(1u, std::thread::hardware_concurrency());
+    return static_cast<std::size_t>(
+        std::max<std::uint64_t>(1, std::min<std::uint64_t>(n, pages)));
+}
+
+std::uint64_t parallel_scan(
+    storage::StorageManager &sm, std::size_t threads,
+    std::size_t read_ahead_pages,
+    const std::function<void(std::size_t, std::string_view)> &fn,
+    const std::function<void(std::size_t)> &done) {
+    const std::uint64_t pages = sm.num_pages();
+    threads = std::max<std::size_t>(threads, 1);
+
+    std::vector<std::uint64_t> counts(threads, 0);
+    std::vector<std::exception_ptr> errors(threads);
+    auto work = [&](std::size_t t) {
+        const std::uint64_t first = pages * t / threads;
+        const std::uint64_t end = pages * (t + 1) / threads;
+        try {
+            if (first < end) {
+                storage::RecordReader reader(sm, first, end,
+                                             read_ahead_pages);
+                std::string rec;
+                while (reader.next(rec)) {
+                    fn(t, rec);
+                    ++counts[t];
+                }
+            }
+            if (done) done(t);
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+
+    // The calling thread takes the last share itself.
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t + 1 < threads; ++t) workers.emplace_back(work, t);
+    work(threads - 1);
+    for (auto &w : workers) w.join();
+
+    for (auto &e : errors) {
+        if (e) std::rethrow_exception(e);
+    }
+    std::uint64_t total = 0;
+    for (auto c : counts) total += c;
+    return total;
+}
+
+}  // namespace srd::execution
@@ -0,0 +1,110 @@
+#include "srd/execution/scheduler.hpp"
+
+#include <algorithm>
+
+namespace srd::execution {
+
+Scheduler::Scheduler(std::size_t workers, std::size_t io_threads) {
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    io_threads = std::max<std::size_t>(io_threads, 1);
+
+    for (std::size_t i = 0; i < workers; ++i) {
+        workers_.emplace_back([this] {
+            for (;;) {
+                std::coroutine_handle<> h;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    ready_cv_.wait(lock, [&] {
+                        return stopping_ || !ready_.empty();
+                    });
+                    if (ready_.empty()) return;  // stopping and drained
+                    h = ready_.front();
+                    ready_.pop_front();
+                }
+                h.resume();
+            }
+        });
+    }
+    for (std::size_t i = 0; i < io_threads; ++i) {
+        io_threads_.emplace_back([this] {
+            for (;;) {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    io_cv_.wait(lock,
+                                [&] { return stopping_ || !io_jobs_.empty(); });
+                    if (io_jobs_.empty()) return;
+                    job = std::move(io_jobs_.front());
+                    io_jobs_.pop_front();
+                }
+                job();
+            }
+        });
+    }
+}
+
+Scheduler::~Scheduler() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_cv_.wait(lock, [&] { return spawned_ == 0; });
+        stopping_ = true;
+    }
+    ready_cv_.notify_all();
+    io_cv_.notify_all();
+    for (auto &t : workers_) t.join();
+    for (auto &t : io_threads_) t.join();
+}
+
+void Scheduler::post(std::coroutine_handle<> h) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(h);
+    }
+    ready_cv_.notify_one();
+}
+
+void Scheduler::post_io(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        io_jobs_.push_back(std::move(job));
+    }
+    io_cv_.notify_one();
+}
+
+void Scheduler::spawn(Task<void> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++spawned_;
+    }
+    run_spawned_(*this, std::move(task));
+}
+
+detail::Detached Scheduler::run_spawned_(Scheduler &s, Task<void> task) {
+    co_await s.schedule();
+    std::exception_ptr error;
+    try {
+        co_await std::move(task);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    s.task_done_(error);
+}
+
+void Scheduler::task_done_(std::exception_ptr error) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error && !error_) error_ = error;
+        --spawned_;
+    }
+    idle_cv_.notify_all();
+}
+
+void Scheduler::wait_idle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [&] { return spawned_ == 0; });
+    if (error_) std::rethrow_exception(std::exchange(error_, nullptr));
+}
+
+}  // namespace srd::execution
@@ -0,0 +1,445 @@
+#include "srd/index/bloom_filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+
+#include "srd/common/hash.hpp"
+
+namespace srd::index {
+
+using srd::common::hash_bytes;
+using srd::record::Field;
+using srd::record::FieldType;
+using srd::record::TupleView;
+using srd::storage::MAX_SLOTS;
+using srd::storage::SlottedPage;
+using srd::storage::StorageManager;
+
+namespace {
+
+constexpr uint32_t BLOOM_MAGIC = 0x464d4c42;  // "BLMF"
+constexpr uint32_t BLOOM_VERSION = 1;
+constexpr std::size_t BLOCK_ALIGNMENT = 64;
+constexpr std::uint64_t LOAD_BATCH = 16;
+
+// Odd multipliers, one per word: each maps the key's low 32 hash bits to an
+// independent bit position in its word.
+constexpr uint32_t SALT[BloomFilter::WORDS_PER_BLOCK] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+// Per-word masks of one key, written as a fixed 8-lane loop so it
+// vectorizes (vpmulld + vpsrld + vpsllvd on AVX2).
+inline void make_mask(uint64_t hash, uint32_t (&mask)[8]) {
+    const auto key = static_cast<uint32_t>(hash);
+    for (std::size_t i = 0; i < BloomFilter::WORDS_PER_BLOCK; ++i) {
+        mask[i] = uint32_t{1} << ((key * SALT[i]) >> 27);
+    }
+}
+
+template <typename T>
+void write_pod(std::ostream &os, const T &v) {
+    os.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+template <typename T>
+bool read_pod(std::istream &is, T &v) {
+    is.read(reinterpret_cast<char *>(&v), sizeof(T));
+    return static_cast<bool>(is);
+}
+
+}  // namespace
+
+// ---------------- BloomFilter ----------------
+
+void BloomFilter::AlignedDeleter::operator()(uint32_t *p) const noexcept {
+    ::operator delete[](p, std::align_val_t{BLOCK_ALIGNMENT});
+}
+
+BloomFilter::BloomFilter(std::size_t blocks)
+    : blocks_(std::max<std::size_t>(blocks, 1)),
+      words_(static_cast<uint32_t *>(::operator new[](
+          blocks_ * BLOCK_BYTES, std::align_val_t{BLOCK_ALIGNMENT}))) {
+    std::memset(words_.get(), 0, blocks_ * BLOCK_BYTES);
+}
+
+BloomFilter::BloomFilter(std::size_t expected_keys, double fpp)
+    : BloomFilter(blocks_for(expected_keys, fpp)) {}
+
+double BloomFilter::expected_fpp(std::size_t keys, std::size_t blocks) {
+    // Keys per block are ~Poisson(lambda); a block holding i keys has each
+    // word bit set with probability 1 - (31/32)^i, and a false positive
+    // needs all 8 probed bits set.
+    if (keys == 0) return 0.0;
+    const double lambda =
+        static_cast<double>(keys) / static_cast<double>(std::max<std::size_t>(
+                                        blocks, 1));
+    const auto last = static_cast<std::size_t>(
+        lambda + 12.0 * std::sqrt(lambda) + 32.0);
+    double fpp = 0.0;
+    double log_pmf = -lambda;  // log P(i = 0)
+    for (std::size_t i = 0; i <= last; ++i) {
+        if (i > 0) log_pmf += std::log(lambda) - std::log(double(i));
+        const double bit = 1.0 - std::pow(31.0 / 32.0, double(i));
+        fpp += std::exp(log_pmf) * std::pow(bit, 8.0);
+    }
+    return fpp;
+}
+
+std::size_t BloomFilter::blocks_for(std::size_t keys, double fpp) {
+    if (keys == 0) return 1;
+    fpp = std::clamp(fpp, 1e-9, 0.5);
+    // One key per block is far below any fpp in range; search down.
+    std::size_t lo = 1, hi = keys;
+    while (lo < hi) {
+        const std::size_t mid = lo + (hi - lo) / 2;
+        if (expected_fpp(keys, mid) <= fpp) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+void BloomFilter::insert(uint64_t hash) noexcept {
+    uint32_t mask[8];
+    make_mask(hash, mask);
+    uint32_t *block = words_.get() + block_of_(hash) * WORDS_PER_BLOCK;
+    for (std::size_t i = 0; i < WORDS_PER_BLOCK; ++i) block[i] |= mask[i];
+}
+
+void BloomFilter::insert_concurrent(uint64_t hash) noexcept {
+    uint32_t mask[8];
+    make_mask(hash, mask);
+    uint32_t *block = words_.get() + block_of_(hash) * WORDS_PER_BLOCK;
+    for (std::size_t i = 0; i < WORDS_PER_BLOCK; ++i) {
+        std::atomic_ref<uint32_t>(block[i]).fetch_or(
+            mask[i], std::memory_order_relaxed);
+    }
+}
+
+bool BloomFilter::may_contain(uint64_t hash) const noexcept {
+    uint32_t mask[8];
+    make_mask(hash, mask);
+    const uint32_t *block =
+        words_.get() + block_of_(hash) * WORDS_PER_BLOCK;
+    // Branch-free: OR together every missing bit, test once.
+    uint32_t missing = 0;
+    for (std::size_t i = 0; i < WORDS_PER_BLOCK; ++i) {
+        missing |= mask[i] & ~block[i];
+    }
+    return missing == 0;
+}
+
+uint64_t bloom_key_hash(FieldType type, std::string_view payload) {
+    return hash_bytes(payload.data(), payload.size(),
+                      static_cast<uint64_t>(type) + 1);
+}
+
+uint64_t bloom_key_hash(const Field &key) {
+    return bloom_key_hash(key.type,
+                          std::string_view(key.data.get(), key.data_length));
+}
+
+// ---------------- BloomIndex ----------------
+
+BloomIndex::BloomIndex(std::string data_path, BloomOptions options)
+    : path_(side_path(data_path)), options_(std::move(options)) {
+    options_.pages_per_range = std::max<std::size_t>(
+        options_.pages_per_range, 1);
+}
+
+void BloomIndex::Observer::on_insert(std::string_view record) {
+    uint64_t hash = 0;
+    if (!index_.key_hash_(record, hash)) return;
+    index_.changed_();
+    std::shared_lock<std::shared_mutex> lock(range_.latch);
+    range_.filter.insert_concurrent(hash);
+    range_.keys.fetch_add(1, std::memory_order_relaxed);
+    if (range_.rebuilding.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> pending(range_.pending_mutex);
+        range_.pending.push_back(hash);
+    }
+}
+
+void BloomIndex::changed_() const {
+    if (!saved_.load(std::memory_order_relaxed) || !saved_.exchange(false)) {
+        return;
+    }
+    std::error_code ec;
+    std::filesystem::remove(path_, ec);
+}
+
+bool BloomIndex::key_hash_(std::string_view record, uint64_t &hash) const {
+    try {
+        const TupleView row(record);
+        if (options_.column >= row.size()) return false;
+        const auto f = row.field(options_.column);
+        hash = bloom_key_hash(f.type, f.payload);
+        return true;
+    } catch (const std::runtime_error &) {
+        return false;  // not a tuple: holds no key
+    }
+}
+
+void BloomIndex::attach(std::uint64_t page_id, SlottedPage &page) {
+    const std::size_t r = page_id / options_.pages_per_range;
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (ranges_.size() <= r) {
+        Range &range = ranges_.emplace_back(
+            *this, BloomFilter(options_.expected_keys_per_range, options_.fpp));
+        range.rebuilding = building_;
+    }
+    attached_ = true;
+    page.add_observer(&ranges_[r].observer);
+}
+
+void BloomIndex::build(StorageManager &sm) {
+    const std::uint64_t pages = sm.num_pages();
+    const std::size_t per = options_.pages_per_range;
+    const std::size_t ranges = (pages + per - 1) / per;
+    // Stop collecting inserts for ranges not rebuilt (all of them if the
+    // build failed).
+    auto finish = [&](std::size_t from) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        building_ = false;
+        for (std::size_t r = from; r < ranges_.size(); ++r) {
+            Range &range = ranges_[r];
+            std::lock_guard<std::mutex> pending(range.pending_mutex);
+            range.rebuilding = false;
+            range.pending.clear();
+        }
+    };
+    changed_();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        building_ = true;
+    }
+    try {
+        std::vector<uint64_t> hashes;
+        for (std::size_t r = 0; r < ranges; ++r) {
+            // Inserts from here on may miss the pages read below: keep
+            // them for the new filter.
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (r < ranges_.size()) ranges_[r].rebuilding = true;
+            }
+            hashes.clear();
+            read_keys_(sm, r, hashes);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (r == ranges_.size()) {
+                ranges_.emplace_back(*this, make_filter_(hashes));
+                ranges_[r].keys = hashes.size();
+                continue;
+            }
+            // Attached pages may be inserting into the old filter: wait
+            // them out before replacing it.
+            Range &range = ranges_[r];
+            std::unique_lock<std::shared_mutex> swap(range.latch);
+            std::lock_guard<std::mutex> pending(range.pending_mutex);
+            hashes.insert(hashes.end(), range.pending.begin(),
+                          range.pending.end());
+            range.filter = make_filter_(hashes);
+            range.keys = hashes.size();
+            range.pending.clear();
+            range.pending.shrink_to_fit();
+            range.rebuilding = false;
+        }
+    } catch (...) {
+        finish(0);
+        throw;
+    }
+    // Ranges attach() created past the scanned pages keep their filters.
+    finish(ranges);
+}
+
+void BloomIndex::read_keys_(StorageManager &sm, std::size_t r,
+                            std::vector<uint64_t> &hashes) const {
+    const std::size_t per = options_.pages_per_range;
+    const std::uint64_t first = r * per;
+    const std::uint64_t end =
+        std::min<std::uint64_t>(sm.num_pages(), first + per);
+    std::string rec;
+    for (std::uint64_t p = first; p < end; p += LOAD_BATCH) {
+        auto batch = sm.load_range(p, std::min(LOAD_BATCH, end - p));
+        for (const auto &page : batch) {
+            for (std::size_t slot = 0; slot < MAX_SLOTS; ++slot) {
+                uint64_t h = 0;
+                if (page->getRecord(slot, rec) && key_hash_(rec, h)) {
+                    hashes.push_back(h);
+                }
+            }
+        }
+    }
+}
+
+BloomFilter BloomIndex::make_filter_(std::vector<uint64_t> &hashes) const {
+    // Size for the distinct keys; duplicates would only oversize it.
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+    BloomFilter filter(hashes.size(), options_.fpp);
+    for (uint64_t h : hashes) filter.insert(h);
+    return filter;
+}
+
+std::size_t BloomIndex::num_ranges() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ranges_.size();
+}
+
+std::size_t BloomIndex::memory_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t bytes = 0;
+    for (const auto &r : ranges_) bytes += r.filter.memory_bytes();
+    return bytes;
+}
+
+BloomIndexStats BloomIndex::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    BloomIndexStats stats;
+    stats.ranges = ranges_.size();
+    for (const auto &r : ranges_) {
+        const std::uint64_t keys = r.keys.load(std::memory_order_relaxed);
+        const double fpp = BloomFilter::expected_fpp(
+            static_cast<std::size_t>(keys), r.filter.num_blocks());
+        stats.memory_bytes += r.filter.memory_bytes();
+        stats.keys += keys;
+        if (fpp > options_.fpp) ++stats.overfull_ranges;
+        stats.worst_fpp = std::max(stats.worst_fpp, fpp);
+    }
+    return stats;
+}
+
+bool BloomIndex::range_may_contain_(std::size_t r, uint64_t hash) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (r >= ranges_.size()) return true;
+    return ranges_[r].filter.may_contain(hash);
+}
+
+bool BloomIndex::may_contain(std::uint64_t pages, const Field &key) const {
+    const uint64_t hash = bloom_key_hash(key);
+    const std::size_t per = options_.pages_per_range;
+    for (std::size_t r = 0; r * per < pages; ++r) {
+        if (range_may_contain_(r, hash)) return true;
+    }
+    return false;
+}
+
+BloomLookupStats BloomIndex::lookup(
+    StorageManager &sm, const Field &key,
+    const std::function<void(std::uint64_t, std::string_view)> &fn) const {
+    BloomLookupStats stats;
+    const uint64_t hash = bloom_key_hash(key);
+    const std::string_view payload(key.data.get(), key.data_length);
+    const std::uint64_t pages = sm.num_pages();
+    const std::size_t per = options_.pages_per_range;
+    std::string rec;
+    for (std::uint64_t first = 0; first < pages; first += per) {
+        if (!range_may_contain_(first / per, hash)) {
+            ++stats.ranges_skipped;
+            continue;
+        }
+        const std::uint64_t end = std::min<std::uint64_t>(pages, first + per);
+        for (std::uint64_t p = first; p < end; p += LOAD_BATCH) {
+            auto batch = sm.load_range(p, std::min(LOAD_BATCH, end - p));
+            stats.pages_read += batch.size();
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                for (std::size_t slot = 0; slot < MAX_SLOTS; ++slot) {
+                    if (!batch[i]->getRecord(slot, rec)) continue;
+                    try {
+                        const TupleView row(rec);
+                        if (options_.column >= row.size()) continue;
+                        const auto f = row.field(options_.column);
+                        if (f.type != key.type || f.payload != payload) {
+                            continue;
+                        }
+                    } catch (const std::runtime_error &) {
+                        continue;
+                    }
+                    ++stats.matches;
+                    fn(p + i, rec);
+                }
+            }
+        }
+    }
+    return stats;
+}
+
+// Side file: magic, format version, hash version, key column, pages per
+// range, range count, then per range its key count, block count and raw
+// block words.
+void BloomIndex::save() const {
+    const std::string tmp = path_ + ".tmp";
+    {
+        std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+        if (!os) throw std::runtime_error("BloomIndex: cannot write " + tmp);
+        std::lock_guard<std::mutex> lock(mutex_);
+        write_pod(os, BLOOM_MAGIC);
+        write_pod(os, BLOOM_VERSION);
+        write_pod(os, common::HASH_VERSION);
+        write_pod(os, static_cast<uint64_t>(options_.column));
+        write_pod(os, static_cast<uint64_t>(options_.pages_per_range));
+        write_pod(os, static_cast<uint64_t>(ranges_.size()));
+        for (const auto &r : ranges_) {
+            write_pod(os, r.keys.load(std::memory_order_relaxed));
+            write_pod(os, static_cast<uint64_t>(r.filter.num_blocks()));
+            os.write(reinterpret_cast<const char *>(r.filter.data()),
+                     static_cast<std::streamsize>(r.filter.memory_bytes()));
+        }
+        os.flush();
+        if (!os) throw std::runtime_error("BloomIndex: write failed: " + tmp);
+    }
+    std::filesystem::rename(tmp, path_);
+    saved_ = true;
+}
+
+bool BloomIndex::load() {
+    {
+        // Observers of attached pages point into ranges_.
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (attached_) {
+            throw std::runtime_error(
+                "BloomIndex::load: pages are already attached to " + path_);
+        }
+    }
+    std::ifstream is(path_, std::ios::binary);
+    if (!is) return false;
+    uint32_t magic = 0, version = 0, hash_version = 0;
+    uint64_t column = 0, per = 0, count = 0;
+    if (!read_pod(is, magic) || !read_pod(is, version) ||
+        !read_pod(is, hash_version) || !read_pod(is, column) ||
+        !read_pod(is, per) || !read_pod(is, count)) {
+        return false;
+    }
+    if (magic != BLOOM_MAGIC || version != BLOOM_VERSION ||
+        hash_version != common::HASH_VERSION || column != options_.column ||
+        per != options_.pages_per_range) {
+        return false;
+    }
+
+    std::deque<Range> loaded;
+    for (uint64_t r = 0; r < count; ++r) {
+        uint64_t keys = 0, blocks = 0;
+        if (!read_pod(is, keys) || !read_pod(is, blocks) || blocks == 0) {
+            return false;
+        }
+        Range &range = loaded.emplace_back(*this, BloomFilter(blocks));
+        is.read(reinterpret_cast<char *>(range.filter.data()),
+                static_cast<std::streamsize>(range.filter.memory_bytes()));
+        if (!is) return false;
+        range.keys = keys;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    ranges_ = std::move(loaded);
+    saved_ = true;
+    return true;
+}
+
+}  // namespace srd::index
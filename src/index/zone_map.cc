@@ -0,0 +1,397 @@
+#include "srd/index/zone_map.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace srd::index {
+
+using srd::record::FieldType;
+using srd::record::TupleView;
+using srd::storage::MAX_SLOTS;
+using srd::storage::SlottedPage;
+using srd::storage::StorageManager;
+
+namespace {
+
+constexpr uint32_t ZMAP_MAGIC = 0x50414d5a;  // "ZMAP"
+constexpr uint32_t ZMAP_VERSION = 1;
+
+static_assert(std::is_trivially_copyable_v<ColumnZone>,
+              "ColumnZone is written to the side file as raw bytes");
+
+// First 8 bytes of 's', big-endian and zero-padded, so prefixes compare as
+// integers the way the strings compare (up to ties).
+uint64_t string_prefix(std::string_view s) {
+    uint64_t p = 0;
+    for (std::size_t i = 0; i < 8; ++i) {
+        const auto c = i < s.size() ? static_cast<unsigned char>(s[i]) : 0u;
+        p = (p << 8) | c;
+    }
+    return p;
+}
+
+template <typename T>
+void write_pod(std::ostream &os, const T &v) {
+    os.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+template <typename T>
+bool read_pod(std::istream &is, T &v) {
+    is.read(reinterpret_cast<char *>(&v), sizeof(T));
+    return static_cast<bool>(is);
+}
+
+}  // namespace
+
+// ---------------- RangePredicate ----------------
+
+RangePredicate RangePredicate::int_range(std::size_t column, int32_t lo,
+                                         int32_t hi) {
+    RangePredicate p;
+    p.column_ = column;
+    p.kind_ = Kind::INT;
+    p.int_lo_ = lo;
+    p.int_hi_ = hi;
+    return p;
+}
+
+RangePredicate RangePredicate::float_range(std::size_t column, float lo,
+                                           float hi) {
+    RangePredicate p;
+    p.column_ = column;
+    p.kind_ = Kind::FLOAT;
+    p.float_lo_ = lo;
+    p.float_hi_ = hi;
+    return p;
+}
+
+RangePredicate RangePredicate::string_range(std::size_t column,
+                                            std::string lo, std::string hi) {
+    RangePredicate p;
+    p.column_ = column;
+    p.kind_ = Kind::STRING;
+    p.string_lo_ = std::move(lo);
+    p.string_hi_ = std::move(hi);
+    return p;
+}
+
+RangePredicate RangePredicate::missing(std::size_t column) {
+    RangePredicate p;
+    p.column_ = column;
+    p.kind_ = Kind::MISSING;
+    return p;
+}
+
+bool RangePredicate::may_match(const ColumnZone &z) const {
+    switch (kind_) {
+        case Kind::INT:
+            return z.int_count > 0 && z.int_min <= int_hi_ &&
+                   z.int_max >= int_lo_;
+        case Kind::FLOAT:
+            return z.float_count > 0 && z.float_min <= float_hi_ &&
+                   z.float_max >= float_lo_;
+        case Kind::STRING:
+            return z.string_count > 0 &&
+                   z.string_min <= string_prefix(string_hi_) &&
+                   z.string_max >= string_prefix(string_lo_);
+        case Kind::MISSING:
+            return z.missing > 0;
+    }
+    return true;
+}
+
+bool RangePredicate::matches(const TupleView &row) const {
+    if (column_ >= row.size()) return kind_ == Kind::MISSING;
+    const auto f = row.field(column_);
+    switch (kind_) {
+        case Kind::INT: {
+            if (f.type != FieldType::INT) return false;
+            const int32_t v = f.asInt();
+            return v >= int_lo_ && v <= int_hi_;
+        }
+        case Kind::FLOAT: {
+            if (f.type != FieldType::FLOAT) return false;
+            const float v = f.asFloat();
+            return v >= float_lo_ && v <= float_hi_;
+        }
+        case Kind::STRING: {
+            if (f.type != FieldType::STRING) return false;
+            const std::string_view v = f.asString();
+            return v >= string_lo_ && v <= string_hi_;
+        }
+        case Kind::MISSING: return false;
+    }
+    return false;
+}
+
+// ---------------- ZoneMap ----------------
+
+ZoneMap::ZoneMap(std::string data_path, std::vector<std::size_t> columns)
+    : path_(side_path(data_path)), columns_(std::move(columns)) {}
+
+void ZoneMap::Observer::on_insert(std::string_view record) {
+    map_.changed_();
+    map_.add_(zones_, record, +1);
+}
+
+void ZoneMap::Observer::on_erase(std::string_view record) {
+    map_.changed_();
+    map_.add_(zones_, record, -1);
+}
+
+void ZoneMap::Observer::on_compact(
+    const std::vector<std::string_view> &live) {
+    map_.changed_();
+    map_.reset_(zones_);
+    for (auto rec : live) map_.add_(zones_, rec, +1);
+}
+
+void ZoneMap::changed_() const {
+    if (!saved_.load(std::memory_order_relaxed) || !saved_.exchange(false)) {
+        return;
+    }
+    std::error_code ec;
+    std::filesystem::remove(path_, ec);
+}
+
+void ZoneMap::reset_(PageZones &z) const {
+    std::fill(z.columns.begin(), z.columns.end(), ColumnZone{});
+    z.opaque = false;
+}
+
+// Fold one record into (sign > 0) or out of (sign < 0) a page's summary.
+// Removal only adjusts counts; a range is dropped once its count is 0.
+void ZoneMap::add_(PageZones &z, std::string_view record, int sign) const {
+    const auto bump = [sign](uint32_t &n) {
+        n = sign > 0 ? n + 1 : (n > 0 ? n - 1 : 0);
+    };
+    const ColumnZone empty;
+    try {
+        const TupleView row(record);
+        for (std::size_t i = 0; i < columns_.size(); ++i) {
+            ColumnZone &c = z.columns[i];
+            bump(c.rows);
+            if (columns_[i] >= row.size()) {
+                bump(c.missing);
+                continue;
+            }
+            const auto f = row.field(columns_[i]);
+            switch (f.type) {
+                case FieldType::INT: {
+                    bump(c.int_count);
+                    if (sign < 0) {
+                        if (c.int_count == 0) {
+                            c.int_min = empty.int_min;
+                            c.int_max = empty.int_max;
+                        }
+                        break;
+                    }
+                    const int32_t v = f.asInt();
+                    c.int_min = std::min(c.int_min, v);
+                    c.int_max = std::max(c.int_max, v);
+                    break;
+                }
+                case FieldType::FLOAT: {
+                    bump(c.float_count);
+                    if (sign < 0) {
+                        if (c.float_count == 0) {
+                            c.float_min = empty.float_min;
+                            c.float_max = empty.float_max;
+                        }
+                        break;
+                    }
+                    // NaN never satisfies a range, and std::min/max keep
+                    // the first argument, so it never widens one either.
+                    const float v = f.asFloat();
+                    c.float_min = std::min(c.float_min, v);
+                    c.float_max = std::max(c.float_max, v);
+                    break;
+                }
+                case FieldType::STRING: {
+                    bump(c.string_count);
+                    if (sign < 0) {
+                        if (c.string_count == 0) {
+                            c.string_min = empty.string_min;
+                            c.string_max = empty.string_max;
+                        }
+                        break;
+                    }
+                    const uint64_t v = string_prefix(f.asString());
+                    c.string_min = std::min(c.string_min, v);
+                    c.string_max = std::max(c.string_max, v);
+                    break;
+                }
+            }
+        }
+    } catch (const std::runtime_error &) {
+        // Not a tuple (or a corrupt one): the summary cannot be trusted.
+        z.opaque = true;
+    }
+}
+
+ZoneMap::PageZones &ZoneMap::page_(std::uint64_t page_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (pages_.size() <= page_id) {
+        pages_.emplace_back(*this, columns_.size());
+    }
+    return pages_[page_id];
+}
+
+std::size_t ZoneMap::num_pages() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pages_.size();
+}
+
+const ColumnZone &ZoneMap::zone(std::uint64_t page_id,
+                                std::size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pages_.at(page_id).columns.at(index);
+}
+
+void ZoneMap::attach(std::uint64_t page_id, SlottedPage &page) {
+    page.add_observer(&page_(page_id).observer);
+}
+
+void ZoneMap::refresh(std::uint64_t page_id, const SlottedPage &page) {
+    changed_();
+    PageZones &z = page_(page_id);
+    reset_(z);
+    std::string rec;
+    for (std::size_t slot = 0; slot < MAX_SLOTS; ++slot) {
+        if (page.getRecord(slot, rec)) add_(z, rec, +1);
+    }
+}
+
+void ZoneMap::rebuild(StorageManager &sm) {
+    constexpr std::uint64_t BATCH = 16;
+    const std::uint64_t pages = sm.num_pages();
+    changed_();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Observers of dropped pages would dangle; only ever grow.
+        for (auto &z : pages_) reset_(z);
+    }
+    for (std::uint64_t first = 0; first < pages; first += BATCH) {
+        const std::uint64_t n = std::min(BATCH, pages - first);
+        auto batch = sm.load_range(first, n);
+        for (std::uint64_t i = 0; i < n; ++i) refresh(first + i, *batch[i]);
+    }
+}
+
+bool ZoneMap::may_match(std::uint64_t page_id,
+                        const RangePredicate &pred) const {
+    const auto it =
+        std::find(columns_.begin(), columns_.end(), pred.column());
+    if (it == columns_.end()) return true;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (page_id >= pages_.size()) return true;
+    const PageZones &z = pages_[page_id];
+    if (z.opaque) return true;
+    return pred.may_match(z.columns[it - columns_.begin()]);
+}
+
+ZoneScanStats ZoneMap::scan(
+    StorageManager &sm, const RangePredicate &pred,
+    const std::function<void(std::uint64_t, std::string_view)> &fn,
+    std::size_t batch_pages) const {
+    ZoneScanStats stats;
+    const std::uint64_t pages = sm.num_pages();
+    const std::uint64_t batch = std::max<std::size_t>(batch_pages, 1);
+    stats.pages = pages;
+
+    std::string rec;
+    std::uint64_t page = 0;
+    while (page < pages) {
+        if (!may_match(page, pred)) {
+            ++stats.pages_skipped;
+            ++page;
+            continue;
+        }
+        // Extend over the following candidate pages so they load together.
+        std::uint64_t end = page + 1;
+        while (end < pages && end - page < batch && may_match(end, pred)) {
+            ++end;
+        }
+        auto loaded = sm.load_range(page, end - page);
+        for (std::uint64_t i = 0; i < loaded.size(); ++i) {
+            for (std::size_t slot = 0; slot < MAX_SLOTS; ++slot) {
+                if (!loaded[i]->getRecord(slot, rec)) continue;
+                bool hit = false;
+                try {
+                    hit = pred.matches(TupleView(rec));
+                } catch (const std::runtime_error &) {
+                    // not a tuple (opaque page): cannot match
+                }
+                if (!hit) continue;
+                ++stats.records;
+                fn(page + i, rec);
+            }
+        }
+        page = end;
+    }
+    return stats;
+}
+
+// Side file: magic, version, column count, page count, the column ids,
+// then per page a flags word (bit 0 = opaque) and one raw ColumnZone per
+// column.
+void ZoneMap::save() const {
+    const std::string tmp = path_ + ".tmp";
+    {
+        std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+        if (!os) throw std::runtime_error("ZoneMap: cannot write " + tmp);
+        std::lock_guard<std::mutex> lock(mutex_);
+        write_pod(os, ZMAP_MAGIC);
+        write_pod(os, ZMAP_VERSION);
+        write_pod(os, static_cast<uint32_t>(columns_.size()));
+        write_pod(os, static_cast<uint64_t>(pages_.size()));
+        for (auto c : columns_) write_pod(os, static_cast<uint64_t>(c));
+        for (const auto &z : pages_) {
+            write_pod(os, static_cast<uint32_t>(z.opaque ? 1 : 0));
+            for (const auto &c : z.columns) write_pod(os, c);
+        }
+        os.flush();
+        if (!os) throw std::runtime_error("ZoneMap: write failed: " + tmp);
+    }
+    std::filesystem::rename(tmp, path_);
+    saved_ = true;
+}
+
+bool ZoneMap::load() {
+    std::ifstream is(path_, std::ios::binary);
+    if (!is) return false;
+    uint32_t magic = 0, version = 0, ncols = 0;
+    uint64_t npages = 0;
+    if (!read_pod(is, magic) || !read_pod(is, version) ||
+        !read_pod(is, ncols) || !read_pod(is, npages)) {
+        return false;
+    }
+    if (magic != ZMAP_MAGIC || version != ZMAP_VERSION ||
+        ncols != columns_.size()) {
+        return false;
+    }
+    for (auto c : columns_) {
+        uint64_t stored = 0;
+        if (!read_pod(is, stored) || stored != c) return false;
+    }
+
+    std::deque<PageZones> loaded;
+    for (uint64_t p = 0; p < npages; ++p) {
+        PageZones &z = loaded.emplace_back(*this, columns_.size());
+        uint32_t flags = 0;
+        if (!read_pod(is, flags)) return false;
+        z.opaque = (flags & 1) != 0;
+        for (auto &c : z.columns) {
+            if (!read_pod(is, c)) return false;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    pages_ = std::move(loaded);
+    saved_ = true;
+    return true;
+}
+
+}  // namespace srd::index
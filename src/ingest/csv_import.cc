@@ -0,0 +1,485 @@
+#include "srd/ingest/csv_import.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define SRD_CSV_X86 1
+#endif
+
+namespace srd::ingest {
+
+using srd::record::FieldType;
+using srd::storage::MAX_SLOTS;
+using srd::storage::PAGE_SIZE;
+using srd::storage::SlottedPage;
+using srd::storage::StorageManager;
+
+namespace {
+
+// Read-only mapping of a whole file.
+class Mapping {
+   public:
+    explicit Mapping(const std::string &path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("CsvImporter: cannot open " + path +
+                                     ": " + std::strerror(errno));
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            const int err = errno;
+            ::close(fd);
+            throw std::runtime_error("CsvImporter: cannot stat " + path +
+                                     ": " + std::strerror(err));
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ > 0) {
+            void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                const int err = errno;
+                ::close(fd);
+                throw std::runtime_error("CsvImporter: cannot map " + path +
+                                         ": " + std::strerror(err));
+            }
+            ::madvise(p, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char *>(p);
+        }
+        ::close(fd);
+    }
+    ~Mapping() {
+        if (data_) ::munmap(const_cast<char *>(data_), size_);
+    }
+    Mapping(const Mapping &) = delete;
+    Mapping &operator=(const Mapping &) = delete;
+
+    const char *data() const noexcept {
+        return data_;
+    }
+    std::size_t size() const noexcept {
+        return size_;
+    }
+
+   private:
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+// First byte in [p, end) that is the delimiter, the quote or '\n'; end if
+// there is none.
+using FindFn = const char *(*)(const char *, const char *, char, char);
+
+const char *find_scalar(const char *p, const char *end, char delim,
+                        char quote) {
+    for (; p < end; ++p) {
+        const char c = *p;
+        if (c == delim || c == '\n' || c == quote) return p;
+    }
+    return end;
+}
+
+#if defined(SRD_CSV_X86)
+
+// SSE2 is part of x86-64, so this needs no target attribute.
+const char *find_sse2(const char *p, const char *end, char delim,
+                      char quote) {
+    const __m128i d = _mm_set1_epi8(delim);
+    const __m128i n = _mm_set1_epi8('\n');
+    const __m128i q = _mm_set1_epi8(quote);
+    for (; end - p >= 16; p += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, d), _mm_cmpeq_epi8(v, n)),
+            _mm_cmpeq_epi8(v, q));
+        const auto mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+        if (mask != 0) return p + __builtin_ctz(mask);
+    }
+    return find_scalar(p, end, delim, quote);
+}
+
+__attribute__((target("avx2"))) const char *find_avx2(const char *p,
+                                                      const char *end,
+                                                      char delim, char quote) {
+    const __m256i d = _mm256_set1_epi8(delim);
+    const __m256i n = _mm256_set1_epi8('\n');
+    const __m256i q = _mm256_set1_epi8(quote);
+    for (; end - p >= 32; p += 32) {
+        const __m256i v =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        const __m256i hit = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, d), _mm256_cmpeq_epi8(v, n)),
+            _mm256_cmpeq_epi8(v, q));
+        const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask != 0) return p + __builtin_ctz(mask);
+    }
+    return find_sse2(p, end, delim, quote);
+}
+
+#endif
+
+FindFn pick_find() {
+#if defined(SRD_CSV_X86)
+    if (__builtin_cpu_supports("avx2")) return find_avx2;
+    return find_sse2;
+#else
+    return find_scalar;
+#endif
+}
+
+template <typename T>
+void put(std::string &out, const T &v) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+// Append one field in Field::serialize() format. False if the text is not
+// a valid value of 'type'.
+bool append_field(FieldType type, std::string_view text, std::string &rec) {
+    switch (type) {
+        case FieldType::INT: {
+            if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+            int v = 0;
+            const auto r =
+                std::from_chars(text.data(), text.data() + text.size(), v);
+            if (text.empty() || r.ec != std::errc() ||
+                r.ptr != text.data() + text.size()) {
+                return false;
+            }
+            put(rec, static_cast<uint8_t>(type));
+            put(rec, static_cast<uint32_t>(sizeof(int)));
+            put(rec, v);
+            return true;
+        }
+        case FieldType::FLOAT: {
+            if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+            float v = 0;
+            const auto r =
+                std::from_chars(text.data(), text.data() + text.size(), v);
+            if (text.empty() || r.ec != std::errc() ||
+                r.ptr != text.data() + text.size()) {
+                return false;
+            }
+            put(rec, static_cast<uint8_t>(type));
+            put(rec, static_cast<uint32_t>(sizeof(float)));
+            put(rec, v);
+            return true;
+        }
+        case FieldType::STRING:
+            // Payload keeps the terminating NUL, as Field stores it.
+            put(rec, static_cast<uint8_t>(type));
+            put(rec, static_cast<uint32_t>(text.size() + 1));
+            rec.append(text);
+            rec.push_back('\0');
+            return true;
+    }
+    return false;
+}
+
+struct Chunk {
+    std::vector<std::unique_ptr<SlottedPage>> pages;
+    std::uint64_t rows = 0;
+    std::uint64_t bad_rows = 0;
+    std::exception_ptr error;
+};
+
+class ChunkParser {
+   public:
+    ChunkParser(const CsvOptions &o, FindFn find, const char *base)
+        : o_(o), find_(find), base_(base) {}
+
+    // Parse the whole lines in [p, end) into pages.
+    void parse(const char *p, const char *end, Chunk &out) {
+        auto page = std::make_unique<SlottedPage>();
+        // Pages here only ever grow at the tail, so whether the next row
+        // fits is known without asking the page (a failed addRecord would
+        // first try to compact it).
+        std::size_t records = 0;
+        std::size_t tail = page->metadata_size();
+        while (p < end) {
+            const char *line = p;
+            const char *reason = parse_row_(p, end);
+            if (reason == nullptr && blank_) continue;
+            if (reason != nullptr) {
+                if (!o_.skip_bad_rows) {
+                    throw std::runtime_error(
+                        "CsvImporter: bad row at byte " +
+                        std::to_string(line - base_) + ": " + reason);
+                }
+                ++out.bad_rows;
+                continue;
+            }
+            if (records > 0 &&
+                (records == MAX_SLOTS || tail + rec_.size() > PAGE_SIZE)) {
+                out.pages.push_back(std::move(page));
+                page = std::make_unique<SlottedPage>();
+                records = 0;
+                tail = page->metadata_size();
+            }
+            std::size_t slot = 0;
+            if (!page->addRecord(rec_, slot)) {
+                throw std::runtime_error("CsvImporter: row at byte " +
+                                         std::to_string(line - base_) +
+                                         " does not fit in a page");
+            }
+            ++records;
+            tail += rec_.size();
+            ++out.rows;
+        }
+        if (records > 0) out.pages.push_back(std::move(page));
+    }
+
+   private:
+    // Encode the row starting at p into rec_ and move p past its line.
+    // Returns nullptr on success (blank_ set for an empty line) or why the
+    // row is malformed.
+    const char *parse_row_(const char *&p, const char *end) {
+        const std::size_t ncols = o_.schema.size();
+        const char *reason = nullptr;
+        rec_.clear();
+        put(rec_, static_cast<uint32_t>(ncols));
+        blank_ = false;
+        if (*p == '\n' || (*p == '\r' && p + 1 < end && p[1] == '\n')) {
+            p += (*p == '\n') ? 1 : 2;
+            blank_ = true;
+            return nullptr;
+        }
+
+        std::size_t col = 0;
+        for (;;) {
+            std::string_view text;
+            const char *e;
+            if (*p == o_.quote) {
+                e = quoted_(p + 1, end, text);
+                if (e == nullptr) {
+                    reason = "unterminated quote";
+                    e = find_line_end_(p, end);
+                } else if (e < end && *e == '\r' &&
+                           (e + 1 == end || e[1] == '\n')) {
+                    ++e;  // CRLF (or a final CR) after a quoted field
+                } else if (e < end && *e != o_.delimiter && *e != '\n') {
+                    reason = "text after closing quote";
+                    e = find_line_end_(e, end);
+                }
+            } else {
+                const char *s = p;
+                e = find_(p, end, o_.delimiter, o_.quote);
+                // A quote inside an unquoted field is literal.
+                while (e < end && *e == o_.quote) {
+                    e = find_(e + 1, end, o_.delimiter, o_.quote);
+                }
+                const char *t = e;
+                if ((e == end || *e == '\n') && t > s && t[-1] == '\r') --t;
+                text = std::string_view(s, static_cast<std::size_t>(t - s));
+            }
+            if (reason == nullptr) {
+                if (col >= ncols) {
+                    reason = "too many fields";
+                } else if (!append_field(o_.schema[col], text, rec_)) {
+                    reason = "bad value";
+                }
+            }
+            ++col;
+            if (e >= end || *e == '\n') {
+                p = (e >= end) ? end : e + 1;
+                break;
+            }
+            // Delimiter: the next field starts after it, and may be empty
+            // at the very end of the input.
+            p = e + 1;
+            if (p >= end) {
+                if (reason == nullptr && col < ncols &&
+                    !append_field(o_.schema[col], {}, rec_)) {
+                    reason = "bad value";
+                }
+                ++col;
+                break;
+            }
+        }
+        if (reason == nullptr && col != ncols) reason = "wrong field count";
+        return reason;
+    }
+
+    // Quoted field whose body starts at p. Returns the byte after the
+    // closing quote, or nullptr if the line ends first.
+    const char *quoted_(const char *p, const char *end,
+                        std::string_view &text) {
+        const char *s = p;
+        bool escaped = false;
+        for (;;) {
+            const char *q = find_(p, end, o_.quote, o_.quote);
+            if (q >= end || *q == '\n') return nullptr;
+            if (q + 1 < end && q[1] == o_.quote) {
+                escaped = true;
+                p = q + 2;
+                continue;
+            }
+            if (!escaped) {
+                text = std::string_view(s, static_cast<std::size_t>(q - s));
+                return q + 1;
+            }
+            unquoted_.clear();
+            for (const char *c = s; c < q; ++c) {
+                unquoted_.push_back(*c);
+                if (*c == o_.quote) ++c;  // "" -> "
+            }
+            text = unquoted_;
+            return q + 1;
+        }
+    }
+
+    static const char *find_line_end_(const char *p, const char *end) {
+        const void *nl =
+            std::memchr(p, '\n', static_cast<std::size_t>(end - p));
+        return nl ? static_cast<const char *>(nl) : end;
+    }
+
+    const CsvOptions &o_;
+    FindFn find_;
+    const char *base_;
+    std::string rec_;
+    std::string unquoted_;
+    bool blank_ = false;
+};
+
+}  // namespace
+
+CsvImporter::CsvImporter(CsvOptions options) : options_(std::move(options)) {
+    if (options_.schema.empty()) {
+        throw std::runtime_error("CsvImporter: empty schema");
+    }
+    if (options_.delimiter == '\n' || options_.quote == '\n' ||
+        options_.delimiter == options_.quote) {
+        throw std::runtime_error("CsvImporter: bad delimiter or quote");
+    }
+    if (options_.threads == 0) {
+        options_.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    options_.chunk_bytes = std::max<std::size_t>(options_.chunk_bytes, 4096);
+}
+
+CsvImportStats CsvImporter::import(const std::string &path,
+                                   StorageManager &sm) const {
+    const Mapping input(path);
+    const char *const data = input.data();
+    const char *const end = data + input.size();
+
+    CsvImportStats stats;
+    stats.bytes = input.size();
+    // A fresh file has one empty page; use it rather than leaving a hole.
+    stats.first_page = sm.num_pages();
+    if (stats.first_page == 1) {
+        const auto page0 = sm.load(0);
+        std::string rec;
+        bool used = false;
+        for (std::size_t s = 0; s < MAX_SLOTS && !used; ++s) {
+            used = page0->getRecord(s, rec);
+        }
+        if (!used) stats.first_page = 0;
+    }
+
+    const char *begin = data;
+    if (options_.header && begin < end) {
+        const void *nl =
+            std::memchr(begin, '\n', static_cast<std::size_t>(end - begin));
+        begin = nl ? static_cast<const char *>(nl) + 1 : end;
+    }
+
+    // Chunk k covers the lines that start in [k * chunk, (k + 1) * chunk).
+    std::vector<const char *> cuts{begin};
+    for (const char *c = begin + options_.chunk_bytes; c < end;
+         c += options_.chunk_bytes) {
+        const void *nl =
+            std::memchr(c - 1, '\n', static_cast<std::size_t>(end - c + 1));
+        if (nl == nullptr) break;
+        const char *next = static_cast<const char *>(nl) + 1;
+        if (next > cuts.back() && next < end) cuts.push_back(next);
+        c = std::max(c, next - 1);
+    }
+    cuts.push_back(end);
+    const std::size_t nchunks = cuts.size() - 1;
+
+    const FindFn find = pick_find();
+    std::atomic<std::size_t> next_chunk{0};
+    std::mutex mutex;
+    std::condition_variable turn;
+    std::size_t committed = 0;
+    std::uint64_t next_page = stats.first_page;
+    std::exception_ptr error;
+
+    // Chunks are parsed in parallel but appended in order: a worker waits
+    // for its turn only to claim page ids, then writes outside the lock.
+    auto worker = [&] {
+        ChunkParser parser(options_, find, data);
+        for (;;) {
+            const std::size_t k = next_chunk.fetch_add(1);
+            if (k >= nchunks) return;
+            Chunk chunk;
+            try {
+                parser.parse(cuts[k], cuts[k + 1], chunk);
+            } catch (...) {
+                chunk.error = std::current_exception();
+                chunk.pages.clear();
+            }
+
+            std::uint64_t first = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                turn.wait(lock, [&] { return committed == k; });
+                if (error) chunk.pages.clear();
+                if (chunk.error && !error) error = chunk.error;
+                first = next_page;
+                try {
+                    if (!chunk.pages.empty()) {
+                        sm.extend_to(first + chunk.pages.size() - 1);
+                    }
+                    next_page += chunk.pages.size();
+                    stats.rows += chunk.rows;
+                    stats.bad_rows += chunk.bad_rows;
+                } catch (...) {
+                    if (!error) error = std::current_exception();
+                    chunk.pages.clear();
+                }
+                ++committed;
+            }
+            turn.notify_all();
+
+            if (chunk.pages.empty()) continue;
+            std::vector<const SlottedPage *> ptrs;
+            ptrs.reserve(chunk.pages.size());
+            for (const auto &page : chunk.pages) ptrs.push_back(page.get());
+            try {
+                sm.flush_range(first, ptrs);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) error = std::current_exception();
+            }
+        }
+    };
+
+    const std::size_t threads = std::min(options_.threads, nchunks);
+    std::vector<std::thread> pool;
+    for (std::size_t t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool) t.join();
+    if (error) std::rethrow_exception(error);
+
+    stats.pages = next_page - stats.first_page;
+    return stats;
+}
+
+}  // namespace srd::ingest
@@ -0,0 +1,111 @@
+#include "srd/record/key_encoder.hpp"
+
+#include <cstring>
+
+namespace srd::record {
+
+namespace {
+
+constexpr char TAG_MISSING = 0x00;
+constexpr char TAG_INT = 0x01;
+constexpr char TAG_FLOAT = 0x02;
+constexpr char TAG_STRING = 0x03;
+
+void put_be32(uint32_t v, std::string &out) {
+    const char bytes[4] = {static_cast<char>(v >> 24),
+                           static_cast<char>(v >> 16),
+                           static_cast<char>(v >> 8), static_cast<char>(v)};
+    out.append(bytes, 4);
+}
+
+void put_int(int32_t v, std::string &out) {
+    out.push_back(TAG_INT);
+    put_be32(static_cast<uint32_t>(v) ^ 0x80000000u, out);
+}
+
+void put_float(float v, std::string &out) {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &v, sizeof(bits));
+    bits = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    out.push_back(TAG_FLOAT);
+    put_be32(bits, out);
+}
+
+void put_string(std::string_view s, std::string &out) {
+    out.push_back(TAG_STRING);
+    for (char c : s) {
+        out.push_back(c);
+        if (c == '\0') out.push_back('\xff');
+    }
+    out.append(2, '\0');
+}
+
+// Invert the bytes of one DESC column, from 'begin' to the end of 'out'.
+void invert_from(std::size_t begin, std::string &out) {
+    for (std::size_t i = begin; i < out.size(); ++i) {
+        out[i] = static_cast<char>(~out[i]);
+    }
+}
+
+}  // namespace
+
+KeyEncoder::KeyEncoder(std::vector<KeyColumn> columns)
+    : columns_(std::move(columns)) {}
+
+void KeyEncoder::append(const FieldView &field, SortOrder order,
+                        std::string &out) {
+    const std::size_t begin = out.size();
+    switch (field.type) {
+        case FieldType::INT: put_int(field.asInt(), out); break;
+        case FieldType::FLOAT: put_float(field.asFloat(), out); break;
+        case FieldType::STRING: put_string(field.asString(), out); break;
+    }
+    if (order == SortOrder::DESC) invert_from(begin, out);
+}
+
+void KeyEncoder::append(const Field &field, SortOrder order,
+                        std::string &out) {
+    FieldView view;
+    view.type = field.type;
+    view.payload = std::string_view(field.data.get(), field.data_length);
+    append(view, order, out);
+}
+
+void KeyEncoder::append_missing(SortOrder order, std::string &out) {
+    out.push_back(order == SortOrder::DESC ? static_cast<char>(~TAG_MISSING)
+                                           : TAG_MISSING);
+}
+
+void KeyEncoder::encode(const TupleView &row, std::string &out) const {
+    out.clear();
+    for (const auto &k : columns_) {
+        if (k.column >= row.size()) {
+            append_missing(k.order, out);
+        } else {
+            append(row.field(k.column), k.order, out);
+        }
+    }
+}
+
+void KeyEncoder::encode(const Tuple &row, std::string &out) const {
+    out.clear();
+    for (const auto &k : columns_) {
+        if (k.column >= row.fields.size() || !row.fields[k.column]) {
+            append_missing(k.order, out);
+        } else {
+            append(*row.fields[k.column], k.order, out);
+        }
+    }
+}
+
+uint64_t KeyEncoder::prefix(std::string_view key) noexcept {
+    uint64_t p = 0;
+    for (std::size_t i = 0; i < 8; ++i) {
+        const auto c =
+            i < key.size() ? static_cast<unsigned char>(key[i]) : 0u;
+        p = (p << 8) | c;
+    }
+    return p;
+}
+
+}  // namespace srd::record
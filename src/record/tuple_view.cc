@@ -0,0 +1,67 @@
+#include "srd/record/tuple_view.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace srd::record {
+
+namespace {
+
+constexpr std::size_t FIELD_HEADER = sizeof(uint8_t) + sizeof(uint32_t);
+
+}  // namespace
+
+int FieldView::asInt() const {
+    if (type != FieldType::INT || payload.size() != sizeof(int))
+        throw std::runtime_error("FieldView: not int");
+    int v = 0;
+    std::memcpy(&v, payload.data(), sizeof(int));
+    return v;
+}
+
+float FieldView::asFloat() const {
+    if (type != FieldType::FLOAT || payload.size() != sizeof(float))
+        throw std::runtime_error("FieldView: not float");
+    float v = 0.0f;
+    std::memcpy(&v, payload.data(), sizeof(float));
+    return v;
+}
+
+std::string_view FieldView::asString() const {
+    if (type != FieldType::STRING)
+        throw std::runtime_error("FieldView: not string");
+    std::string_view s = payload;
+    if (!s.empty() && s.back() == '\0') s.remove_suffix(1);
+    return s;
+}
+
+TupleView::TupleView(std::string_view record) : record_(record) {
+    if (record_.size() < sizeof(uint32_t))
+        throw std::runtime_error("TupleView: record too short");
+    std::memcpy(&count_, record_.data(), sizeof(uint32_t));
+}
+
+FieldView TupleView::field(std::size_t index) const {
+    if (index >= count_) throw std::out_of_range("TupleView: no such field");
+
+    std::size_t pos = sizeof(uint32_t);
+    for (std::size_t i = 0;; ++i) {
+        if (pos + FIELD_HEADER > record_.size())
+            throw std::runtime_error("TupleView: truncated field header");
+        uint32_t len = 0;
+        std::memcpy(&len, record_.data() + pos + sizeof(uint8_t),
+                    sizeof(uint32_t));
+        if (len > record_.size() - pos - FIELD_HEADER)
+            throw std::runtime_error("TupleView: truncated field payload");
+        if (i == index) {
+            FieldView f;
+            f.type = static_cast<FieldType>(
+                static_cast<uint8_t>(record_[pos]));
+            f.payload = record_.substr(pos + FIELD_HEADER, len);
+            return f;
+        }
+        pos += FIELD_HEADER + len;
+    }
+}
+
+}  // namespace srd::record
@@ -0,0 +1,124 @@
+#include "srd/storage/checkpointer.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "srd/common/rate_limiter.hpp"
+
+namespace srd::storage {
+
+Checkpointer::Checkpointer(StorageManager &sm, CheckpointOptions options)
+    : sm_(sm), options_(options) {
+    options_.batch_pages = std::max<std::size_t>(options_.batch_pages, 1);
+    thread_ = std::thread([this] { run_(); });
+}
+
+Checkpointer::~Checkpointer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+    if (!dirty_.empty() && error_) {
+        try {
+            std::rethrow_exception(error_);
+        } catch (const std::exception &e) {
+            spdlog::warn("Checkpointer: '{}' has {} unwritten pages: {}",
+                         sm_.path(), dirty_.size(), e.what());
+        }
+    }
+}
+
+void Checkpointer::mark_dirty(std::uint64_t page_id, const SlottedPage *page) {
+    bool first = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        first = dirty_.empty();
+        dirty_[page_id] = page;
+    }
+    if (first) wake_.notify_one();
+}
+
+void Checkpointer::checkpoint() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const std::uint64_t want = rounds_started_ + 1;
+    requested_ = std::max(requested_, want);
+    wake_.notify_one();
+    done_.wait(lock, [&] { return rounds_done_ >= want; });
+    // Rounds run one at a time, so if none since 'want' succeeded, the
+    // latest one failed and error_ is its failure.
+    if (last_ok_round_ < want) std::rethrow_exception(error_);
+}
+
+std::size_t Checkpointer::dirty_pages() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dirty_.size();
+}
+
+CheckpointStats Checkpointer::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void Checkpointer::run_() {
+    common::RateLimiter limiter(options_.bytes_per_sec);
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [&] {
+            return stop_ || requested_ > rounds_started_ || !dirty_.empty();
+        });
+        // Let the dirty set settle for an interval unless someone waits.
+        wake_.wait_for(lock, options_.interval, [&] {
+            return stop_ || requested_ > rounds_started_;
+        });
+        if (dirty_.empty() && requested_ <= rounds_started_) {
+            if (stop_) return;
+            continue;
+        }
+
+        std::vector<std::pair<std::uint64_t, const SlottedPage *>> pages(
+            dirty_.begin(), dirty_.end());
+        dirty_.clear();
+        ++rounds_started_;
+        lock.unlock();
+
+        std::uint64_t runs = 0;
+        try {
+            std::sort(pages.begin(), pages.end());
+            for (std::size_t i = 0; i < pages.size();
+                 i += options_.batch_pages) {
+                const std::size_t n =
+                    std::min(options_.batch_pages, pages.size() - i);
+                runs += sm_.flush_pages(
+                    {pages.begin() + static_cast<std::ptrdiff_t>(i),
+                     pages.begin() + static_cast<std::ptrdiff_t>(i + n)});
+                limiter.acquire(n * PAGE_SIZE);
+            }
+            sm_.sync();
+        } catch (...) {
+            lock.lock();
+            // Back into the dirty set, behind any newer mark of the page.
+            for (const auto &[id, page] : pages) dirty_.try_emplace(id, page);
+            error_ = std::current_exception();
+            ++rounds_done_;
+            ++stats_.failed_rounds;
+            done_.notify_all();
+            // The final round on destruction is not retried.
+            if (stop_) return;
+            continue;
+        }
+
+        lock.lock();
+        last_ok_round_ = ++rounds_done_;
+        ++stats_.rounds;
+        stats_.pages_written += pages.size();
+        stats_.runs += runs;
+        done_.notify_all();
+    }
+}
+
+}  // namespace srd::storage
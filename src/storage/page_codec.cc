@@ -0,0 +1,176 @@
+#include "srd/storage/page_codec.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace srd::storage {
+
+namespace {
+
+constexpr std::size_t MIN_MATCH = 4;
+constexpr std::size_t HASH_BITS = 12;
+constexpr std::size_t MAX_OFFSET = 65535;
+// Fixed copy width of the decoder's fast paths.
+constexpr std::size_t WILD = 16;
+
+inline uint32_t read32(const unsigned char *p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline std::size_t hash4(uint32_t v) {
+    return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+void put_length(std::string &out, std::size_t len) {
+    while (len >= 255) {
+        out.push_back(static_cast<char>(255));
+        len -= 255;
+    }
+    out.push_back(static_cast<char>(len));
+}
+
+void put_sequence(std::string &out, const unsigned char *lit,
+                  std::size_t lit_len, std::size_t offset,
+                  std::size_t match_len) {
+    const std::size_t m = match_len == 0 ? 0 : match_len - MIN_MATCH;
+    const auto token = static_cast<unsigned char>(
+        ((lit_len < 15 ? lit_len : 15) << 4) | (m < 15 ? m : 15));
+    out.push_back(static_cast<char>(token));
+    if (lit_len >= 15) put_length(out, lit_len - 15);
+    out.append(reinterpret_cast<const char *>(lit), lit_len);
+    if (match_len == 0) return;
+    out.push_back(static_cast<char>(offset & 0xff));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (m >= 15) put_length(out, m - 15);
+}
+
+[[noreturn]] void corrupt() {
+    throw std::runtime_error("PageCodec: corrupt block");
+}
+
+}  // namespace
+
+void PageCodec::compress(std::string_view in, std::string &out) {
+    if (in.size() > MAX_OFFSET + 1) {
+        throw std::runtime_error("PageCodec: input larger than 64 KiB");
+    }
+    out.clear();
+    out.reserve(max_compressed_size(in.size()));
+    const auto *src = reinterpret_cast<const unsigned char *>(in.data());
+    const std::size_t n = in.size();
+
+    // Positions + 1, so 0 means "empty".
+    uint32_t table[std::size_t{1} << HASH_BITS] = {};
+    std::size_t anchor = 0;
+    std::size_t i = 0;
+    while (i + MIN_MATCH <= n) {
+        const uint32_t v = read32(src + i);
+        const std::size_t h = hash4(v);
+        const std::size_t cand = table[h];
+        table[h] = static_cast<uint32_t>(i + 1);
+        if (cand == 0 || read32(src + cand - 1) != v) {
+            ++i;
+            continue;
+        }
+        const std::size_t from = cand - 1;
+        std::size_t len = MIN_MATCH;
+        while (i + len + 8 <= n) {
+            uint64_t a, b;
+            std::memcpy(&a, src + from + len, 8);
+            std::memcpy(&b, src + i + len, 8);
+            if (a != b) break;  // the byte loop below finds where
+            len += 8;
+        }
+        while (i + len < n && src[from + len] == src[i + len]) ++len;
+        put_sequence(out, src + anchor, i - anchor, i - from, len);
+        i += len;
+        anchor = i;
+        // Seed the table near the end of the match so the next one can
+        // start right away.
+        if (i - 2 + MIN_MATCH <= n) {
+            table[hash4(read32(src + i - 2))] = static_cast<uint32_t>(i - 1);
+        }
+    }
+    put_sequence(out, src + anchor, n - anchor, 0, 0);
+}
+
+void PageCodec::decompress(std::string_view in, char *out,
+                           std::size_t out_size) {
+    const auto *ip = reinterpret_cast<const unsigned char *>(in.data());
+    const auto *const in_end = ip + in.size();
+    auto *const out_begin = reinterpret_cast<unsigned char *>(out);
+    auto *const out_end = out_begin + out_size;
+    unsigned char *op = out_begin;
+
+    auto read_length = [&](std::size_t len) {
+        unsigned char b;
+        do {
+            if (ip == in_end) corrupt();
+            b = *ip++;
+            len += b;
+        } while (b == 255);
+        return len;
+    };
+
+    for (;;) {
+        if (ip == in_end) corrupt();
+        const unsigned char token = *ip++;
+        std::size_t lit = token >> 4;
+        if (lit == 15) lit = read_length(lit);
+        if (lit > static_cast<std::size_t>(in_end - ip) ||
+            lit > static_cast<std::size_t>(out_end - op)) {
+            corrupt();
+        }
+        if (lit <= WILD && static_cast<std::size_t>(in_end - ip) >= WILD &&
+            static_cast<std::size_t>(out_end - op) >= WILD) {
+            std::memcpy(op, ip, WILD);  // fixed size: inlined, may overrun
+        } else {
+            std::memcpy(op, ip, lit);
+        }
+        ip += lit;
+        op += lit;
+        if (ip == in_end) break;  // last sequence: literals only
+
+        if (in_end - ip < 2) corrupt();
+        const std::size_t offset = ip[0] | (std::size_t{ip[1]} << 8);
+        ip += 2;
+        std::size_t len = token & 15;
+        if (len == 15) len = read_length(len);
+        len += MIN_MATCH;
+        if (offset == 0 ||
+            offset > static_cast<std::size_t>(op - out_begin) ||
+            len > static_cast<std::size_t>(out_end - op)) {
+            corrupt();
+        }
+        const unsigned char *match = op - offset;
+        if (offset >= WILD &&
+            static_cast<std::size_t>(out_end - op) >= len + WILD) {
+            // Common case: far enough back that 16-byte steps never read
+            // bytes they write, with room to overrun past the match.
+            for (std::size_t done = 0; done < len; done += WILD) {
+                std::memcpy(op + done, match + done, WILD);
+            }
+        } else if (offset == 1) {
+            // Run of one byte (the free gap of a page).
+            std::memset(op, *match, len);
+        } else {
+            // Overlapping matches repeat the last 'offset' bytes. Copy from
+            // the start of the pattern with a window that doubles each step
+            // (always a whole number of periods, never overlapping itself),
+            // so a short pattern spanning a page takes a handful of copies.
+            for (std::size_t done = 0; done < len;) {
+                const std::size_t step = std::min(offset + done, len - done);
+                std::memcpy(op + done, match, step);
+                done += step;
+            }
+        }
+        op += len;
+    }
+    if (op != out_end) corrupt();
+}
+
+}  // namespace srd::storage
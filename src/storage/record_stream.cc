@@ -0,0 +1,90 @@
+#include "srd/storage/record_stream.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace srd::storage {
+
+// ---- RecordWriter ----
+
+RecordWriter::RecordWriter(StorageManager &sm, std::uint64_t first_page,
+                           std::size_t batch_pages)
+    : sm_(sm),
+      next_page_(first_page),
+      batch_pages_(std::max<std::size_t>(batch_pages, 1)) {}
+
+void RecordWriter::append(std::string_view record) {
+    // Pages here only grow at the tail, so whether the record fits is known
+    // without asking the page (a failed addRecord would first try to compact
+    // it, and log).
+    if (current_ && current_records_ > 0 &&
+        (current_records_ == MAX_SLOTS ||
+         current_tail_ + record.size() > PAGE_SIZE)) {
+        pending_.push_back(std::move(current_));
+        if (pending_.size() >= batch_pages_) write_pending_();
+    }
+    if (!current_) {
+        current_ = std::make_unique<SlottedPage>();
+        current_records_ = 0;
+        current_tail_ = current_->metadata_size();
+    }
+    std::size_t slot = 0;
+    if (!current_->addRecord(record, slot)) {
+        throw std::length_error("RecordWriter: record larger than a page");
+    }
+    ++current_records_;
+    current_tail_ += record.size();
+    ++records_;
+}
+
+void RecordWriter::write_pending_() {
+    if (pending_.empty()) return;
+    sm_.extend_to(next_page_ + pending_.size() - 1);
+    std::vector<const SlottedPage *> pages;
+    pages.reserve(pending_.size());
+    for (const auto &p : pending_) pages.push_back(p.get());
+    sm_.flush_range(next_page_, pages);
+    next_page_ += pending_.size();
+    pages_written_ += pending_.size();
+    pending_.clear();
+}
+
+std::uint64_t RecordWriter::finish() {
+    if (current_) pending_.push_back(std::move(current_));
+    write_pending_();
+    return pages_written_;
+}
+
+// ---- RecordReader ----
+
+RecordReader::RecordReader(StorageManager &sm, std::uint64_t first_page,
+                           std::uint64_t end_page,
+                           std::size_t read_ahead_pages)
+    : sm_(sm),
+      next_page_(first_page),
+      end_page_(end_page == 0 ? sm.num_pages() : end_page),
+      read_ahead_(std::max<std::size_t>(read_ahead_pages, 1)) {}
+
+bool RecordReader::next(std::string &record) {
+    for (;;) {
+        while (batch_index_ < batch_.size()) {
+            const SlottedPage &page = *batch_[batch_index_];
+            while (slot_ < MAX_SLOTS) {
+                if (page.getRecord(slot_++, record)) return true;
+            }
+            ++batch_index_;
+            slot_ = 0;
+        }
+        if (next_page_ >= end_page_) return false;
+
+        const auto count = static_cast<std::size_t>(
+            std::min<std::uint64_t>(read_ahead_, end_page_ - next_page_));
+        batch_ = sm_.load_range(next_page_, count);
+        batch_first_ = next_page_;
+        batch_index_ = 0;
+        slot_ = 0;
+        next_page_ += count;
+    }
+}
+
+}  // namespace srd::storage
@@ -1,13 +1,26 @@
 #include "srd/storage/slotted_page.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <cstring>
 #include <limits>
+#include <mutex>
+#include <shared_mutex>
 #include <sstream>
 
 namespace srd::storage {
 
+namespace {
+
+// Slot entries and record bytes are read by optimistic readers while a
+// writer holds the latch, so writers store them with PageLatch::store_bytes.
+void store_slot(Slot &dst, const Slot &value) {
+    PageLatch::store_bytes(&dst, &value, sizeof(Slot));
+}
+
+}  // namespace
+
 std::shared_ptr<spdlog::logger> SlottedPage::logger = [] {
     auto lg = spdlog::stdout_color_mt("slotted_page");
     lg->set_level(spdlog::level::debug);
@@ -24,16 +37,20 @@ SlottedPage::SlottedPage() {
 }
 
 bool SlottedPage::addTuple(std::unique_ptr<Tuple> tuple) {
-    const std::string serialized = tuple->serialize();
-    const size_t tuple_size = serialized.size();
-    if (tuple_size > std::numeric_limits<uint16_t>::max()) return false;
+    size_t slot_id = 0;
+    return addRecord(tuple->serialize(), slot_id);
+}
+
+bool SlottedPage::addRecord(std::string_view record, size_t &slot_id) {
+    if (record.empty()) return false;
+    if (record.size() > std::numeric_limits<uint16_t>::max()) return false;
 
+    std::unique_lock<PageLatch> guard(latch_);
     Slot *slots = reinterpret_cast<Slot *>(page_data_.get());
-    const size_t meta_size = metadata_size();
 
-    size_t slot_id = 0;
+    slot_id = 0;
     for (; slot_id < MAX_SLOTS; ++slot_id) {
-        if (slots[slot_id].empty) break;
+        if (!in_use_(slots[slot_id])) break;
     }
 
     if (slot_id == MAX_SLOTS) {
@@ -41,6 +58,60 @@ bool SlottedPage::addTuple(std::unique_ptr<Tuple> tuple) {
         return false;
     }
 
+    if (!place_(slots, slot_id, record)) return false;
+    for (PageObserver *o : observers_) o->on_insert(record);
+    return true;
+}
+
+bool SlottedPage::updateRecord(size_t index, std::string_view record) {
+    if (index >= MAX_SLOTS || record.empty()) return false;
+    if (record.size() > std::numeric_limits<uint16_t>::max()) return false;
+
+    std::unique_lock<PageLatch> guard(latch_);
+    Slot *slots = reinterpret_cast<Slot *>(page_data_.get());
+    Slot &s = slots[index];
+    if (!in_use_(s)) return false;
+
+    // Observers see the update as erase + insert; keep the old bytes for
+    // them since both paths below may overwrite them.
+    std::string old_record;
+    if (!observers_.empty()) {
+        old_record.assign(page_data_.get() + s.offset, s.length);
+    }
+    bool compacted = false;
+
+    if (record.size() <= s.length) {
+        PageLatch::store_bytes(page_data_.get() + s.offset, record.data(),
+                               record.size());
+        Slot shrunk = s;
+        shrunk.length = static_cast<uint16_t>(record.size());
+        store_slot(s, shrunk);
+    } else {
+        // Grow: release the old bytes and place the record like an insert.
+        // place_ only compacts when it is sure to succeed, so on failure
+        // the old bytes are untouched and the slot can simply be restored.
+        const Slot saved = s;
+        Slot released = s;
+        released.empty = true;
+        store_slot(s, released);
+        if (!place_(slots, index, record, &compacted)) {
+            store_slot(s, saved);
+            return false;
+        }
+    }
+    for (PageObserver *o : observers_) {
+        // A compaction already told the observer the old record is gone.
+        if (!compacted) o->on_erase(old_record);
+        o->on_insert(record);
+    }
+    return true;
+}
+
+bool SlottedPage::place_(Slot *slots, size_t slot_id, std::string_view record,
+                         bool *compacted) {
+    const size_t tuple_size = record.size();
+    const size_t meta_size = metadata_size();
+
     auto add_tuple_helper = [&](bool do_compact) -> bool {
         if (do_compact) {
             // check again if the record can fit in the total free space
@@ -52,6 +123,7 @@ bool SlottedPage::addTuple(std::unique_ptr<Tuple> tuple) {
                 return false;
             }
             compact_();  // if there is enough free space, call compact()
+            if (compacted) *compacted = true;
         }
 
         // now the empty space are all at the tail of the page
@@ -68,11 +140,14 @@ bool SlottedPage::addTuple(std::unique_ptr<Tuple> tuple) {
             return false;
         }
 
-        slots[slot_id].empty = false;
-        slots[slot_id].offset = static_cast<uint16_t>(offset);
-        slots[slot_id].length = static_cast<uint16_t>(tuple_size);
-
-        std::memcpy(page_data_.get() + offset, serialized.data(), tuple_size);
+        // Bytes first: the slot only points at them once they are there.
+        PageLatch::store_bytes(page_data_.get() + offset, record.data(),
+                               tuple_size);
+        Slot placed;
+        placed.empty = false;
+        placed.offset = static_cast<uint16_t>(offset);
+        placed.length = static_cast<uint16_t>(tuple_size);
+        store_slot(slots[slot_id], placed);
         return true;
     };
 
@@ -91,8 +166,7 @@ void SlottedPage::compact_() {
     size_t used = 0;
     for (uint16_t i = 0; i < MAX_SLOTS; ++i) {
         const auto &s = slots[i];
-        if (!s.empty && s.offset != INVALID_VALUE &&
-            s.length != INVALID_VALUE) {
+        if (in_use_(s)) {
             offset_to_slot[s.offset] = static_cast<int16_t>(i);
             ++used;
         }
@@ -110,42 +184,94 @@ void SlottedPage::compact_() {
         Slot &s = slots[slot_id];
         const size_t seg_len = s.length;
         if (offset != cursor) {
-            std::memmove(page_data_.get() + cursor, page_data_.get() + offset,
-                         seg_len);
-            s.offset = static_cast<uint16_t>(cursor);
+            // Moves toward the front, which store_bytes allows.
+            PageLatch::store_bytes(page_data_.get() + cursor,
+                                   page_data_.get() + offset, seg_len);
+            Slot moved = s;
+            moved.offset = static_cast<uint16_t>(cursor);
+            store_slot(s, moved);
         }
         cursor += seg_len;
         offset += seg_len;
     }
     if (cursor < PAGE_SIZE) {
-        std::memset(page_data_.get() + cursor, 0, PAGE_SIZE - cursor);
+        PageLatch::store_bytes(page_data_.get() + cursor, nullptr,
+                               PAGE_SIZE - cursor);
         logger->info("compact finished, {} free bytes at tail.",
                      PAGE_SIZE - cursor);
     }
+
+    if (!observers_.empty()) {
+        std::vector<std::string_view> live;
+        for (size_t i = 0; i < MAX_SLOTS; ++i) {
+            if (in_use_(slots[i])) {
+                live.emplace_back(page_data_.get() + slots[i].offset,
+                                  slots[i].length);
+            }
+        }
+        for (PageObserver *o : observers_) o->on_compact(live);
+    }
 }
 
 bool SlottedPage::deleteTuple(size_t index) {
     if (index >= MAX_SLOTS) return false;
 
+    std::unique_lock<PageLatch> guard(latch_);
     Slot *slots = reinterpret_cast<Slot *>(page_data_.get());
 
     if (!slots[index].empty) {
-        slots[index].empty = true;
+        if (in_use_(slots[index])) {
+            const std::string_view record(
+                page_data_.get() + slots[index].offset, slots[index].length);
+            for (PageObserver *o : observers_) o->on_erase(record);
+        }
+        Slot erased = slots[index];
+        erased.empty = true;
+        store_slot(slots[index], erased);
     }
 
     return true;
 }
 
-bool SlottedPage::getTuple(size_t index, srd::record::Tuple &out) const {
-    if (index >= MAX_SLOTS) return false;
+bool SlottedPage::read_record_(size_t index, std::string &out) const {
+    // Optimistic attempts copy without latching and retry if a writer got in
+    // between; a torn copy is never deserialized.
+    constexpr int OPTIMISTIC_ATTEMPTS = 8;
     const Slot *slots = reinterpret_cast<const Slot *>(page_data_.get());
+    for (int attempt = 0; attempt < OPTIMISTIC_ATTEMPTS; ++attempt) {
+        uint64_t version = 0;
+        if (!latch_.read_begin(version)) continue;
+        Slot s;
+        PageLatch::load_bytes(&s, &slots[index], sizeof(Slot));
+        const bool live =
+            in_use_(s) && size_t{s.offset} + s.length <= PAGE_SIZE;
+        if (live) {
+            out.resize(s.length);
+            PageLatch::load_bytes(out.data(), page_data_.get() + s.offset,
+                                  s.length);
+        }
+        if (latch_.validate(version)) return live;
+    }
+
+    std::shared_lock<PageLatch> guard(latch_);
     const Slot &s = slots[index];
-    if (s.empty || s.offset == INVALID_VALUE || s.length == INVALID_VALUE)
-        return false;
+    if (!in_use_(s)) return false;
+    out.assign(page_data_.get() + s.offset, s.length);
+    return true;
+}
 
-    // Construct bounded string from the page bytes (no over-read)
-    const char *tuple_data = page_data_.get() + s.offset;
-    std::string rec(tuple_data, s.length);
+bool SlottedPage::getRecord(size_t index, std::string &out) const {
+    if (index >= MAX_SLOTS) return false;
+    return read_record_(index, out);
+}
+
+bool SlottedPage::getTuple(size_t index, srd::record::Tuple &out) const {
+    if (index >= MAX_SLOTS) return false;
+
+    // Copy the bounded record out of the page (no over-read), then decode
+    // it without holding anything.
+    std::string rec;
+    if (!read_record_(index, rec)) return false;
     std::istringstream iss(rec);
     auto tup = srd::record::Tuple::deserialize(iss);
     if (!tup) return false;
@@ -153,7 +279,26 @@ bool SlottedPage::getTuple(size_t index, srd::record::Tuple &out) const {
     return true;
 }
 
+void SlottedPage::add_observer(PageObserver *observer) {
+    std::unique_lock<PageLatch> guard(latch_);
+    if (std::find(observers_.begin(), observers_.end(), observer) ==
+        observers_.end()) {
+        observers_.push_back(observer);
+    }
+}
+
+void SlottedPage::remove_observer(PageObserver *observer) {
+    std::unique_lock<PageLatch> guard(latch_);
+    std::erase(observers_, observer);
+}
+
+void SlottedPage::clear_observers() {
+    std::unique_lock<PageLatch> guard(latch_);
+    observers_.clear();
+}
+
 void SlottedPage::print() const {
+    std::shared_lock<PageLatch> guard(latch_);
     const Slot *slots = reinterpret_cast<const Slot *>(page_data_.get());
     std::cout << std::endl;
     std::cout << "current tail: " << tail_end_(slots) << std::endl;
@@ -163,8 +308,7 @@ void SlottedPage::print() const {
     std::cout << std::endl;
     for (size_t i = 0; i < MAX_SLOTS; ++i) {
         const Slot &s = slots[i];
-        if (!s.empty) {
-            assert(s.offset != INVALID_VALUE);
+        if (in_use_(s)) {
             const char *tuple_data = page_data_.get() + s.offset;
             std::string rec(tuple_data, s.length);  // bounded
             std::istringstream iss(rec);
@@ -177,12 +321,16 @@ void SlottedPage::print() const {
     }
 }
 
+std::size_t SlottedPage::used_bytes() const {
+    std::shared_lock<PageLatch> guard(latch_);
+    return used_bytes_(reinterpret_cast<const Slot *>(page_data_.get()));
+}
+
 size_t SlottedPage::used_bytes_(const Slot *slots) const {
     size_t used = 0;
     for (size_t i = 0; i < MAX_SLOTS; ++i) {
         const Slot &s = slots[i];
-        if (!s.empty && s.length != INVALID_VALUE &&
-            s.offset != INVALID_VALUE) {
+        if (in_use_(s)) {
             used += s.length;
         }
     }
@@ -193,8 +341,7 @@ size_t SlottedPage::tail_end_(const Slot *slots) const {
     size_t tail = metadata_size();
     for (size_t i = 0; i < MAX_SLOTS; ++i) {
         const Slot &s = slots[i];
-        if (!s.empty && s.length != INVALID_VALUE &&
-            s.offset != INVALID_VALUE) {
+        if (in_use_(s)) {
             size_t end = static_cast<size_t>(s.offset) + s.length;
             if (end > tail) tail = end;
         }
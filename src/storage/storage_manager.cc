@@ -1,105 +1,1064 @@
 #include "srd/storage/storage_manager.hpp"
 
+#include <fcntl.h>
 #include <spdlog/spdlog.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
+#if defined(__linux__)
+#include <linux/fs.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <iterator>
+#include <shared_mutex>
 #include <stdexcept>
-#include <vector>
+
+#include "srd/common/checksum.hpp"
+#include "srd/common/rate_limiter.hpp"
+#include "srd/storage/page_codec.hpp"
 
 namespace srd::storage {
 
-StorageManager::StorageManager(std::string path) : path_(std::move(path)) {
+namespace {
+
+std::runtime_error io_error(const std::string &what, int err) {
+    return std::runtime_error(what + ": " + std::strerror(err));
+}
+
+// Compressed files: every extent starts with this header, followed by the
+// stored page (PageCodec block, or the raw image when that is not
+// smaller) and zero padding up to 'capacity'. The header makes the file
+// self-describing, so the page map can be rebuilt by walking it: 'seq'
+// grows with every extent written, so the highest one of a page is its
+// latest image wherever it lies in the file.
+struct ExtentHeader {
+    uint32_t magic;
+    uint32_t stored;
+    uint64_t page_id;
+    uint32_t capacity;
+    uint32_t crc;
+    uint64_t seq;
+};
+static_assert(sizeof(ExtentHeader) == 32, "ExtentHeader layout changed");
+
+constexpr uint32_t EXTENT_MAGIC = 0x59445253;  // "SRDY"
+constexpr uint32_t PMAP_MAGIC = 0x50414d50;    // "PMAP"
+constexpr uint32_t PMAP_VERSION = 2;
+constexpr uint32_t LSIZE_MAGIC = 0x5a49534c;  // "LSIZ"
+constexpr std::size_t EXTENT_GRANULE = 64;
+// Longest run of adjacent extents fetched with a single read.
+constexpr std::size_t MAX_READ_RUN = std::size_t{1} << 20;
+
+std::size_t round_up(std::size_t n, std::size_t to) {
+    return (n + to - 1) / to * to;
+}
+
+void pread_fully(int fd, char *buf, std::size_t len, off_t offset) {
+    while (len > 0) {
+        const ssize_t n = ::pread(fd, buf, len, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw io_error("StorageManager::load read failed", errno);
+        if (n == 0) {
+            throw std::runtime_error("StorageManager::load short read");
+        }
+        buf += n;
+        len -= static_cast<std::size_t>(n);
+        offset += n;
+    }
+}
+
+void pwrite_fully(int fd, const char *buf, std::size_t len, off_t offset) {
+    while (len > 0) {
+        const ssize_t n = ::pwrite(fd, buf, len, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw io_error("StorageManager::flush write failed", errno);
+        buf += n;
+        len -= static_cast<std::size_t>(n);
+        offset += n;
+    }
+}
+
+// Make a file's completed writes durable, or throw.
+void sync_fd(int fd, const std::string &path) {
+    int rc;
+    do {
+        rc = ::fdatasync(fd);
+    } while (rc != 0 && errno == EINTR);
+    if (rc != 0) {
+        throw io_error("StorageManager: cannot sync file: " + path, errno);
+    }
+}
+
+// Aligned buffer of 'pages' pages, usable for O_DIRECT transfers.
+PageBuffer make_buffer(std::size_t pages) {
+    return PageBuffer(static_cast<char *>(::operator new[](
+        pages * PAGE_SIZE, std::align_val_t{PAGE_ALIGNMENT})));
+}
+
+bool all_zero(const char *p, std::size_t len) {
+    return p[0] == 0 && std::memcmp(p, p + 1, len - 1) == 0;
+}
+
+// Clone all of 'src' into 'dst' sharing extents, if the filesystem can.
+bool reflink(int dst, int src) {
+#if defined(__linux__) && defined(FICLONE)
+    return ::ioctl(dst, FICLONE, src) == 0;
+#else
+    (void)dst;
+    (void)src;
+    return false;
+#endif
+}
+
+}  // namespace
+
+struct StorageManager::Snapshot {
+    int fd = -1;
+    std::uint64_t pages = 0;
+    // copied[p] is set once page p's pre-snapshot image is in the target;
+    // checked without 'mutex' on the write path.
+    std::unique_ptr<std::atomic<uint8_t>[]> copied;
+    // Serializes copies, which share 'buffer'.
+    std::mutex mutex;
+    PageBuffer buffer;
+    std::size_t buffer_pages = 0;
+    std::uint64_t copied_by_writers = 0;
+};
+
+StorageManager::StorageManager(std::string path, StorageOptions options)
+    : path_(std::move(path)), options_(options) {
     open_or_create_();
-    recompute_pages_();
-    if (num_pages_ == 0) extend_one();
-    spdlog::info("StorageManager opened '{}', pages={}", path_, num_pages_);
+    if (options_.compressed) {
+        open_compressed_();
+    } else {
+        recompute_pages_();
+    }
+    if (num_pages() == 0) extend_one();
+    spdlog::info("StorageManager opened '{}', pages={}", path_, num_pages());
 }
 
 StorageManager::~StorageManager() {
     std::lock_guard<std::mutex> lock(io_mutex_);
-    if (file_.is_open()) {
-        file_.flush();
-        file_.close();
+    if (fd_ < 0) return;
+    if (options_.compressed) {
+        try {
+            sync_compressed_();
+        } catch (const std::exception &e) {
+            spdlog::warn("StorageManager: saving page map of '{}' failed: "
+                         "{}",
+                         path_, e.what());
+        }
+        ::close(fd_);
+        fd_ = -1;
+        return;
+    }
+    // Give back the reservation beyond the last logical page so that the
+    // next open sees exactly num_pages() pages. The side file may only go
+    // once the shorter size is durable.
+    const auto logical = static_cast<off_t>(num_pages()) * PAGE_SIZE;
+    if (capacity_pages() != num_pages() && ::ftruncate(fd_, logical) != 0) {
+        spdlog::warn("StorageManager: trimming '{}' failed: {}", path_,
+                     std::strerror(errno));
+    } else if (has_logical_file_ && ::fsync(fd_) == 0) {
+        std::error_code ec;
+        std::filesystem::remove(logical_size_path(path_), ec);
+        has_logical_file_ = false;
+    }
+    if (has_logical_file_ && saved_logical_ != num_pages()) {
+        try {
+            save_logical_size_();
+        } catch (const std::exception &e) {
+            spdlog::warn("StorageManager: {}", e.what());
+        }
     }
+    ::close(fd_);
+    fd_ = -1;
 }
 
 void StorageManager::open_or_create_() {
     std::lock_guard<std::mutex> lock(io_mutex_);
 
-    file_.open(path_, std::ios::in | std::ios::out | std::ios::binary);
-    if (!file_.good()) {
-        file_.clear();
-        std::ofstream creator(path_, std::ios::out | std::ios::binary);
-        creator.close();
-        file_.open(path_, std::ios::in | std::ios::out | std::ios::binary);
+    constexpr int flags = O_RDWR | O_CREAT | O_CLOEXEC;
+    if (options_.direct_io && options_.compressed) {
+        spdlog::warn("StorageManager: '{}' is compressed, using buffered I/O",
+                     path_);
+    } else if (options_.direct_io) {
+        fd_ = ::open(path_.c_str(), flags | O_DIRECT, 0644);
+        if (fd_ >= 0) {
+            direct_io_ = true;
+            return;
+        }
+        if (errno != EINVAL) {
+            throw io_error("StorageManager: cannot open file: " + path_,
+                           errno);
+        }
+        spdlog::warn("StorageManager: O_DIRECT not supported for '{}', "
+                     "using buffered I/O",
+                     path_);
     }
-    if (!file_.good()) {
-        throw std::runtime_error("StorageManager: cannot open file: " + path_);
+    fd_ = ::open(path_.c_str(), flags, 0644);
+    if (fd_ < 0) {
+        throw io_error("StorageManager: cannot open file: " + path_, errno);
     }
 }
 
 void StorageManager::recompute_pages_() {
     std::lock_guard<std::mutex> lock(io_mutex_);
-    file_.seekg(0, std::ios::end);
-    const std::streamoff size = file_.tellg();
-    if (size < 0) {
-        num_pages_ = 0;
-    } else {
-        num_pages_ = static_cast<std::size_t>(size) / PAGE_SIZE;
+    struct stat st {};
+    if (::fstat(fd_, &st) != 0) {
+        throw io_error("StorageManager: cannot stat file: " + path_, errno);
+    }
+    const auto pages = static_cast<std::size_t>(st.st_size) / PAGE_SIZE;
+    std::size_t logical = pages;
+    if (const auto saved = load_logical_size_()) {
+        // Not closed cleanly since space was last reserved: the pages past
+        // the recorded count are reservation, except for written ones.
+        saved_logical_ = std::min(*saved, pages);
+        has_logical_file_ = true;
+        logical = written_end_(saved_logical_, pages);
+        spdlog::warn("StorageManager: '{}' was not closed cleanly, keeping "
+                     "{} of {} pages",
+                     path_, logical, pages);
+    }
+    num_pages_.store(logical, std::memory_order_release);
+    capacity_pages_.store(pages, std::memory_order_release);
+}
+
+// Side file: magic, page count and a CRC-32C of both, rewritten in place.
+// A torn or corrupt record reads as 0 pages, which leaves written_end_ to
+// find the logical end on its own.
+void StorageManager::save_logical_size_() {
+    const uint64_t pages = num_pages();
+    char record[16];
+    std::memcpy(record, &LSIZE_MAGIC, 4);
+    std::memcpy(record + 4, &pages, 8);
+    const uint32_t crc = common::crc32c(record, 12);
+    std::memcpy(record + 12, &crc, 4);
+
+    const std::string side = logical_size_path(path_);
+    const int fd = ::open(side.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) throw io_error("StorageManager: cannot write " + side, errno);
+    try {
+        pwrite_fully(fd, record, sizeof(record), 0);
+        sync_fd(fd, side);
+    } catch (...) {
+        ::close(fd);
+        throw;
     }
-    file_.seekg(0, std::ios::beg);
+    ::close(fd);
+    saved_logical_ = pages;
+    has_logical_file_ = true;
+}
+
+std::optional<std::size_t> StorageManager::load_logical_size_() const {
+    std::ifstream is(logical_size_path(path_), std::ios::binary);
+    if (!is) return std::nullopt;
+    char record[16];
+    if (!is.read(record, sizeof(record))) return 0;
+    uint32_t magic = 0, crc = 0;
+    uint64_t pages = 0;
+    std::memcpy(&magic, record, 4);
+    std::memcpy(&pages, record + 4, 8);
+    std::memcpy(&crc, record + 12, 4);
+    if (magic != LSIZE_MAGIC || crc != common::crc32c(record, 12)) return 0;
+    return static_cast<std::size_t>(pages);
+}
+
+std::size_t StorageManager::written_end_(std::size_t from,
+                                         std::size_t to) const {
+    // Walk back from the end; a reservation is usually one growth step.
+    constexpr std::size_t STEP = 64;
+    const PageBuffer buf = make_buffer(STEP);
+    while (to > from) {
+        const std::size_t n = std::min(STEP, to - from);
+        const std::size_t begin = to - n;
+        pread_fully(fd_, buf.get(), n * PAGE_SIZE,
+                    static_cast<off_t>(begin) * PAGE_SIZE);
+        for (std::size_t k = n; k > 0; --k) {
+            if (!all_zero(buf.get() + (k - 1) * PAGE_SIZE, PAGE_SIZE)) {
+                return begin + k;
+            }
+        }
+        to = begin;
+    }
+    return from;
+}
+
+std::size_t StorageManager::next_capacity_(std::size_t needed) const {
+    const GrowthPolicy &g = options_.growth;
+    const std::size_t current = capacity_pages();
+    std::size_t step = std::max<std::size_t>(g.chunk_pages, 1);
+    if (g.kind == GrowthPolicy::Kind::GEOMETRIC) {
+        const auto scaled =
+            static_cast<std::size_t>(static_cast<double>(current) * g.factor);
+        step = std::max(step, std::min(scaled, g.max_chunk_pages));
+    }
+    // A single request larger than one step is reserved in one go.
+    return std::max(needed, current + step);
+}
+
+void StorageManager::reserve_(std::size_t pages) {
+    const std::size_t current = capacity_pages();
+    if (pages <= current) return;
+    // Record the logical end before the file grows past it.
+    if (!has_logical_file_ || saved_logical_ != num_pages()) {
+        save_logical_size_();
+    }
+
+    const auto offset = static_cast<off_t>(current) * PAGE_SIZE;
+    const auto length = static_cast<off_t>(pages - current) * PAGE_SIZE;
+#if defined(__linux__)
+    int rc = (::fallocate(fd_, 0, offset, length) == 0) ? 0 : errno;
+#else
+    int rc = ::posix_fallocate(fd_, offset, length);
+#endif
+    if (rc == EOPNOTSUPP || rc == ENOSYS || rc == EINVAL) {
+        // No preallocation on this filesystem: extend sparsely instead.
+        rc = (::ftruncate(fd_, offset + length) == 0) ? 0 : errno;
+    }
+    if (rc != 0) {
+        throw io_error("StorageManager: cannot grow file: " + path_, rc);
+    }
+    capacity_pages_.store(pages, std::memory_order_release);
+}
+
+void StorageManager::grow_to_(std::size_t pages) {
+    if (pages <= num_pages()) return;
+    if (options_.compressed) {
+        // Nothing to reserve: extents are allocated when pages are written.
+        std::unique_lock<std::shared_mutex> lock(map_mutex_);
+        extents_.resize(pages);
+        capacity_pages_.store(pages, std::memory_order_release);
+        num_pages_.store(pages, std::memory_order_release);
+        return;
+    }
+    if (pages > capacity_pages()) reserve_(next_capacity_(pages));
+    num_pages_.store(pages, std::memory_order_release);
 }
 
 void StorageManager::extend_one() {
     std::lock_guard<std::mutex> lock(io_mutex_);
-    file_.seekp(0, std::ios::end);
-    std::vector<char> zeros(PAGE_SIZE, 0);
-    file_.write(zeros.data(), zeros.size());
-    file_.flush();
-    ++num_pages_;
+    grow_to_(num_pages() + 1);
 }
 
 void StorageManager::extend_to(std::uint64_t page_id) {
     std::lock_guard<std::mutex> lock(io_mutex_);
-    if (page_id + 1 <= num_pages_) return;
+    grow_to_(static_cast<std::size_t>(page_id + 1));
+}
 
-    const std::uint64_t add = (page_id + 1) - num_pages_;
-    std::vector<char> zeros(PAGE_SIZE, 0);
-    file_.seekp(0, std::ios::end);
-    for (std::uint64_t i = 0; i < add; ++i) {
-        file_.write(zeros.data(), zeros.size());
+void StorageManager::check_range_(const char *what, std::uint64_t first,
+                                  std::size_t count) const {
+    if (first >= num_pages() || count > num_pages() - first) {
+        throw std::out_of_range(std::string("StorageManager::") + what +
+                                " page_id out of range");
+    }
+}
+
+void StorageManager::transfer_(bool write, std::uint64_t first,
+                               char *const *buffers, std::size_t count) {
+    std::shared_lock<std::shared_mutex> gate;
+    if (write) {
+        gate = std::shared_lock<std::shared_mutex>(write_gate_);
+        if (snapshot_) preserve_(first, count);
+    }
+    if (options_.compressed) {
+        if (write) {
+            write_extents_(first, buffers, count);
+        } else {
+            read_extents_(first, buffers, count);
+        }
+        return;
+    }
+    static const std::size_t iov_max = [] {
+        const long v = ::sysconf(_SC_IOV_MAX);
+        return v > 0 ? static_cast<std::size_t>(v) : std::size_t{1024};
+    }();
+
+    std::vector<iovec> iov(std::min(count, iov_max));
+    std::size_t done_pages = 0;
+    while (done_pages < count) {
+        const std::size_t batch = std::min(count - done_pages, iov_max);
+        for (std::size_t i = 0; i < batch; ++i) {
+            iov[i].iov_base = buffers[done_pages + i];
+            iov[i].iov_len = PAGE_SIZE;
+        }
+        off_t offset = static_cast<off_t>(first + done_pages) * PAGE_SIZE;
+        iovec *cur = iov.data();
+        int left = static_cast<int>(batch);
+        while (left > 0) {
+            const ssize_t n = write ? ::pwritev(fd_, cur, left, offset)
+                                    : ::preadv(fd_, cur, left, offset);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) {
+                throw io_error(write ? "StorageManager::flush write failed"
+                                     : "StorageManager::load read failed",
+                               errno);
+            }
+            if (n == 0) {
+                throw std::runtime_error(
+                    write ? "StorageManager::flush short write"
+                          : "StorageManager::load short read");
+            }
+            // Partial transfer: skip the finished iovecs, trim the next one.
+            offset += n;
+            auto rest = static_cast<std::size_t>(n);
+            while (left > 0 && rest >= cur->iov_len) {
+                rest -= cur->iov_len;
+                ++cur;
+                --left;
+            }
+            if (left > 0) {
+                cur->iov_base = static_cast<char *>(cur->iov_base) + rest;
+                cur->iov_len -= rest;
+            }
+        }
+        done_pages += batch;
     }
-    file_.flush();
-    num_pages_ +=
-        static_cast<std::size_t>(add);  // ← fix: increase, don’t overwrite
 }
 
 std::unique_ptr<SlottedPage> StorageManager::load(std::uint64_t page_id) {
+    check_range_("load", page_id, 1);
+
+    auto page = std::make_unique<SlottedPage>();
+    char *buf = page->raw_data();
+    transfer_(false, page_id, &buf, 1);
+    return page;
+}
+
+void StorageManager::flush(std::uint64_t page_id, const SlottedPage &page) {
+    check_range_("flush", page_id, 1);
+
+    // Hold the page still while its bytes are written out. pwritev never
+    // writes through iov_base; the cast only satisfies iovec.
+    std::shared_lock<PageLatch> guard(page.latch());
+    char *buf = const_cast<char *>(page.raw_data());
+    transfer_(true, page_id, &buf, 1);
+}
+
+std::vector<std::unique_ptr<SlottedPage>> StorageManager::load_range(
+    std::uint64_t first, std::size_t count) {
+    std::vector<std::unique_ptr<SlottedPage>> pages;
+    if (count == 0) return pages;
+    check_range_("load_range", first, count);
+
+    pages.reserve(count);
+    std::vector<char *> buffers;
+    buffers.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        pages.push_back(std::make_unique<SlottedPage>());
+        buffers.push_back(pages.back()->raw_data());
+    }
+    transfer_(false, first, buffers.data(), count);
+    return pages;
+}
+
+void StorageManager::flush_range(std::uint64_t first,
+                                 std::span<const SlottedPage *const> pages) {
+    if (pages.empty()) return;
+    check_range_("flush_range", first, pages.size());
+
+    std::vector<char *> buffers;
+    buffers.reserve(pages.size());
+    for (const SlottedPage *p : pages) {
+        buffers.push_back(const_cast<char *>(p->raw_data()));
+    }
+    // Latch each distinct page once: the shared latch is not recursive.
+    std::vector<const SlottedPage *> distinct(pages.begin(), pages.end());
+    std::sort(distinct.begin(), distinct.end(), std::less<>());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()),
+                   distinct.end());
+    std::vector<std::shared_lock<PageLatch>> guards;
+    guards.reserve(distinct.size());
+    for (const SlottedPage *p : distinct) guards.emplace_back(p->latch());
+    transfer_(true, first, buffers.data(), buffers.size());
+}
+
+std::size_t StorageManager::flush_pages(
+    std::vector<std::pair<std::uint64_t, const SlottedPage *>> pages) {
+    // Stable sort keeps duplicates in submission order, so the last one of
+    // each id is the one that survives below.
+    std::stable_sort(pages.begin(), pages.end(),
+                     [](const auto &a, const auto &b) {
+                         return a.first < b.first;
+                     });
+
+    std::size_t runs = 0;
+    std::vector<const SlottedPage *> run;
+    std::uint64_t run_first = 0;
+    for (std::size_t i = 0; i < pages.size(); ++i) {
+        if (i + 1 < pages.size() && pages[i + 1].first == pages[i].first) {
+            continue;
+        }
+        if (!run.empty() && pages[i].first != run_first + run.size()) {
+            flush_range(run_first, run);
+            ++runs;
+            run.clear();
+        }
+        if (run.empty()) run_first = pages[i].first;
+        run.push_back(pages[i].second);
+    }
+    if (!run.empty()) {
+        flush_range(run_first, run);
+        ++runs;
+    }
+    return runs;
+}
+
+void StorageManager::sync() {
+    if (options_.compressed) {
+        sync_compressed_();
+        return;
+    }
+    sync_fd(fd_, path_);
+    // Pages extended so far now survive a crash even if never written.
     std::lock_guard<std::mutex> lock(io_mutex_);
-    if (page_id >= num_pages_) {
-        throw std::out_of_range("StorageManager::load page_id out of range");
+    if (has_logical_file_ && saved_logical_ != num_pages()) {
+        save_logical_size_();
     }
+}
 
-    auto page = std::make_unique<SlottedPage>();
-    file_.seekg(static_cast<std::streamoff>(page_id) * PAGE_SIZE,
-                std::ios::beg);
-    file_.read(page->raw_data(), PAGE_SIZE);
-    if (file_.gcount() != static_cast<std::streamsize>(PAGE_SIZE)) {
-        throw std::runtime_error("StorageManager::load short read");
+// ---------------- snapshots ----------------
+
+SnapshotStats StorageManager::snapshot_to(const std::string &target,
+                                          const SnapshotOptions &options) {
+    // Check before opening: O_TRUNC would wipe this very file, or the
+    // target of a snapshot still being copied.
+    std::unique_lock<std::shared_mutex> gate(write_gate_);
+    if (snapshot_) {
+        throw std::runtime_error("StorageManager: a snapshot of '" + path_ +
+                                 "' is already in progress");
     }
-    return page;
+    std::error_code ec;
+    if (std::filesystem::equivalent(target, path_, ec)) {
+        throw std::runtime_error("StorageManager: cannot snapshot '" + path_ +
+                                 "' onto itself");
+    }
+    const int tfd =
+        ::open(target.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (tfd < 0) {
+        throw io_error("StorageManager: cannot create snapshot " + target,
+                       errno);
+    }
+    SnapshotStats stats;
+    try {
+        stats.pages = num_pages();
+        stats.reflinked = options.reflink && reflink(tfd, fd_);
+        if (options_.compressed) {
+            // There is no fixed page grid to copy-before-write on: writers
+            // wait for the copy.
+            std::uint64_t end = 0;
+            {
+                std::shared_lock<std::shared_mutex> lock(map_mutex_);
+                end = data_end_;
+            }
+            if (!stats.reflinked) {
+                common::RateLimiter limiter(options.bytes_per_sec);
+                const std::size_t step =
+                    std::max<std::size_t>(options.chunk_pages, 1) * PAGE_SIZE;
+                std::vector<char> buf(step);
+                for (std::uint64_t off = 0; off < end; off += step) {
+                    const auto n =
+                        static_cast<std::size_t>(std::min<std::uint64_t>(
+                            step, end - off));
+                    pread_fully(fd_, buf.data(), n, static_cast<off_t>(off));
+                    pwrite_fully(tfd, buf.data(), n, static_cast<off_t>(off));
+                    limiter.acquire(2 * n);
+                }
+            }
+            if (::ftruncate(tfd, static_cast<off_t>(end)) != 0) {
+                throw io_error("StorageManager: cannot size " + target, errno);
+            }
+            save_map_(target);
+            gate.unlock();
+        } else {
+            // The source may carry reserved pages past num_pages().
+            const auto bytes = static_cast<off_t>(stats.pages) * PAGE_SIZE;
+            if (::ftruncate(tfd, bytes) != 0) {
+                throw io_error("StorageManager: cannot size " + target, errno);
+            }
+            if (stats.reflinked) {
+                gate.unlock();
+            } else {
+                auto snap = std::make_unique<Snapshot>();
+                snap->fd = tfd;
+                snap->pages = stats.pages;
+                snap->copied =
+                    std::make_unique<std::atomic<uint8_t>[]>(stats.pages);
+                snap->buffer_pages =
+                    std::max<std::size_t>(options.chunk_pages, 1);
+                snap->buffer = make_buffer(snap->buffer_pages);
+                Snapshot &s = *snap;
+                snapshot_ = std::move(snap);
+                gate.unlock();
+
+                // Writers may run from here on; the copier walks the file
+                // in order and skips pages they have already saved.
+                common::RateLimiter limiter(options.bytes_per_sec);
+                for (std::uint64_t p = 0; p < s.pages; p += s.buffer_pages) {
+                    const auto n = static_cast<std::size_t>(
+                        std::min<std::uint64_t>(s.buffer_pages, s.pages - p));
+                    std::uint64_t copied = 0;
+                    {
+                        std::lock_guard<std::mutex> lock(s.mutex);
+                        copied = copy_to_snapshot_(s, p, n);
+                    }
+                    limiter.acquire(2 * copied * PAGE_SIZE);
+                }
+                // Wait out writers still saving pages, then detach.
+                gate.lock();
+                stats.copied_by_writers = s.copied_by_writers;
+                snapshot_.reset();
+                gate.unlock();
+            }
+        }
+        sync_fd(tfd, target);
+    } catch (...) {
+        if (!gate.owns_lock()) gate.lock();
+        if (snapshot_ && snapshot_->fd == tfd) snapshot_.reset();
+        gate.unlock();
+        ::close(tfd);
+        throw;
+    }
+    ::close(tfd);
+    return stats;
+}
+
+void StorageManager::preserve_(std::uint64_t first, std::size_t count) {
+    Snapshot &s = *snapshot_;
+    if (first >= s.pages) return;
+    const std::uint64_t end = std::min<std::uint64_t>(first + count, s.pages);
+    std::uint64_t p = first;
+    while (p < end && s.copied[p].load(std::memory_order_acquire)) ++p;
+    if (p == end) return;
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.copied_by_writers +=
+        copy_to_snapshot_(s, p, static_cast<std::size_t>(end - p));
+}
+
+std::uint64_t StorageManager::copy_to_snapshot_(Snapshot &s,
+                                                std::uint64_t first,
+                                                std::size_t count) {
+    const std::uint64_t end = std::min<std::uint64_t>(first + count, s.pages);
+    std::uint64_t copied = 0;
+    std::uint64_t p = first;
+    while (p < end) {
+        if (s.copied[p].load(std::memory_order_relaxed)) {
+            ++p;
+            continue;
+        }
+        std::uint64_t q = p + 1;
+        while (q < end && q - p < s.buffer_pages &&
+               !s.copied[q].load(std::memory_order_relaxed)) {
+            ++q;
+        }
+        const std::size_t bytes = static_cast<std::size_t>(q - p) * PAGE_SIZE;
+        const auto offset = static_cast<off_t>(p) * PAGE_SIZE;
+        pread_fully(fd_, s.buffer.get(), bytes, offset);
+        pwrite_fully(s.fd, s.buffer.get(), bytes, offset);
+        for (std::uint64_t k = p; k < q; ++k) {
+            s.copied[k].store(1, std::memory_order_release);
+        }
+        copied += q - p;
+        p = q;
+    }
+    return copied;
+}
+
+std::uint64_t StorageManager::file_bytes() const {
+    if (!options_.compressed) {
+        return static_cast<std::uint64_t>(num_pages()) * PAGE_SIZE;
+    }
+    std::shared_lock<std::shared_mutex> lock(map_mutex_);
+    return data_end_;
 }
 
-void StorageManager::flush(std::uint64_t page_id, const SlottedPage& page) {
+// ---------------- compressed mode ----------------
+
+void StorageManager::open_compressed_() {
     std::lock_guard<std::mutex> lock(io_mutex_);
-    if (page_id >= num_pages_) {
-        throw std::out_of_range("StorageManager::flush page_id out of range");
+    if (!load_map_()) {
+        struct stat st {};
+        if (::fstat(fd_, &st) == 0 && st.st_size > 0) {
+            spdlog::warn("StorageManager: page map of '{}' missing or stale, "
+                         "rebuilding it from the extents",
+                         path_);
+        }
+        scan_extents_();
+        // Extents get reused from here on, which a stale map that later
+        // happened to match the file size would not know about.
+        std::error_code ec;
+        std::filesystem::remove(page_map_path(path_), ec);
+    }
+    collect_free_();
+    num_pages_.store(extents_.size(), std::memory_order_release);
+    capacity_pages_.store(extents_.size(), std::memory_order_release);
+}
+
+// Map file: magic, version, page count, data end, next sequence number,
+// then per page the extent offset and capacity, and a CRC-32C of
+// everything before it. It is only trusted if the data file still ends
+// where the map says it does.
+bool StorageManager::load_map_() {
+    std::ifstream is(page_map_path(path_), std::ios::binary);
+    if (!is) return false;
+    const std::string bytes((std::istreambuf_iterator<char>(is)),
+                            std::istreambuf_iterator<char>());
+    constexpr std::size_t head = 4 + 4 + 8 + 8 + 8;
+    if (bytes.size() < head + 4) return false;
+    uint32_t magic = 0, version = 0, crc = 0;
+    uint64_t pages = 0, end = 0, seq = 0;
+    std::memcpy(&magic, bytes.data(), 4);
+    std::memcpy(&version, bytes.data() + 4, 4);
+    std::memcpy(&pages, bytes.data() + 8, 8);
+    std::memcpy(&end, bytes.data() + 16, 8);
+    std::memcpy(&seq, bytes.data() + 24, 8);
+    std::memcpy(&crc, bytes.data() + bytes.size() - 4, 4);
+    if (magic != PMAP_MAGIC || version != PMAP_VERSION ||
+        bytes.size() != head + pages * 16 + 4 ||
+        crc != common::crc32c(bytes.data(), bytes.size() - 4)) {
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd_, &st) != 0 || static_cast<uint64_t>(st.st_size) != end) {
+        return false;
     }
 
-    file_.seekp(static_cast<std::streamoff>(page_id) * PAGE_SIZE,
-                std::ios::beg);
-    file_.write(page.raw_data(), PAGE_SIZE);
-    file_.flush();
+    std::vector<Extent> extents(pages);
+    const char *p = bytes.data() + head;
+    for (auto &e : extents) {
+        std::memcpy(&e.offset, p, 8);
+        std::memcpy(&e.capacity, p + 8, 4);
+        p += 16;
+    }
+    std::unique_lock<std::shared_mutex> lock(map_mutex_);
+    extents_ = std::move(extents);
+    data_end_ = end;
+    next_seq_ = seq;
+    return true;
+}
+
+std::string StorageManager::map_image_() const {
+    std::string out;
+    const uint64_t pages = extents_.size();
+    out.reserve(32 + pages * 16 + 4);
+    out.append(reinterpret_cast<const char *>(&PMAP_MAGIC), 4);
+    out.append(reinterpret_cast<const char *>(&PMAP_VERSION), 4);
+    out.append(reinterpret_cast<const char *>(&pages), 8);
+    out.append(reinterpret_cast<const char *>(&data_end_), 8);
+    out.append(reinterpret_cast<const char *>(&next_seq_), 8);
+    const uint32_t zero = 0;
+    for (const auto &e : extents_) {
+        out.append(reinterpret_cast<const char *>(&e.offset), 8);
+        out.append(reinterpret_cast<const char *>(&e.capacity), 4);
+        out.append(reinterpret_cast<const char *>(&zero), 4);
+    }
+    const uint32_t crc = common::crc32c(out.data(), out.size());
+    out.append(reinterpret_cast<const char *>(&crc), 4);
+    return out;
+}
+
+void StorageManager::save_map_(const std::string &data_path) const {
+    std::string image;
+    {
+        std::shared_lock<std::shared_mutex> lock(map_mutex_);
+        image = map_image_();
+    }
+    write_map_(data_path, image);
+}
+
+void StorageManager::write_map_(const std::string &data_path,
+                                const std::string &image) const {
+    const std::string final_path = page_map_path(data_path);
+    const std::string tmp = final_path + ".tmp";
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                          0644);
+    if (fd < 0) throw io_error("StorageManager: cannot write " + tmp, errno);
+    try {
+        pwrite_fully(fd, image.data(), image.size(), 0);
+        if (::fdatasync(fd) != 0) {
+            throw io_error("StorageManager: cannot sync " + tmp, errno);
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    std::filesystem::rename(tmp, final_path);
+}
+
+void StorageManager::sync_compressed_() {
+    std::lock_guard<std::mutex> serial(sync_mutex_);
+    // The map and the extents it no longer points at are taken together,
+    // and the data they refer to is made durable before the map.
+    std::string image;
+    std::vector<Extent> retired;
+    {
+        std::unique_lock<std::shared_mutex> lock(map_mutex_);
+        image = map_image_();
+        retired.swap(retired_);
+    }
+    try {
+        sync_fd(fd_, path_);
+        write_map_(path_, image);
+    } catch (...) {
+        std::unique_lock<std::shared_mutex> lock(map_mutex_);
+        retired_.insert(retired_.end(), retired.begin(), retired.end());
+        throw;
+    }
+    if (retired.empty()) return;
+    // Wait out reads that looked the extents up before they were retired;
+    // later ones find the pages' new extents in the map.
+    { std::unique_lock<std::shared_mutex> quiesce(readers_); }
+    std::unique_lock<std::shared_mutex> lock(map_mutex_);
+    for (const Extent &e : retired) free_.emplace(e.capacity, e.offset);
+}
+
+// Rebuild the map by walking the extents. A page maps to its intact
+// extent with the highest sequence number. An extent whose body fails its
+// CRC was torn by a crash: it is not mapped (its page keeps its previous
+// image, which stays intact until a later sync()), and torn extents at
+// the end (a crash during an append) are dropped. The walk stops at the
+// first header that does not fit the file.
+void StorageManager::scan_extents_() {
+    struct stat st {};
+    if (::fstat(fd_, &st) != 0) {
+        throw io_error("StorageManager: cannot stat file: " + path_, errno);
+    }
+    const auto size = static_cast<uint64_t>(st.st_size);
+    // Extents are read through a window of up to MAX_READ_RUN bytes.
+    std::vector<char> window;
+    uint64_t window_start = 0;
+    auto view = [&](uint64_t offset, std::size_t len) -> const char * {
+        if (offset < window_start ||
+            offset + len > window_start + window.size()) {
+            window.resize(static_cast<std::size_t>(std::min<uint64_t>(
+                std::max(len, MAX_READ_RUN), size - offset)));
+            pread_fully(fd_, window.data(), window.size(),
+                        static_cast<off_t>(offset));
+            window_start = offset;
+        }
+        return window.data() + (offset - window_start);
+    };
+
+    std::vector<Extent> extents;
+    std::vector<uint64_t> seqs;
+    uint64_t next_seq = 1;
+    uint64_t offset = 0;
+    uint64_t end = 0;  // just past the last intact extent
+    while (offset + sizeof(ExtentHeader) <= size) {
+        ExtentHeader h{};
+        std::memcpy(&h, view(offset, sizeof(h)), sizeof(h));
+        if (h.magic != EXTENT_MAGIC || h.capacity < sizeof(h) ||
+            h.stored > h.capacity - sizeof(h) || offset + h.capacity > size) {
+            if (offset == 0) {
+                throw std::runtime_error("StorageManager: '" + path_ +
+                                         "' is not a compressed page file");
+            }
+            break;
+        }
+        const char *body = view(offset, h.capacity) + sizeof(h);
+        next_seq = std::max(next_seq, h.seq + 1);
+        if (h.crc == common::crc32c(body, h.stored)) {
+            if (h.page_id >= extents.size()) {
+                extents.resize(h.page_id + 1);
+                seqs.resize(h.page_id + 1, 0);
+            }
+            if (h.seq >= seqs[h.page_id]) {
+                extents[h.page_id] = Extent{offset, h.capacity};
+                seqs[h.page_id] = h.seq;
+            }
+            end = offset + h.capacity;
+        } else {
+            spdlog::warn("StorageManager: skipping torn extent of page {} at "
+                         "offset {} in '{}'",
+                         h.page_id, offset, path_);
+        }
+        offset += h.capacity;
+    }
+    if (end != size) {
+        spdlog::warn("StorageManager: dropping {} trailing bytes of '{}'",
+                     size - end, path_);
+    }
+    std::unique_lock<std::shared_mutex> lock(map_mutex_);
+    extents_ = std::move(extents);
+    data_end_ = end;
+    next_seq_ = next_seq;
+}
+
+void StorageManager::collect_free_() {
+    std::vector<Extent> used;
+    for (const Extent &e : extents_) {
+        if (e.offset != UNWRITTEN) used.push_back(e);
+    }
+    std::sort(used.begin(), used.end(),
+              [](const Extent &a, const Extent &b) {
+                  return a.offset < b.offset;
+              });
+    used.push_back(Extent{data_end_, 0});
+    uint64_t offset = 0;
+    for (const Extent &u : used) {
+        // Walk the gap before 'u' header by header.
+        while (offset + sizeof(ExtentHeader) <= u.offset) {
+            ExtentHeader h{};
+            pread_fully(fd_, reinterpret_cast<char *>(&h), sizeof(h),
+                        static_cast<off_t>(offset));
+            if (h.magic != EXTENT_MAGIC || h.capacity < sizeof(h) ||
+                offset + h.capacity > u.offset) {
+                break;  // not an extent: leave the rest of the gap alone
+            }
+            free_.emplace(h.capacity, offset);
+            next_seq_ = std::max(next_seq_, h.seq + 1);
+            offset += h.capacity;
+        }
+        offset = u.offset + u.capacity;
+    }
+}
+
+void StorageManager::read_extents_(std::uint64_t first, char *const *buffers,
+                                   std::size_t count) const {
+    std::shared_lock<std::shared_mutex> reading(readers_);
+    std::vector<Extent> ex(count);
+    {
+        std::shared_lock<std::shared_mutex> lock(map_mutex_);
+        std::copy_n(extents_.begin() + static_cast<std::ptrdiff_t>(first),
+                    count, ex.begin());
+    }
+
+    std::vector<char> run;
+    std::size_t i = 0;
+    while (i < count) {
+        if (ex[i].offset == UNWRITTEN) {
+            // Never written: reads as zeros, like a hole in a raw file.
+            std::memset(buffers[i], 0, PAGE_SIZE);
+            ++i;
+            continue;
+        }
+        // Adjacent extents (the normal layout of a sequentially written
+        // file) are fetched with one read.
+        std::size_t j = i + 1;
+        std::size_t bytes = ex[i].capacity;
+        while (j < count &&
+               ex[j].offset == ex[j - 1].offset + ex[j - 1].capacity &&
+               bytes + ex[j].capacity <= MAX_READ_RUN) {
+            bytes += ex[j].capacity;
+            ++j;
+        }
+        run.resize(bytes);
+        pread_fully(fd_, run.data(), bytes, static_cast<off_t>(ex[i].offset));
+
+        const char *p = run.data();
+        for (std::size_t k = i; k < j; p += ex[k].capacity, ++k) {
+            ExtentHeader h;
+            std::memcpy(&h, p, sizeof(h));
+            const char *body = p + sizeof(h);
+            if (h.magic != EXTENT_MAGIC || h.page_id != first + k ||
+                h.stored > ex[k].capacity - sizeof(h) ||
+                h.crc != common::crc32c(body, h.stored)) {
+                throw std::runtime_error(
+                    "StorageManager::load corrupt extent for page " +
+                    std::to_string(first + k) + " in " + path_);
+            }
+            if (h.stored == PAGE_SIZE) {
+                std::memcpy(buffers[k], body, PAGE_SIZE);
+            } else {
+                PageCodec::decompress(std::string_view(body, h.stored),
+                                      buffers[k], PAGE_SIZE);
+            }
+        }
+        i = j;
+    }
+}
+
+void StorageManager::write_extents_(std::uint64_t first, char *const *buffers,
+                                    std::size_t count) {
+    // Encode every page into its final extent bytes first.
+    std::vector<std::string> blobs(count);
+    std::string packed;
+    for (std::size_t i = 0; i < count; ++i) {
+        PageCodec::compress(std::string_view(buffers[i], PAGE_SIZE), packed);
+        const bool raw = packed.size() >= PAGE_SIZE;
+        const std::string_view body =
+            raw ? std::string_view(buffers[i], PAGE_SIZE) : packed;
+        ExtentHeader h{EXTENT_MAGIC, static_cast<uint32_t>(body.size()),
+                       first + i, 0,
+                       common::crc32c(body.data(), body.size()), 0};
+        std::string &blob = blobs[i];
+        blob.reserve(round_up(sizeof(h) + body.size(), EXTENT_GRANULE));
+        blob.append(reinterpret_cast<const char *>(&h), sizeof(h));
+        blob.append(body);
+    }
+
+    // Never overwrite the page's current extent: take a free one the image
+    // fits (at most twice its size, so small images do not pin big
+    // extents) or append. The map is only updated once the bytes are
+    // written, so a concurrent load never follows it to an unwritten
+    // extent, and the old extent is retired until sync().
+    std::vector<Extent> target(count);
+    std::vector<bool> appended(count, false);
+    {
+        std::unique_lock<std::shared_mutex> lock(map_mutex_);
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto cap = round_up(blobs[i].size(), EXTENT_GRANULE);
+            const auto it = free_.lower_bound(static_cast<uint32_t>(cap));
+            if (it != free_.end() && it->first <= 2 * cap) {
+                target[i] = Extent{it->second, it->first};
+                free_.erase(it);
+            } else {
+                target[i] = Extent{data_end_, static_cast<uint32_t>(cap)};
+                data_end_ += cap;
+                appended[i] = true;
+            }
+            const uint64_t seq = next_seq_++;
+            std::memcpy(blobs[i].data() + offsetof(ExtentHeader, seq), &seq,
+                        sizeof(seq));
+        }
+    }
+
+    std::string run;
+    std::size_t i = 0;
+    while (i < count) {
+        uint32_t cap = target[i].capacity;
+        std::memcpy(blobs[i].data() + offsetof(ExtentHeader, capacity), &cap,
+                    sizeof(cap));
+        if (!appended[i]) {
+            pwrite_fully(fd_, blobs[i].data(), blobs[i].size(),
+                         static_cast<off_t>(target[i].offset));
+            ++i;
+            continue;
+        }
+        // Appended extents are adjacent: pad and write them in one go.
+        run.clear();
+        std::size_t j = i;
+        while (j < count && appended[j] &&
+               (j == i || target[j].offset ==
+                              target[j - 1].offset + target[j - 1].capacity)) {
+            cap = target[j].capacity;
+            std::memcpy(blobs[j].data() + offsetof(ExtentHeader, capacity),
+                        &cap, sizeof(cap));
+            run.append(blobs[j]);
+            run.resize(run.size() + (cap - blobs[j].size()), '\0');
+            ++j;
+        }
+        pwrite_fully(fd_, run.data(), run.size(),
+                     static_cast<off_t>(target[i].offset));
+        i = j;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(map_mutex_);
+    for (std::size_t k = 0; k < count; ++k) {
+        Extent &cur = extents_[first + k];
+        if (cur.offset != UNWRITTEN) retired_.push_back(cur);
+        cur = target[k];
+    }
 }
 
-}  // namespace srd::storage
\ No newline at end of file
+}  // namespace srd::storage
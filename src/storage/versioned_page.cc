@@ -0,0 +1,213 @@
+#include "srd/storage/versioned_page.hpp"
+
+#include <cstring>
+#include <sstream>
+
+namespace srd::storage {
+
+// ---- VersionClock ----
+
+uint64_t VersionClock::visible_() const {
+    const uint64_t bound = writes_.empty() ? next_ts_ : *writes_.begin();
+    return bound - 1;
+}
+
+uint64_t VersionClock::begin_snapshot() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t ts = visible_();
+    snapshots_.insert(ts);
+    return ts;
+}
+
+void VersionClock::end_snapshot(uint64_t ts) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = snapshots_.find(ts);
+    if (it != snapshots_.end()) snapshots_.erase(it);
+}
+
+uint64_t VersionClock::begin_write() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t ts = next_ts_++;
+    writes_.insert(ts);
+    return ts;
+}
+
+void VersionClock::end_write(uint64_t ts) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    writes_.erase(ts);
+}
+
+uint64_t VersionClock::oldest_active() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t v = visible_();
+    return snapshots_.empty() ? v : std::min(v, *snapshots_.begin());
+}
+
+// ---- VersionedPage ----
+
+namespace {
+
+// Commits the reserved timestamp however the write ends.
+class WriteScope {
+   public:
+    explicit WriteScope(VersionClock &clock)
+        : clock_(clock), ts_(clock.begin_write()) {}
+    ~WriteScope() {
+        clock_.end_write(ts_);
+    }
+    uint64_t ts() const noexcept {
+        return ts_;
+    }
+
+   private:
+    VersionClock &clock_;
+    uint64_t ts_;
+};
+
+}  // namespace
+
+VersionedPage::VersionedPage(VersionClock &clock,
+                             std::unique_ptr<SlottedPage> page)
+    : clock_(clock), page_(std::move(page)) {}
+
+std::string VersionedPage::encode_(const VersionHeader &h,
+                                   std::string_view tuple) {
+    std::string rec(sizeof(VersionHeader) + tuple.size(), '\0');
+    std::memcpy(rec.data(), &h, sizeof(VersionHeader));
+    std::memcpy(rec.data() + sizeof(VersionHeader), tuple.data(),
+                tuple.size());
+    return rec;
+}
+
+bool VersionedPage::decode_(std::string_view record, VersionHeader &h) {
+    if (record.size() < sizeof(VersionHeader)) return false;
+    std::memcpy(&h, record.data(), sizeof(VersionHeader));
+    return true;
+}
+
+bool VersionedPage::deserialize_(std::string_view tuple_bytes, Tuple &out) {
+    std::istringstream iss{std::string(tuple_bytes)};
+    auto tup = Tuple::deserialize(iss);
+    if (!tup) return false;
+    out = std::move(*tup);
+    return true;
+}
+
+bool VersionedPage::insert(const Tuple &tuple, size_t &slot) {
+    const std::string bytes = tuple.serialize();
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    WriteScope write(clock_);
+    const std::string rec = encode_({write.ts(), TS_INFINITY}, bytes);
+    if (page_->addRecord(rec, slot)) return true;
+    // Out of space: drop dead rows so compaction can reuse their bytes.
+    if (collect_locked_() == 0) return false;
+    return page_->addRecord(rec, slot);
+}
+
+bool VersionedPage::update(size_t slot, const Tuple &tuple) {
+    const std::string bytes = tuple.serialize();
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    std::string old;
+    VersionHeader head;
+    if (!page_->getRecord(slot, old) || !decode_(old, head)) return false;
+    if (head.end_ts != TS_INFINITY) return false;
+
+    WriteScope write(clock_);
+    // Publish the old version before the page stops holding it, so a
+    // reader that sees the new head always finds its predecessor.
+    {
+        std::unique_lock<std::shared_mutex> undo(undo_mutex_);
+        undo_[slot].push_back(UndoVersion{
+            head.begin_ts, write.ts(), old.substr(sizeof(VersionHeader))});
+    }
+    const std::string rec = encode_({write.ts(), TS_INFINITY}, bytes);
+    if (page_->updateRecord(slot, rec)) return true;
+    if (collect_locked_() > 0 && page_->updateRecord(slot, rec)) return true;
+
+    std::unique_lock<std::shared_mutex> undo(undo_mutex_);
+    auto &chain = undo_[slot];
+    chain.pop_back();
+    if (chain.empty()) undo_.erase(slot);
+    return false;
+}
+
+bool VersionedPage::remove(size_t slot) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    std::string rec;
+    VersionHeader head;
+    if (!page_->getRecord(slot, rec) || !decode_(rec, head)) return false;
+    if (head.end_ts != TS_INFINITY) return false;
+
+    // A delete only closes the newest version; same length, so in place.
+    WriteScope write(clock_);
+    head.end_ts = write.ts();
+    std::memcpy(rec.data(), &head, sizeof(VersionHeader));
+    return page_->updateRecord(slot, rec);
+}
+
+bool VersionedPage::read(size_t slot, uint64_t ts, Tuple &out) const {
+    std::string rec;
+    VersionHeader head;
+    if (!page_->getRecord(slot, rec) || !decode_(rec, head)) return false;
+
+    const std::string_view rec_view(rec);
+    if (head.begin_ts <= ts) {
+        if (ts >= head.end_ts) return false;  // deleted before the snapshot
+        return deserialize_(rec_view.substr(sizeof(VersionHeader)), out);
+    }
+
+    // Newest version is too new: walk the undo chain, newest first.
+    std::shared_lock<std::shared_mutex> undo(undo_mutex_);
+    auto it = undo_.find(slot);
+    if (it == undo_.end()) return false;
+    for (auto v = it->second.rbegin(); v != it->second.rend(); ++v) {
+        if (v->begin_ts <= ts && ts < v->end_ts) {
+            return deserialize_(v->tuple_bytes, out);
+        }
+    }
+    return false;
+}
+
+size_t VersionedPage::collect_garbage() {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    return collect_locked_();
+}
+
+size_t VersionedPage::collect_locked_() {
+    const uint64_t oldest = clock_.oldest_active();
+    size_t reclaimed = 0;
+
+    std::unique_lock<std::shared_mutex> undo(undo_mutex_);
+    for (auto it = undo_.begin(); it != undo_.end();) {
+        auto &chain = it->second;
+        const auto before = chain.size();
+        std::erase_if(chain, [&](const UndoVersion &v) {
+            return v.end_ts <= oldest;
+        });
+        reclaimed += before - chain.size();
+        it = chain.empty() ? undo_.erase(it) : std::next(it);
+    }
+
+    std::string rec;
+    VersionHeader head;
+    for (size_t slot = 0; slot < MAX_SLOTS; ++slot) {
+        if (!page_->getRecord(slot, rec) || !decode_(rec, head)) continue;
+        if (head.end_ts != TS_INFINITY && head.end_ts <= oldest) {
+            page_->deleteTuple(slot);
+            undo_.erase(slot);
+            ++reclaimed;
+        }
+    }
+    return reclaimed;
+}
+
+size_t VersionedPage::undo_versions() const {
+    std::shared_lock<std::shared_mutex> undo(undo_mutex_);
+    size_t n = 0;
+    for (const auto &[slot, chain] : undo_) n += chain.size();
+    return n;
+}
+
+}  // namespace srd::storage
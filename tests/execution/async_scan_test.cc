@@ -0,0 +1,124 @@
+#include "srd/execution/async_scan.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "srd/storage/record_stream.hpp"
+
+using srd::execution::load_pages_async;
+using srd::execution::PageBatch;
+using srd::execution::PageStream;
+using srd::execution::Scheduler;
+using srd::execution::Task;
+using srd::storage::RecordWriter;
+using srd::storage::StorageManager;
+
+static std::string tmp_db_path(const char *tag) {
+    auto now =
+        std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    std::mt19937_64 rng(static_cast<unsigned long long>(now));
+    return std::string("srd_async_") + tag + "_" + std::to_string(rng()) +
+           ".dat";
+}
+
+static void fill(StorageManager &sm, int n) {
+    RecordWriter w(sm);
+    for (int i = 0; i < n; ++i) w.append("rec-" + std::to_string(i));
+    w.finish();
+}
+
+static Task<int> twice(int x) {
+    co_return 2 * x;
+}
+
+static Task<int> add_twice(int a, int b) {
+    int x = co_await twice(a);
+    int y = co_await twice(b);
+    co_return x + y;
+}
+
+static Task<int> fails() {
+    throw std::runtime_error("boom");
+    co_return 0;
+}
+
+TEST(AsyncScan, TasksComposeAndPropagateErrors) {
+    Scheduler sched(2, 1);
+    EXPECT_EQ(sched.block_on(add_twice(3, 4)), 14);
+    EXPECT_THROW(sched.block_on(fails()), std::runtime_error);
+
+    StorageManager sm(tmp_db_path("load"));
+    fill(sm, 500);
+    auto load = [&]() -> Task<std::size_t> {
+        PageBatch pages = co_await load_pages_async(sched, sm, 0, 2);
+        co_return pages.size();
+    };
+    EXPECT_EQ(sched.block_on(load()), 2u);
+}
+
+TEST(AsyncScan, StreamYieldsEveryPageInOrder) {
+    StorageManager sm(tmp_db_path("order"));
+    fill(sm, 5000);
+    const std::uint64_t pages = sm.num_pages();
+    ASSERT_GT(pages, 8u);
+
+    Scheduler sched(1, 2);
+    auto scan = [&]() -> Task<std::size_t> {
+        PageStream stream(sched, sm, 0, 0, 3, 2);
+        std::uint64_t expect = 0;
+        std::string rec;
+        std::size_t n = 0;
+        for (;;) {
+            PageBatch batch = co_await stream.next();
+            if (batch.empty()) break;
+            EXPECT_EQ(stream.page_id(), expect);
+            expect += batch.size();
+            for (const auto &page : batch) {
+                for (std::size_t s = 0; s < srd::storage::MAX_SLOTS; ++s) {
+                    if (page->getRecord(s, rec)) ++n;
+                }
+            }
+        }
+        EXPECT_EQ(expect, pages);
+        co_return n;
+    };
+    EXPECT_EQ(sched.block_on(scan()), 5000u);
+}
+
+TEST(AsyncScan, ManyScansShareFewThreads) {
+    StorageManager sm(tmp_db_path("many"));
+    fill(sm, 3000);
+
+    Scheduler sched(2, 2);
+    constexpr int SCANS = 16;
+    std::atomic<std::size_t> total{0};
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    auto scan = [&]() -> Task<void> {
+        PageStream stream(sched, sm, 0, 0, 4, 3);
+        std::vector<std::string> records;
+        std::set<std::string> seen;
+        while (co_await stream.next_records(records)) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                threads.insert(std::this_thread::get_id());
+            }
+            seen.insert(records.begin(), records.end());
+        }
+        total += seen.size();
+    };
+    for (int i = 0; i < SCANS; ++i) sched.spawn(scan());
+    sched.wait_idle();
+
+    EXPECT_EQ(total.load(), 3000u * SCANS);
+    EXPECT_LE(threads.size(), sched.workers());
+}
@@ -0,0 +1,172 @@
+#include "srd/execution/expression.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "srd/record/tuple.hpp"
+
+using srd::execution::CompiledExpr;
+using srd::execution::Expr;
+using srd::execution::ExprColumn;
+using srd::execution::ExprType;
+using srd::record::Field;
+using srd::record::FieldType;
+using srd::record::Tuple;
+
+// Rows are (id INT, price FLOAT, region STRING).
+struct Row {
+    int id;
+    float price;
+    std::string region;
+};
+
+static std::string encode(const Row &r) {
+    Tuple t;
+    t.addField(std::make_unique<Field>(r.id));
+    t.addField(std::make_unique<Field>(r.price));
+    t.addField(std::make_unique<Field>(r.region));
+    return t.serialize();
+}
+
+static std::vector<std::string_view> views(
+    const std::vector<std::string> &recs) {
+    return {recs.begin(), recs.end()};
+}
+
+static const Expr ID = Expr::column(0, FieldType::INT);
+static const Expr PRICE = Expr::column(1, FieldType::FLOAT);
+static const Expr REGION = Expr::column(2, FieldType::STRING);
+
+TEST(Expression, ArithmeticAndComparisonsAcrossBatches) {
+    // More rows than one batch, so batch boundaries are crossed.
+    std::mt19937 rng(5);
+    std::vector<Row> rows;
+    std::vector<std::string> recs;
+    for (int i = 0; i < 3000; ++i) {
+        rows.push_back({static_cast<int>(rng() % 2001) - 1000,
+                        static_cast<float>(rng() % 10000) / 100.0f, "x"});
+        recs.push_back(encode(rows.back()));
+    }
+    const auto in = views(recs);
+
+    // id * 3 - 7: INT, constants on both sides of the ops.
+    ExprColumn out;
+    CompiledExpr lin(
+        Expr::sub(Expr::mul(Expr::constant(3), ID), Expr::constant(7)));
+    EXPECT_EQ(lin.type(), ExprType::INT);
+    lin.evaluate(in, out);
+    ASSERT_EQ(out.ints.size(), rows.size());
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        ASSERT_EQ(out.valid[i], 1);
+        ASSERT_EQ(out.ints[i], rows[i].id * 3 - 7);
+    }
+
+    // id + price mixes INT and FLOAT, so it is FLOAT.
+    CompiledExpr mixed(Expr::add(ID, PRICE));
+    EXPECT_EQ(mixed.type(), ExprType::FLOAT);
+    mixed.evaluate(in, out);
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        ASSERT_DOUBLE_EQ(out.floats[i],
+                         rows[i].id + static_cast<double>(rows[i].price));
+    }
+
+    // INT arithmetic is done in 64 bits.
+    CompiledExpr wide(Expr::mul(Expr::add(ID, Expr::constant(2000000000)),
+                                Expr::constant(4)));
+    wide.evaluate(in, out);
+    EXPECT_EQ(out.ints[0], (int64_t{rows[0].id} + 2000000000) * 4);
+
+    // Vector-vs-vector and vector-vs-constant comparisons.
+    CompiledExpr cmp(Expr::le(Expr::mul(PRICE, Expr::constant(10.0)), ID));
+    cmp.evaluate(in, out);
+    ASSERT_EQ(out.bools.size(), rows.size());
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        ASSERT_EQ(out.bools[i], rows[i].price * 10.0 <= rows[i].id ? 1 : 0);
+    }
+}
+
+TEST(Expression, FilterSelectsValidTrueRows) {
+    std::vector<std::string> recs;
+    const std::vector<Row> rows = {{1, 9.5f, "EU"},  {5, 20.0f, "US"},
+                                   {7, 1.0f, "EU"},  {12, 3.0f, "APAC"},
+                                   {3, 50.0f, "EU"}, {8, 8.0f, "US"}};
+    for (const auto &r : rows) recs.push_back(encode(r));
+    // Rows without a price, or with a string there: never selected.
+    Tuple short_row;
+    short_row.addField(std::make_unique<Field>(2));
+    recs.push_back(short_row.serialize());
+    Tuple bad_type;
+    bad_type.addField(std::make_unique<Field>(2));
+    bad_type.addField(std::make_unique<Field>(std::string("oops")));
+    bad_type.addField(std::make_unique<Field>(std::string("EU")));
+    recs.push_back(bad_type.serialize());
+    const auto in = views(recs);
+
+    // (region == "EU" AND price < 10) OR NOT (id <= 10)
+    CompiledExpr pred(Expr::logical_or(
+        Expr::logical_and(Expr::eq(REGION, Expr::constant("EU")),
+                          Expr::lt(PRICE, Expr::constant(10))),
+        Expr::logical_not(Expr::le(ID, Expr::constant(10)))));
+    std::vector<uint32_t> sel = {99};  // appended to, not replaced
+    EXPECT_EQ(pred.filter(in, sel), 3u);
+    EXPECT_EQ(sel, (std::vector<uint32_t>{99, 0, 2, 3}));
+
+    ExprColumn out;
+    pred.evaluate(in, out);
+    EXPECT_EQ(out.valid, (std::vector<uint8_t>{1, 1, 1, 1, 1, 1, 0, 0}));
+
+    // String ordering, and a column referenced twice.
+    sel.clear();
+    CompiledExpr str(Expr::logical_and(Expr::ge(REGION, Expr::constant("F")),
+                                       Expr::ne(ID, ID)));
+    EXPECT_EQ(str.filter(in, sel), 0u);
+    CompiledExpr us(Expr::gt(REGION, Expr::constant("F")));
+    EXPECT_EQ(us.filter(in, sel), 2u);
+    EXPECT_EQ(sel, (std::vector<uint32_t>{1, 5}));
+
+    // Constant predicates fold: every row valid, no column read.
+    sel.clear();
+    CompiledExpr always(Expr::lt(Expr::constant(1), Expr::constant(2.5)));
+    EXPECT_EQ(always.filter(in, sel), recs.size());
+    CompiledExpr never(Expr::logical_not(Expr::constant(true)));
+    EXPECT_EQ(never.filter(in, sel), 0u);
+
+    // A bare column evaluates to its values; strings drop the terminator.
+    CompiledExpr region(REGION);
+    region.evaluate(in, out);
+    EXPECT_EQ(out.strings[3], "APAC");
+    EXPECT_EQ(out.valid[6], 0);
+}
+
+TEST(Expression, TypeErrorsAndMalformedRecords) {
+    EXPECT_THROW(Expr::add(REGION, ID), std::runtime_error);
+    EXPECT_THROW(Expr::lt(REGION, PRICE), std::runtime_error);
+    EXPECT_THROW(Expr::logical_and(ID, Expr::constant(true)),
+                 std::runtime_error);
+    EXPECT_THROW(Expr::logical_not(PRICE), std::runtime_error);
+    EXPECT_THROW(ID.left(), std::out_of_range);
+
+    // The same field read as two types.
+    const Expr id_as_float = Expr::column(0, FieldType::FLOAT);
+    EXPECT_THROW(CompiledExpr(Expr::eq(ID, id_as_float)), std::runtime_error);
+
+    std::vector<uint32_t> sel;
+    CompiledExpr sum(Expr::add(ID, PRICE));
+    const std::vector<std::string_view> none;
+    EXPECT_THROW(sum.filter(none, sel), std::runtime_error);
+
+    std::string rec = encode({1, 2.0f, "EU"});
+    rec.resize(rec.size() - 6);  // cut into the last field
+    const std::vector<std::string_view> in = {rec};
+    CompiledExpr region(Expr::eq(REGION, Expr::constant("EU")));
+    EXPECT_THROW(region.filter(in, sel), std::runtime_error);
+    // Fields before the damage still decode.
+    CompiledExpr id(Expr::eq(ID, Expr::constant(1)));
+    EXPECT_EQ(id.filter(in, sel), 1u);
+}
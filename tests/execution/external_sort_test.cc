@@ -0,0 +1,213 @@
+#include "srd/execution/external_sort.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "srd/record/tuple_view.hpp"
+#include "srd/storage/record_stream.hpp"
+
+using srd::execution::ExternalSort;
+using srd::execution::ExternalSortOptions;
+using srd::record::Field;
+using srd::record::Tuple;
+using srd::record::TupleView;
+using srd::storage::RecordReader;
+using srd::storage::RecordWriter;
+using srd::storage::StorageManager;
+
+static std::string tmp_db_path(const char *tag) {
+    auto now =
+        std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    std::mt19937_64 rng(static_cast<unsigned long long>(now));
+    return std::string("srd_sort_") + tag + "_" + std::to_string(rng()) +
+           ".dat";
+}
+
+static std::string row(int key, const std::string &payload) {
+    Tuple t;
+    t.addField(std::make_unique<Field>(key));
+    t.addField(std::make_unique<Field>(payload));
+    return t.serialize();
+}
+
+static std::vector<std::string> read_all(StorageManager &sm) {
+    std::vector<std::string> out;
+    RecordReader r(sm);
+    std::string rec;
+    while (r.next(rec)) out.push_back(rec);
+    return out;
+}
+
+static std::size_t leftover_runs() {
+    std::size_t n = 0;
+    for (const auto &e : std::filesystem::directory_iterator(".")) {
+        if (e.path().extension() == ".tmp") ++n;
+    }
+    return n;
+}
+
+TEST(ExternalSort, SortsIntsAcrossManyRunsAndPasses) {
+    StorageManager in(tmp_db_path("in"));
+    std::mt19937 rng(7);
+    std::vector<int> keys;
+    {
+        RecordWriter w(in);
+        for (int i = 0; i < 5000; ++i) {
+            const int k = static_cast<int>(rng() % 20001) - 10000;
+            keys.push_back(k);
+            w.append(row(k, "payload-" + std::to_string(i)));
+        }
+        w.finish();
+    }
+
+    ExternalSortOptions o;
+    o.memory_budget = 96 * 1024;  // forces dozens of runs
+    o.threads = 3;
+    o.max_fan_in = 4;  // and more than one merge pass
+    o.read_ahead_pages = 2;
+    StorageManager out(tmp_db_path("out"));
+    const auto stats = ExternalSort(o).sort(in, out);
+
+    EXPECT_EQ(stats.records, 5000u);
+    EXPECT_GT(stats.initial_runs, 4u);
+    EXPECT_GT(stats.merge_passes, 1u);
+    EXPECT_EQ(leftover_runs(), 0u);
+
+    const auto sorted = read_all(out);
+    ASSERT_EQ(sorted.size(), keys.size());
+    std::vector<int> got;
+    for (const auto &r : sorted) got.push_back(TupleView(r).field(0).asInt());
+    std::sort(keys.begin(), keys.end());
+    EXPECT_EQ(got, keys);
+}
+
+TEST(ExternalSort, OrdersStringsBeyondThePrefixAndMixedTypes) {
+    StorageManager in(tmp_db_path("str_in"));
+    const std::vector<std::string> words = {
+        "prefix_common_b", "prefix_common_a", "prefix_c", "", "prefix",
+        "zzz",             "prefix_common_ab"};
+    {
+        RecordWriter w(in);
+        for (const auto &s : words) {
+            Tuple t;
+            t.addField(std::make_unique<Field>(s));
+            w.append(t.serialize());
+        }
+        Tuple f, i, none;
+        f.addField(std::make_unique<Field>(-1.5f));
+        i.addField(std::make_unique<Field>(3));
+        w.append(f.serialize());
+        w.append(i.serialize());
+        w.append(none.serialize());
+        w.finish();
+    }
+
+    ExternalSortOptions o;
+    o.memory_budget = 8 * 1024;
+    o.threads = 1;
+    StorageManager out(tmp_db_path("str_out"));
+    ExternalSort(o).sort(in, out);
+
+    const auto sorted = read_all(out);
+    ASSERT_EQ(sorted.size(), words.size() + 3);
+    EXPECT_EQ(TupleView(sorted[0]).size(), 0u);  // missing column first
+    EXPECT_EQ(TupleView(sorted[1]).field(0).asInt(), 3);
+    EXPECT_FLOAT_EQ(TupleView(sorted[2]).field(0).asFloat(), -1.5f);
+    std::vector<std::string> expect = words;
+    std::sort(expect.begin(), expect.end());
+    for (std::size_t i = 0; i < expect.size(); ++i) {
+        EXPECT_EQ(TupleView(sorted[i + 3]).field(0).asString(), expect[i]);
+    }
+}
+
+TEST(ExternalSort, FloatKeysSortNumerically) {
+    StorageManager in(tmp_db_path("flt_in"));
+    std::vector<float> vals = {3.5f, -0.25f, 0.0f, -100.0f, 1e-3f, 42.0f};
+    {
+        RecordWriter w(in);
+        for (float v : vals) {
+            Tuple t;
+            t.addField(std::make_unique<Field>(v));
+            w.append(t.serialize());
+        }
+        w.finish();
+    }
+    StorageManager out(tmp_db_path("flt_out"));
+    ExternalSort().sort(in, out);
+    std::sort(vals.begin(), vals.end());
+    const auto sorted = read_all(out);
+    ASSERT_EQ(sorted.size(), vals.size());
+    for (std::size_t i = 0; i < vals.size(); ++i) {
+        EXPECT_FLOAT_EQ(TupleView(sorted[i]).field(0).asFloat(), vals[i]);
+    }
+}
+
+TEST(ExternalSort, MultiColumnKeysWithDescending) {
+    StorageManager in(tmp_db_path("multi_in"));
+    std::mt19937 rng(11);
+    std::vector<std::pair<int, std::string>> rows;
+    {
+        RecordWriter w(in);
+        for (int i = 0; i < 2000; ++i) {
+            const int group = static_cast<int>(rng() % 10);
+            const std::string name = "n" + std::to_string(rng() % 500);
+            rows.emplace_back(group, name);
+            w.append(row(group, name));
+        }
+        w.finish();
+    }
+
+    ExternalSortOptions o;
+    o.keys = {{0, srd::record::SortOrder::DESC},
+              {1, srd::record::SortOrder::ASC}};
+    o.memory_budget = 32 * 1024;
+    o.threads = 2;
+    StorageManager out(tmp_db_path("multi_out"));
+    const auto stats = ExternalSort(o).sort(in, out);
+    EXPECT_GT(stats.initial_runs, 1u);
+
+    std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
+        if (a.first != b.first) return a.first > b.first;
+        return a.second < b.second;
+    });
+    const auto sorted = read_all(out);
+    ASSERT_EQ(sorted.size(), rows.size());
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        const TupleView v(sorted[i]);
+        EXPECT_EQ(v.field(0).asInt(), rows[i].first) << i;
+        EXPECT_EQ(v.field(1).asString(), rows[i].second) << i;
+    }
+}
+
+TEST(ExternalSort, FailedSortRemovesItsRuns) {
+    StorageManager in(tmp_db_path("bad_in"));
+    {
+        RecordWriter w(in);
+        for (int i = 0; i < 3000; ++i) w.append(row(i, "payload"));
+        w.append("not a tuple");  // the key encoder throws on it
+        w.finish();
+    }
+
+    ExternalSortOptions o;
+    o.memory_budget = 32 * 1024;  // runs are spilled before the bad record
+    o.threads = 1;
+    StorageManager out(tmp_db_path("bad_out"));
+    EXPECT_THROW(ExternalSort(o).sort(in, out), std::runtime_error);
+    EXPECT_EQ(leftover_runs(), 0u);
+}
+
+TEST(ExternalSort, EmptyInputProducesNothing) {
+    StorageManager in(tmp_db_path("empty_in"));
+    StorageManager out(tmp_db_path("empty_out"));
+    const auto stats = ExternalSort().sort(in, out);
+    EXPECT_EQ(stats.records, 0u);
+    EXPECT_EQ(stats.initial_runs, 0u);
+    EXPECT_TRUE(read_all(out).empty());
+}
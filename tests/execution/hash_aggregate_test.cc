@@ -0,0 +1,227 @@
+#include "srd/execution/hash_aggregate.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "srd/record/tuple.hpp"
+#include "srd/storage/record_stream.hpp"
+
+using srd::execution::AggregateOp;
+using srd::execution::AggregateValue;
+using srd::execution::HashAggregate;
+using srd::execution::HashAggregateOptions;
+using srd::execution::HashAggregateStats;
+using srd::record::Field;
+using srd::record::Tuple;
+using srd::record::TupleView;
+using srd::storage::RecordWriter;
+using srd::storage::StorageManager;
+
+static std::string tmp_db_path(const char *tag) {
+    auto now =
+        std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    std::mt19937_64 rng(static_cast<unsigned long long>(now));
+    return std::string("srd_agg_") + tag + "_" + std::to_string(rng()) +
+           ".dat";
+}
+
+// Rows are (region STRING, key INT, amount INT, price FLOAT).
+struct Row {
+    std::string region;
+    int key;
+    int amount;
+    float price;
+};
+
+static std::vector<Row> random_rows(std::size_t n, int keys, unsigned seed) {
+    std::mt19937 rng(seed);
+    const char *regions[] = {"eu", "us", "apac"};
+    std::vector<Row> rows(n);
+    for (auto &r : rows) {
+        r.region = regions[rng() % 3];
+        r.key = static_cast<int>(rng() % keys);
+        r.amount = static_cast<int>(rng() % 2001) - 1000;
+        r.price = static_cast<float>(rng() % 10000) / 8.0f;
+    }
+    return rows;
+}
+
+static void fill(StorageManager &sm, const std::vector<Row> &rows) {
+    RecordWriter w(sm);
+    for (const auto &r : rows) {
+        Tuple t;
+        t.addField(std::make_unique<Field>(r.region));
+        t.addField(std::make_unique<Field>(r.key));
+        t.addField(std::make_unique<Field>(r.amount));
+        t.addField(std::make_unique<Field>(r.price));
+        w.append(t.serialize());
+    }
+    w.finish();
+}
+
+// Per group: count, sum(amount), min(price), max(amount).
+using Group = std::pair<std::string, int>;
+using Result = std::tuple<uint64_t, int64_t, float, int>;
+
+static std::map<Group, Result> reference(const std::vector<Row> &rows) {
+    std::map<Group, Result> out;
+    for (const auto &r : rows) {
+        auto [it, fresh] = out.try_emplace(
+            Group{r.region, r.key}, Result{0, 0, r.price, r.amount});
+        auto &[count, sum, min_price, max_amount] = it->second;
+        ++count;
+        sum += r.amount;
+        min_price = std::min(min_price, r.price);
+        max_amount = std::max(max_amount, r.amount);
+    }
+    return out;
+}
+
+static HashAggregateOptions rollup_options() {
+    HashAggregateOptions o;
+    o.group_by = {0, 1};
+    o.aggregates = {{AggregateOp::COUNT, 0},
+                    {AggregateOp::SUM, 2},
+                    {AggregateOp::MIN, 3},
+                    {AggregateOp::MAX, 2}};
+    return o;
+}
+
+static std::map<Group, Result> aggregate(StorageManager &sm,
+                                         const HashAggregateOptions &o,
+                                         HashAggregateStats *stats_out) {
+    std::map<Group, Result> out;
+    const auto stats = HashAggregate(o).run(
+        sm, [&](const TupleView &g, std::span<const AggregateValue> v) {
+            EXPECT_EQ(g.size(), 2u);
+            EXPECT_EQ(v.size(), 4u);
+            EXPECT_EQ(v[1].float_count, 0u);
+            EXPECT_EQ(v[2].int_count, 0u);
+            const bool fresh =
+                out.emplace(Group{std::string(g.field(0).asString()),
+                                  g.field(1).asInt()},
+                            Result{v[0].count, v[1].int_value,
+                                   static_cast<float>(v[2].float_value),
+                                   static_cast<int>(v[3].int_value)})
+                    .second;
+            EXPECT_TRUE(fresh) << "group emitted twice";
+        });
+    EXPECT_EQ(stats.groups, out.size());
+    if (stats_out) *stats_out = stats;
+    return out;
+}
+
+TEST(HashAggregate, PreAggregationMatchesReference) {
+    const auto rows = random_rows(20000, 200, 1);
+    StorageManager sm(tmp_db_path("mem"));
+    fill(sm, rows);
+
+    auto o = rollup_options();
+    o.threads = 3;
+    o.local_groups = 64;  // forces repeated evictions
+    o.partitions = 8;
+    HashAggregateStats stats;
+    EXPECT_EQ(aggregate(sm, o, &stats), reference(rows));
+    EXPECT_FALSE(stats.spilled);
+    EXPECT_EQ(stats.respills, 0u);
+}
+
+TEST(HashAggregate, HighCardinalitySpills) {
+    const auto rows = random_rows(15000, 5000, 2);
+    StorageManager sm(tmp_db_path("spill"));
+    fill(sm, rows);
+
+    auto o = rollup_options();
+    o.threads = 2;
+    o.local_groups = 256;
+    o.memory_budget = 32 * 1024;
+    HashAggregateStats stats;
+    EXPECT_EQ(aggregate(sm, o, &stats), reference(rows));
+    EXPECT_TRUE(stats.spilled);
+    // ~10k groups do not fit one 16 KiB table per merging thread.
+    EXPECT_GT(stats.respills, 0u);
+    for (const auto &e : std::filesystem::directory_iterator(".")) {
+        EXPECT_NE(e.path().extension(), ".tmp") << e.path();
+    }
+}
+
+TEST(HashAggregate, PartialsLargerThanAPageSpill) {
+    const auto rows = random_rows(3000, 300, 3);
+    StorageManager sm(tmp_db_path("wide"));
+    fill(sm, rows);
+
+    // 4 + key + 120 * 32 bytes per partial: more than a page record holds.
+    constexpr std::size_t AGGS = 120;
+    HashAggregateOptions o;
+    o.group_by = {1};
+    o.aggregates.assign(AGGS, {AggregateOp::SUM, 2});
+    o.threads = 2;
+    o.local_groups = 32;
+    o.memory_budget = 8 * 1024;
+    std::map<int, int64_t> expected;
+    for (const auto &r : rows) expected[r.key] += r.amount;
+
+    std::map<int, int64_t> out;
+    const auto stats = HashAggregate(o).run(
+        sm, [&](const TupleView &g, std::span<const AggregateValue> v) {
+            ASSERT_EQ(v.size(), AGGS);
+            for (const auto &x : v) EXPECT_EQ(x.int_value, v[0].int_value);
+            out[g.field(0).asInt()] = v[0].int_value;
+        });
+    EXPECT_TRUE(stats.spilled);
+    EXPECT_EQ(out, expected);
+}
+
+TEST(HashAggregate, MixedTypesAndMissingColumns) {
+    StorageManager sm(tmp_db_path("mixed"));
+    {
+        RecordWriter w(sm);
+        auto row = [&](int key, Field value) {
+            Tuple t;
+            t.addField(std::make_unique<Field>(key));
+            t.addField(std::make_unique<Field>(value));
+            w.append(t.serialize());
+        };
+        row(1, Field(5));
+        row(1, Field(2.5f));
+        row(1, Field(std::string("ignored")));
+        row(2, Field(-7));
+        Tuple key_only, none;
+        key_only.addField(std::make_unique<Field>(2));
+        w.append(key_only.serialize());
+        w.append(none.serialize());  // no group column: skipped
+        w.finish();
+    }
+
+    HashAggregateOptions o;
+    o.group_by = {0};
+    o.aggregates = {{AggregateOp::COUNT, 0}, {AggregateOp::SUM, 1}};
+    std::map<int, std::vector<AggregateValue>> out;
+    const auto stats = HashAggregate(o).run(
+        sm, [&](const TupleView &g, std::span<const AggregateValue> v) {
+            out[g.field(0).asInt()].assign(v.begin(), v.end());
+        });
+    EXPECT_EQ(stats.records, 6u);
+    EXPECT_EQ(stats.skipped_records, 1u);
+    ASSERT_EQ(out.size(), 2u);
+
+    EXPECT_EQ(out[1][0].count, 3u);
+    EXPECT_EQ(out[1][1].count, 2u);
+    EXPECT_EQ(out[1][1].int_count, 1u);
+    EXPECT_EQ(out[1][1].int_value, 5);
+    EXPECT_EQ(out[1][1].float_count, 1u);
+    EXPECT_DOUBLE_EQ(out[1][1].float_value, 2.5);
+
+    EXPECT_EQ(out[2][0].count, 2u);
+    EXPECT_EQ(out[2][1].count, 1u);
+    EXPECT_EQ(out[2][1].int_value, -7);
+    EXPECT_EQ(out[2][1].float_count, 0u);
+}
@@ -0,0 +1,192 @@
+#include "srd/execution/hash_join.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "srd/record/tuple.hpp"
+#include "srd/storage/record_stream.hpp"
+
+using srd::execution::HashJoin;
+using srd::execution::HashJoinOptions;
+using srd::execution::HashJoinStats;
+using srd::record::Field;
+using srd::record::Tuple;
+using srd::record::TupleView;
+using srd::storage::RecordWriter;
+using srd::storage::StorageManager;
+
+static std::string tmp_db_path(const char *tag) {
+    auto now =
+        std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    std::mt19937_64 rng(static_cast<unsigned long long>(now));
+    return std::string("srd_join_") + tag + "_" + std::to_string(rng()) +
+           ".dat";
+}
+
+// Rows are (key, id): build ids are >= 0, probe ids are negative.
+static void fill(StorageManager &sm, const std::vector<int> &keys,
+                 int id_sign) {
+    RecordWriter w(sm);
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        Tuple t;
+        t.addField(std::make_unique<Field>(keys[i]));
+        t.addField(std::make_unique<Field>(id_sign * static_cast<int>(i)));
+        w.append(t.serialize());
+    }
+    w.finish();
+}
+
+using Pair = std::pair<int, int>;  // build id, probe id
+
+static std::vector<Pair> reference(const std::vector<int> &b,
+                                   const std::vector<int> &p) {
+    std::vector<Pair> out;
+    for (std::size_t i = 0; i < b.size(); ++i) {
+        for (std::size_t j = 0; j < p.size(); ++j) {
+            if (b[i] == p[j]) out.emplace_back(int(i), -int(j));
+        }
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+static std::vector<Pair> join(StorageManager &b, StorageManager &p,
+                              const HashJoinOptions &o,
+                              HashJoinStats *stats_out) {
+    std::vector<Pair> out;
+    const auto stats =
+        HashJoin(o).run(b, p, [&](const TupleView &bt, const TupleView &pt) {
+            EXPECT_EQ(bt.field(0).asInt(), pt.field(0).asInt());
+            out.emplace_back(bt.field(1).asInt(), pt.field(1).asInt());
+        });
+    EXPECT_EQ(stats.matches, out.size());
+    if (stats_out) *stats_out = stats;
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+static void expect_no_spill_files() {
+    for (const auto &e : std::filesystem::directory_iterator(".")) {
+        // Spill files and their side files.
+        EXPECT_EQ(e.path().string().find(".tmp"), std::string::npos)
+            << e.path();
+    }
+}
+
+static std::vector<int> random_keys(std::size_t n, int range, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<int> keys(n);
+    for (auto &k : keys) k = static_cast<int>(rng() % range);
+    return keys;
+}
+
+TEST(HashJoin, InMemoryMatchesNestedLoops) {
+    const auto bk = random_keys(3000, 1000, 1);
+    const auto pk = random_keys(2000, 1500, 2);
+    StorageManager b(tmp_db_path("b")), p(tmp_db_path("p"));
+    fill(b, bk, 1);
+    fill(p, pk, -1);
+
+    HashJoinOptions o;
+    o.threads = 3;
+    o.partition_bytes = 8 * 1024;  // several radix partitions
+    HashJoinStats stats;
+    EXPECT_EQ(join(b, p, o, &stats), reference(bk, pk));
+    EXPECT_FALSE(stats.spilled);
+}
+
+TEST(HashJoin, GraceSpillMatchesNestedLoops) {
+    const auto bk = random_keys(4000, 800, 3);
+    const auto pk = random_keys(1000, 1000, 4);
+    StorageManager b(tmp_db_path("gb")), p(tmp_db_path("gp"));
+    fill(b, bk, 1);
+    fill(p, pk, -1);
+
+    HashJoinOptions o;
+    o.threads = 2;
+    o.memory_budget = 16 * 1024;
+    HashJoinStats stats;
+    EXPECT_EQ(join(b, p, o, &stats), reference(bk, pk));
+    EXPECT_TRUE(stats.spilled);
+    expect_no_spill_files();
+}
+
+TEST(HashJoin, OversizedPartitionsSplitAgainOrJoinInChunks) {
+    // Key 7 is a quarter of the build side: no hash can split it.
+    auto bk = random_keys(6000, 3000, 5);
+    for (std::size_t i = 0; i < bk.size(); i += 4) bk[i] = 7;
+    const auto pk = random_keys(1500, 3000, 6);
+    StorageManager b(tmp_db_path("rb")), p(tmp_db_path("rp"));
+    fill(b, bk, 1);
+    fill(p, pk, -1);
+
+    HashJoinOptions o;
+    o.threads = 2;
+    o.memory_budget = 8 * 1024;
+    o.max_spill_files = 4;
+    HashJoinStats stats;
+    EXPECT_EQ(join(b, p, o, &stats), reference(bk, pk));
+    EXPECT_EQ(stats.partitions, 4u);
+    EXPECT_GT(stats.repartitions, 0u);
+    EXPECT_GT(stats.chunked_pairs, 0u);
+    expect_no_spill_files();
+}
+
+TEST(HashJoin, SpillFilesAreRemovedOnError) {
+    const auto bk = random_keys(4000, 800, 7);
+    StorageManager b(tmp_db_path("eb")), p(tmp_db_path("ep"));
+    fill(b, bk, 1);
+    fill(p, bk, -1);
+
+    HashJoinOptions o;
+    o.memory_budget = 16 * 1024;
+    EXPECT_THROW(HashJoin(o).run(b, p,
+                                 [](const TupleView &, const TupleView &) {
+                                     throw std::runtime_error("stop");
+                                 }),
+                 std::runtime_error);
+    expect_no_spill_files();
+}
+
+TEST(HashJoin, StringKeysTypesAndMissingColumns) {
+    StorageManager b(tmp_db_path("sb")), p(tmp_db_path("sp"));
+    {
+        RecordWriter w(b);
+        Tuple s, i, none;
+        s.addField(std::make_unique<Field>(std::string("alpha")));
+        i.addField(std::make_unique<Field>(3));
+        w.append(s.serialize());
+        w.append(i.serialize());
+        w.append(none.serialize());
+        w.finish();
+    }
+    {
+        RecordWriter w(p);
+        Tuple s, f, other, none;
+        s.addField(std::make_unique<Field>(std::string("alpha")));
+        f.addField(std::make_unique<Field>(3.0f));  // FLOAT never meets INT
+        other.addField(std::make_unique<Field>(std::string("alphabet")));
+        w.append(s.serialize());
+        w.append(f.serialize());
+        w.append(other.serialize());
+        w.append(none.serialize());
+        w.finish();
+    }
+    std::vector<std::string> hits;
+    const auto stats =
+        HashJoin().run(b, p, [&](const TupleView &bt, const TupleView &pt) {
+            hits.emplace_back(bt.field(0).asString());
+            EXPECT_EQ(pt.field(0).asString(), "alpha");
+        });
+    EXPECT_EQ(hits, std::vector<std::string>{"alpha"});
+    EXPECT_EQ(stats.build_records, 3u);
+    EXPECT_EQ(stats.probe_records, 4u);
+}
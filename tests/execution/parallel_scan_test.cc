@@ -0,0 +1,68 @@
+#include "srd/execution/parallel_scan.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "srd/storage/record_stream.hpp"
+
+using srd::execution::parallel_scan;
+using srd::execution::resolve_threads;
+using srd::storage::RecordWriter;
+using srd::storage::StorageManager;
+
+static std::string tmp_db_path(const char *tag) {
+    auto now =
+        std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    std::mt19937_64 rng(static_cast<unsigned long long>(now));
+    return std::string("srd_scan_") + tag + "_" + std::to_string(rng()) +
+           ".dat";
+}
+
+TEST(ParallelScan, EveryRecordSeenExactlyOnce) {
+    StorageManager sm(tmp_db_path("once"));
+    {
+        RecordWriter w(sm);
+        for (int i = 0; i < 3000; ++i) w.append(std::to_string(i));
+        w.finish();
+    }
+    const std::size_t threads = 4;
+    std::vector<std::vector<std::string>> seen(threads);
+    const auto n = parallel_scan(sm, threads, 2,
+                                 [&](std::size_t t, std::string_view rec) {
+                                     seen[t].emplace_back(rec);
+                                 });
+    EXPECT_EQ(n, 3000u);
+    std::set<std::string> all;
+    for (const auto &v : seen) {
+        EXPECT_FALSE(v.empty());
+        all.insert(v.begin(), v.end());
+    }
+    EXPECT_EQ(all.size(), 3000u);
+}
+
+TEST(ParallelScan, WorkerExceptionIsRethrown) {
+    StorageManager sm(tmp_db_path("throw"));
+    {
+        RecordWriter w(sm);
+        for (int i = 0; i < 500; ++i) w.append("x");
+        w.finish();
+    }
+    EXPECT_THROW(parallel_scan(sm, 2, 1,
+                               [](std::size_t t, std::string_view) {
+                                   if (t == 0) throw std::logic_error("boom");
+                               }),
+                 std::logic_error);
+}
+
+TEST(ParallelScan, ResolveThreadsIsBoundedByPages) {
+    EXPECT_EQ(resolve_threads(8, 3), 3u);
+    EXPECT_EQ(resolve_threads(2, 100), 2u);
+    EXPECT_EQ(resolve_threads(4, 0), 1u);
+    EXPECT_GE(resolve_threads(0, 1000), 1u);
+}
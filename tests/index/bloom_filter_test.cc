@@ -0,0 +1,254 @@
+#include "srd/index/bloom_filter.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "srd/common/hash.hpp"
+#include "srd/index/zone_map.hpp"
+#include "srd/record/tuple.hpp"
+
+using srd::common::mix64;
+using srd::index::BloomFilter;
+using srd::index::BloomIndex;
+using srd::index::BloomOptions;
+using srd::index::ZoneMap;
+using srd::record::Field;
+using srd::record::Tuple;
+using srd::record::TupleView;
+using srd::storage::SlottedPage;
+using srd::storage::StorageManager;
+
+static std::string tmp_db_path(const char *tag) {
+    auto now =
+        std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    std::mt19937_64 rng(static_cast<unsigned long long>(now));
+    return std::string("srd_bloom_") + tag + "_" + std::to_string(rng()) +
+           ".dat";
+}
+
+// Page p holds keys p * 1000 + j for j < ROWS.
+constexpr int ROWS = 20;
+
+static void write_pages(StorageManager &sm, int pages,
+                        BloomIndex *attach_to) {
+    for (int p = 0; p < pages; ++p) {
+        sm.extend_to(p);
+        SlottedPage page;
+        if (attach_to) attach_to->attach(p, page);
+        for (int j = 0; j < ROWS; ++j) {
+            auto t = std::make_unique<Tuple>();
+            t->addField(std::make_unique<Field>(std::to_string(p)));
+            t->addField(std::make_unique<Field>(p * 1000 + j));
+            ASSERT_TRUE(page.addTuple(std::move(t)));
+        }
+        sm.flush(p, page);
+        page.clear_observers();
+    }
+}
+
+TEST(BloomFilter, NoFalseNegativesAndTargetRate) {
+    constexpr std::size_t KEYS = 20000;
+    BloomFilter f(KEYS, 0.01);
+    EXPECT_EQ(f.memory_bytes(), f.num_blocks() * BloomFilter::BLOCK_BYTES);
+    EXPECT_LE(BloomFilter::expected_fpp(KEYS, f.num_blocks()), 0.01);
+    EXPECT_GT(BloomFilter::blocks_for(KEYS, 0.001), f.num_blocks());
+
+    for (uint64_t k = 0; k < KEYS; ++k) f.insert(mix64(k));
+    for (uint64_t k = 0; k < KEYS; ++k) ASSERT_TRUE(f.may_contain(mix64(k)));
+
+    std::size_t false_positives = 0;
+    constexpr std::size_t PROBES = 200000;
+    for (uint64_t k = KEYS; k < KEYS + PROBES; ++k) {
+        false_positives += f.may_contain(mix64(k)) ? 1 : 0;
+    }
+    EXPECT_LT(double(false_positives) / PROBES, 0.02);
+}
+
+TEST(BloomIndex, LookupSkipsRangesWithoutTheKey) {
+    const std::string path = tmp_db_path("lookup");
+    StorageManager sm(path);
+    constexpr int PAGES = 40;
+    write_pages(sm, PAGES, nullptr);
+
+    BloomOptions o;
+    o.column = 1;
+    o.pages_per_range = 4;
+    BloomIndex index(path, o);
+    index.build(sm);
+    EXPECT_EQ(index.num_ranges(), 10u);
+    EXPECT_GT(index.memory_bytes(), 0u);
+
+    std::vector<std::uint64_t> hits;
+    auto stats = index.lookup(sm, Field(17 * 1000 + 3),
+                              [&](std::uint64_t page, std::string_view rec) {
+                                  EXPECT_EQ(TupleView(rec).field(1).asInt(),
+                                            17003);
+                                  hits.push_back(page);
+                              });
+    EXPECT_EQ(hits, std::vector<std::uint64_t>{17});
+    EXPECT_EQ(stats.matches, 1u);
+    EXPECT_GE(stats.ranges_skipped, 8u);
+
+    // Absent keys (and keys of another type) mostly cost no I/O at all.
+    std::uint64_t pages_read = 0;
+    int no_io = 0;
+    for (int k = 0; k < 200; ++k) {
+        const Field absent(k * 1000 + 500);
+        stats = index.lookup(sm, absent, [](std::uint64_t, std::string_view) {
+            ADD_FAILURE() << "absent key matched";
+        });
+        pages_read += stats.pages_read;
+        if (!index.may_contain(sm.num_pages(), absent)) ++no_io;
+    }
+    EXPECT_LT(pages_read, 200u * 4u);  // well under one range per lookup
+    EXPECT_GT(no_io, 150);
+    EXPECT_EQ(index.lookup(sm, Field(17003.0f),
+                           [](std::uint64_t, std::string_view) {})
+                  .matches,
+              0u);
+}
+
+TEST(BloomIndex, IncrementalInsertsPersist) {
+    const std::string path = tmp_db_path("incr");
+    BloomOptions o;
+    o.column = 1;
+    o.pages_per_range = 2;
+    o.expected_keys_per_range = 2 * ROWS;
+    StorageManager sm(path);
+    {
+        BloomIndex index(path, o);
+        write_pages(sm, 6, &index);
+        EXPECT_EQ(index.num_ranges(), 3u);
+        EXPECT_TRUE(index.may_contain(6, Field(5019)));
+        index.save();
+    }
+
+    BloomIndex loaded(path, o);
+    ASSERT_TRUE(loaded.load());
+    EXPECT_EQ(loaded.num_ranges(), 3u);
+    for (int p = 0; p < 6; ++p) {
+        for (int j = 0; j < ROWS; ++j) {
+            ASSERT_TRUE(loaded.may_contain(6, Field(p * 1000 + j)));
+        }
+    }
+    const auto stats = loaded.lookup(sm, Field(4007),
+                                     [](std::uint64_t, std::string_view) {});
+    EXPECT_EQ(stats.matches, 1u);
+
+    BloomOptions other = o;
+    other.column = 0;
+    BloomIndex mismatched(path, other);
+    EXPECT_FALSE(mismatched.load());
+
+    // The first insert after load() drops the side file, which would not
+    // hold the new key.
+    SlottedPage page;
+    loaded.attach(5, page);
+    auto t = std::make_unique<Tuple>();
+    t->addField(std::make_unique<Field>(std::string("5")));
+    t->addField(std::make_unique<Field>(9999));
+    ASSERT_TRUE(page.addTuple(std::move(t)));
+    page.clear_observers();
+    EXPECT_TRUE(loaded.may_contain(6, Field(9999)));
+    EXPECT_FALSE(std::filesystem::exists(BloomIndex::side_path(path)));
+    BloomIndex stale(path, o);
+    EXPECT_FALSE(stale.load());
+}
+
+TEST(BloomIndex, SharesPagesWithZoneMap) {
+    const std::string path = tmp_db_path("shared");
+    BloomOptions o;
+    o.column = 1;
+    o.expected_keys_per_range = ROWS;
+    BloomIndex bloom(path, o);
+    ZoneMap zones(path, {1});
+    SlottedPage page;
+    bloom.attach(0, page);
+    zones.attach(0, page);
+    bloom.attach(0, page);  // already attached: no second notification
+
+    for (int j = 0; j < ROWS; ++j) {
+        auto t = std::make_unique<Tuple>();
+        t->addField(std::make_unique<Field>(std::string("k")));
+        t->addField(std::make_unique<Field>(100 + j));
+        ASSERT_TRUE(page.addTuple(std::move(t)));
+    }
+    for (int j = 0; j < ROWS; ++j) {
+        EXPECT_TRUE(bloom.may_contain(1, Field(100 + j)));
+    }
+    EXPECT_EQ(zones.zone(0, 0).rows, static_cast<uint32_t>(ROWS));
+    EXPECT_EQ(zones.zone(0, 0).int_min, 100);
+    EXPECT_EQ(zones.zone(0, 0).int_max, 100 + ROWS - 1);
+    page.clear_observers();
+}
+
+TEST(BloomIndex, IncrementalFiltersReportOverfullAndBuildResizes) {
+    const std::string path = tmp_db_path("overfull");
+    StorageManager sm(path);
+    BloomOptions o;
+    o.column = 1;
+    o.expected_keys_per_range = 4;
+    BloomIndex index(path, o);
+    write_pages(sm, 3, &index);  // 60 keys in a filter sized for 4
+    auto stats = index.stats();
+    EXPECT_EQ(stats.ranges, 1u);
+    EXPECT_EQ(stats.keys, 3u * ROWS);
+    EXPECT_EQ(stats.overfull_ranges, 1u);
+    EXPECT_GT(stats.worst_fpp, o.fpp);
+
+    const std::size_t before = index.memory_bytes();
+    index.build(sm);
+    stats = index.stats();
+    EXPECT_EQ(stats.overfull_ranges, 0u);
+    EXPECT_LE(stats.worst_fpp, o.fpp);
+    EXPECT_GT(stats.memory_bytes, before);
+
+    // Observers point into the filters: they cannot be swapped out.
+    index.save();
+    EXPECT_THROW(index.load(), std::runtime_error);
+    std::filesystem::remove(BloomIndex::side_path(path));
+}
+
+TEST(BloomIndex, BuildWhileAttachedPagesInsert) {
+    const std::string path = tmp_db_path("rebuild");
+    StorageManager sm(path);
+    sm.extend_to(0);
+    BloomOptions o;
+    o.column = 1;
+    o.expected_keys_per_range = 8;
+    BloomIndex index(path, o);
+    SlottedPage page;
+    index.attach(0, page);
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> inserted{0};
+    std::thread writer([&] {
+        for (int k = 0; !stop.load() && k < 100; ++k) {
+            auto t = std::make_unique<Tuple>();
+            t->addField(std::make_unique<Field>(std::string("w")));
+            t->addField(std::make_unique<Field>(k));
+            if (!page.addTuple(std::move(t))) break;
+            sm.flush(0, page);
+            ++inserted;
+        }
+    });
+    // Every build replaces the filter the writer's observer inserts into.
+    for (int i = 0; i < 50; ++i) index.build(sm);
+    stop = true;
+    writer.join();
+
+    sm.flush(0, page);
+    index.build(sm);
+    for (int k = 0; k < inserted.load(); ++k) {
+        EXPECT_TRUE(index.may_contain(1, Field(k))) << k;
+    }
+    page.clear_observers();
+}
@@ -0,0 +1,200 @@
+#include "srd/index/zone_map.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "srd/record/tuple.hpp"
+
+using srd::index::RangePredicate;
+using srd::index::ZoneMap;
+using srd::record::Field;
+using srd::record::Tuple;
+using srd::record::TupleView;
+using srd::storage::SlottedPage;
+using srd::storage::StorageManager;
+
+static std::string tmp_db_path(const char *tag) {
+    auto now =
+        std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    std::mt19937_64 rng(static_cast<unsigned long long>(now));
+    return std::string("srd_zmap_") + tag + "_" + std::to_string(rng()) +
+           ".dat";
+}
+
+// (key INT, name STRING[, price FLOAT])
+static std::unique_ptr<Tuple> row(int key, const std::string &name,
+                                  bool with_price = true) {
+    auto t = std::make_unique<Tuple>();
+    t->addField(std::make_unique<Field>(key));
+    t->addField(std::make_unique<Field>(name));
+    if (with_price) {
+        t->addField(std::make_unique<Field>(static_cast<float>(key) / 4));
+    }
+    return t;
+}
+
+TEST(ZoneMap, ObserverWidensAndCompactionTightens) {
+    ZoneMap zm(tmp_db_path("obs"), {0, 2});
+    SlottedPage page;
+    zm.attach(0, page);
+
+    const std::string pad(1000, 'x');
+    ASSERT_TRUE(page.addTuple(row(1, pad)));
+    ASSERT_TRUE(page.addTuple(row(20, pad, false)));
+    ASSERT_TRUE(page.addTuple(row(30, pad)));
+    EXPECT_EQ(zm.zone(0, 0).rows, 3u);
+    EXPECT_EQ(zm.zone(0, 0).int_min, 1);
+    EXPECT_EQ(zm.zone(0, 0).int_max, 30);
+    EXPECT_EQ(zm.zone(0, 1).missing, 1u);
+    EXPECT_FLOAT_EQ(zm.zone(0, 1).float_min, 0.25f);
+    EXPECT_FLOAT_EQ(zm.zone(0, 1).float_max, 7.5f);
+
+    // Deleting only narrows counts; the range stays wide.
+    ASSERT_TRUE(page.deleteTuple(0));
+    EXPECT_EQ(zm.zone(0, 0).int_count, 2u);
+    EXPECT_EQ(zm.zone(0, 0).int_min, 1);
+    EXPECT_EQ(zm.zone(0, 1).float_count, 1u);
+
+    // The freed bytes sit before the tail, so this insert only fits after
+    // compaction, which recomputes the summary from the live rows.
+    ASSERT_TRUE(page.addTuple(row(25, pad)));
+    EXPECT_EQ(zm.zone(0, 0).int_count, 3u);
+    EXPECT_EQ(zm.zone(0, 0).int_min, 20);
+    EXPECT_EQ(zm.zone(0, 0).int_max, 30);
+    EXPECT_FLOAT_EQ(zm.zone(0, 1).float_min, 6.25f);
+    page.clear_observers();
+}
+
+TEST(ZoneMap, GrowingRecordThroughCompactionCountsOnce) {
+    ZoneMap zm(tmp_db_path("grow"), {0});
+    SlottedPage page;
+    zm.attach(0, page);
+
+    const std::string pad(1000, 'x');
+    ASSERT_TRUE(page.addTuple(row(10, pad)));
+    ASSERT_TRUE(page.addTuple(row(20, pad)));
+    ASSERT_TRUE(page.addTuple(row(30, pad)));
+    ASSERT_TRUE(page.deleteTuple(0));
+
+    // The grown record only fits once the hole left by slot 0 is compacted
+    // away; the compaction already drops the old record from the summary.
+    ASSERT_TRUE(page.updateRecord(1, row(21, std::string(1500, 'y'))
+                                         ->serialize()));
+    EXPECT_EQ(zm.zone(0, 0).rows, 2u);
+    EXPECT_EQ(zm.zone(0, 0).int_count, 2u);
+    EXPECT_EQ(zm.zone(0, 0).int_min, 21);
+    EXPECT_EQ(zm.zone(0, 0).int_max, 30);
+    EXPECT_TRUE(zm.may_match(0, RangePredicate::int_range(0, 30, 30)));
+    EXPECT_TRUE(zm.may_match(0, RangePredicate::int_range(0, 21, 21)));
+    page.clear_observers();
+}
+
+TEST(ZoneMap, ScanSkipsExcludedPages) {
+    const std::string path = tmp_db_path("scan");
+    StorageManager sm(path);
+    ZoneMap zm(path, {0, 1});
+    constexpr int PAGES = 20, ROWS = 10;
+    for (int p = 0; p < PAGES; ++p) {
+        sm.extend_to(p);
+        SlottedPage page;
+        zm.attach(p, page);
+        for (int j = 0; j < ROWS; ++j) {
+            const int key = p * 100 + j * 10;
+            ASSERT_TRUE(page.addTuple(row(key, "n" + std::to_string(p))));
+        }
+        if (p == 7) {  // one row without a name column
+            auto t = std::make_unique<Tuple>();
+            t->addField(std::make_unique<Field>(p * 100 + 5));
+            ASSERT_TRUE(page.addTuple(std::move(t)));
+        }
+        sm.flush(p, page);
+    }
+
+    std::vector<int> keys;
+    auto stats = zm.scan(sm, RangePredicate::int_range(0, 550, 849),
+                         [&](std::uint64_t page_id, std::string_view rec) {
+                             const int k = TupleView(rec).field(0).asInt();
+                             EXPECT_EQ(static_cast<int>(page_id), k / 100);
+                             keys.push_back(k);
+                         });
+    EXPECT_EQ(stats.pages, static_cast<std::uint64_t>(PAGES));
+    EXPECT_EQ(stats.pages_skipped, static_cast<std::uint64_t>(PAGES - 4));
+    EXPECT_EQ(stats.records, keys.size());
+    // 550..590, 600..690, 700..790 plus 705, 800..840
+    EXPECT_EQ(keys.size(), 31u);
+
+    // STRING prefixes prune too; "n1" .. "n12" covers n1, n10, n11, n12.
+    stats = zm.scan(sm, RangePredicate::string_range(1, "n1", "n12"),
+                    [](std::uint64_t, std::string_view) {});
+    EXPECT_EQ(stats.records, 4u * ROWS);
+    EXPECT_EQ(stats.pages_skipped, static_cast<std::uint64_t>(PAGES - 4));
+
+    stats = zm.scan(sm, RangePredicate::missing(1),
+                    [](std::uint64_t, std::string_view) {});
+    EXPECT_EQ(stats.records, 1u);
+    EXPECT_EQ(stats.pages_skipped, static_cast<std::uint64_t>(PAGES - 1));
+
+    // Columns without a summary cannot prune.
+    stats = zm.scan(sm, RangePredicate::float_range(2, 0.0f, 1.0f),
+                    [](std::uint64_t, std::string_view) {});
+    EXPECT_EQ(stats.pages_skipped, 0u);
+    EXPECT_EQ(stats.records, 1u);  // only key 0 has a price in [0, 1]
+}
+
+TEST(ZoneMap, SideFileRoundTripAndRebuild) {
+    const std::string path = tmp_db_path("file");
+    StorageManager sm(path);
+    {
+        sm.extend_to(0);
+        SlottedPage page;
+        ASSERT_TRUE(page.addTuple(row(42, "answer")));
+        size_t slot = 0;
+        ASSERT_TRUE(page.addRecord("raw", slot));  // not a tuple
+        sm.flush(0, page);
+        sm.extend_to(1);
+        SlottedPage second;
+        ASSERT_TRUE(second.addTuple(row(-3, "neg")));
+        sm.flush(1, second);
+    }
+
+    ZoneMap built(path, {0});
+    built.rebuild(sm);
+    ASSERT_EQ(built.num_pages(), 2u);
+    EXPECT_EQ(built.zone(1, 0).int_min, -3);
+    const auto pred = RangePredicate::int_range(0, 100, 200);
+    EXPECT_TRUE(built.may_match(0, pred));  // opaque: never skipped
+    EXPECT_FALSE(built.may_match(1, pred));
+    built.save();
+    EXPECT_TRUE(std::filesystem::exists(ZoneMap::side_path(path)));
+
+    ZoneMap loaded(path, {0});
+    ASSERT_TRUE(loaded.load());
+    ASSERT_EQ(loaded.num_pages(), 2u);
+    EXPECT_EQ(loaded.zone(0, 0).int_max, 42);
+    EXPECT_EQ(loaded.zone(1, 0).int_count, 1u);
+    EXPECT_TRUE(loaded.may_match(0, pred));
+    EXPECT_FALSE(loaded.may_match(1, pred));
+
+    ZoneMap other_columns(path, {1});
+    EXPECT_FALSE(other_columns.load());
+    EXPECT_EQ(other_columns.num_pages(), 0u);
+
+    // The first change after load() drops the side file, which no longer
+    // describes the pages.
+    auto page = sm.load(1);
+    loaded.attach(1, *page);
+    ASSERT_TRUE(page->addTuple(row(150, "new")));
+    EXPECT_TRUE(loaded.may_match(1, pred));
+    EXPECT_FALSE(std::filesystem::exists(ZoneMap::side_path(path)));
+    ZoneMap stale(path, {0});
+    EXPECT_FALSE(stale.load());
+    loaded.save();
+    EXPECT_TRUE(stale.load());
+    EXPECT_TRUE(stale.may_match(1, pred));
+    std::filesystem::remove(ZoneMap::side_path(path));
+}
@@ -0,0 +1,146 @@
+#include "srd/ingest/csv_import.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "srd/record/tuple_view.hpp"
+#include "srd/storage/record_stream.hpp"
+
+using srd::ingest::CsvImporter;
+using srd::ingest::CsvOptions;
+using srd::record::FieldType;
+using srd::record::TupleView;
+using srd::storage::RecordReader;
+using srd::storage::StorageManager;
+
+static std::string tmp_db_path(const char *tag) {
+    auto now =
+        std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    std::mt19937_64 rng(static_cast<unsigned long long>(now));
+    return std::string("srd_csv_") + tag + "_" + std::to_string(rng()) +
+           ".dat";
+}
+
+static std::string write_csv(const char *tag, const std::string &text) {
+    const std::string path = tmp_db_path(tag) + ".csv";
+    std::ofstream(path, std::ios::binary) << text;
+    return path;
+}
+
+static std::vector<std::string> read_all(StorageManager &sm) {
+    RecordReader r(sm);
+    std::vector<std::string> out;
+    std::string rec;
+    while (r.next(rec)) out.push_back(rec);
+    return out;
+}
+
+TEST(CsvImport, ParsesTypesQuotesAndLineEndings) {
+    const std::string csv =
+        "id,price,name\n"
+        "1,2.5,plain\n"
+        "-42,+1e3,\"with, comma\"\r\n"
+        "\n"
+        "+7,-0.125,\"say \"\"hi\"\"\"\n"
+        "8,3,\n"
+        "9,4,lit\"eral";
+    const auto path = write_csv("types", csv);
+
+    CsvOptions o;
+    o.schema = {FieldType::INT, FieldType::FLOAT, FieldType::STRING};
+    o.header = true;
+    o.threads = 1;
+    StorageManager sm(tmp_db_path("types"));
+    const auto stats = CsvImporter(o).import(path, sm);
+    EXPECT_EQ(stats.rows, 5u);
+    EXPECT_EQ(stats.bad_rows, 0u);
+    EXPECT_EQ(stats.first_page, 0u);
+    EXPECT_EQ(stats.pages, 1u);
+
+    const auto recs = read_all(sm);
+    ASSERT_EQ(recs.size(), 5u);
+    const int ids[] = {1, -42, 7, 8, 9};
+    const float prices[] = {2.5f, 1000.0f, -0.125f, 3.0f, 4.0f};
+    const char *names[] = {"plain", "with, comma", "say \"hi\"", "",
+                           "lit\"eral"};
+    for (std::size_t i = 0; i < recs.size(); ++i) {
+        TupleView v(recs[i]);
+        ASSERT_EQ(v.size(), 3u);
+        EXPECT_EQ(v.field(0).asInt(), ids[i]);
+        EXPECT_FLOAT_EQ(v.field(1).asFloat(), prices[i]);
+        EXPECT_EQ(v.field(2).asString(), names[i]);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(CsvImport, ParallelChunksKeepInputOrder) {
+    std::string csv;
+    constexpr int N = 20000;
+    for (int i = 0; i < N; ++i) {
+        csv += std::to_string(i) + "|row number " + std::to_string(i) + "\n";
+    }
+    const auto path = write_csv("parallel", csv);
+
+    CsvOptions o;
+    o.schema = {FieldType::INT, FieldType::STRING};
+    o.delimiter = '|';
+    o.threads = 4;
+    o.chunk_bytes = 4096;
+    StorageManager sm(tmp_db_path("parallel"));
+    const auto stats = CsvImporter(o).import(path, sm);
+    EXPECT_EQ(stats.rows, static_cast<std::uint64_t>(N));
+    EXPECT_EQ(stats.bytes, csv.size());
+    EXPECT_EQ(stats.pages, sm.num_pages());
+
+    const auto recs = read_all(sm);
+    ASSERT_EQ(recs.size(), static_cast<std::size_t>(N));
+    for (int i = 0; i < N; ++i) {
+        TupleView v(recs[i]);
+        ASSERT_EQ(v.field(0).asInt(), i);
+        ASSERT_EQ(v.field(1).asString(), "row number " + std::to_string(i));
+    }
+
+    // A second import appends after the existing pages.
+    const auto again = CsvImporter(o).import(path, sm);
+    EXPECT_EQ(again.first_page, stats.pages);
+    EXPECT_EQ(read_all(sm).size(), 2u * N);
+    std::filesystem::remove(path);
+}
+
+TEST(CsvImport, MalformedRowsThrowOrAreSkipped) {
+    const std::string csv =
+        "1,a\n"
+        "x,b\n"          // bad int
+        "2,c,extra\n"    // too many fields
+        "3\n"            // too few fields
+        "4,\"d\"e\n"     // text after closing quote
+        "7,\"g\"\rh\n"   // a lone CR is text after it too
+        "5,\"open\n"     // unterminated quote
+        "6,f\n";
+    const auto path = write_csv("bad", csv);
+
+    CsvOptions o;
+    o.schema = {FieldType::INT, FieldType::STRING};
+    o.threads = 2;
+    {
+        StorageManager sm(tmp_db_path("bad_throw"));
+        EXPECT_THROW(CsvImporter(o).import(path, sm), std::runtime_error);
+    }
+
+    o.skip_bad_rows = true;
+    StorageManager sm(tmp_db_path("bad_skip"));
+    const auto stats = CsvImporter(o).import(path, sm);
+    EXPECT_EQ(stats.rows, 2u);
+    EXPECT_EQ(stats.bad_rows, 6u);
+    const auto recs = read_all(sm);
+    ASSERT_EQ(recs.size(), 2u);
+    EXPECT_EQ(TupleView(recs[1]).field(0).asInt(), 6);
+    std::filesystem::remove(path);
+}
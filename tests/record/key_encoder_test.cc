@@ -0,0 +1,125 @@
+#include "srd/record/key_encoder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using srd::record::Field;
+using srd::record::KeyColumn;
+using srd::record::KeyEncoder;
+using srd::record::SortOrder;
+using srd::record::Tuple;
+using srd::record::TupleView;
+
+static std::string key_of(const Field &f, SortOrder order = SortOrder::ASC) {
+    std::string out;
+    KeyEncoder::append(f, order, out);
+    return out;
+}
+
+// Every adjacent pair of 'fields' (given in logical order) must encode to
+// strictly increasing keys.
+static void expect_increasing(const std::vector<Field> &fields) {
+    for (std::size_t i = 1; i < fields.size(); ++i) {
+        EXPECT_LT(KeyEncoder::compare(key_of(fields[i - 1]), key_of(fields[i])),
+                  0)
+            << "at " << i;
+        EXPECT_GT(KeyEncoder::compare(key_of(fields[i - 1], SortOrder::DESC),
+                                      key_of(fields[i], SortOrder::DESC)),
+                  0)
+            << "DESC at " << i;
+    }
+}
+
+TEST(KeyEncoder, ScalarsCompareInLogicalOrder) {
+    constexpr int IMIN = std::numeric_limits<int>::min();
+    constexpr int IMAX = std::numeric_limits<int>::max();
+    expect_increasing({Field(IMIN), Field(-70000), Field(-1), Field(0),
+                       Field(1), Field(256), Field(IMAX)});
+
+    const float inf = std::numeric_limits<float>::infinity();
+    expect_increasing({Field(-inf), Field(-1e30f), Field(-2.5f),
+                       Field(-1e-30f), Field(-0.0f), Field(0.0f),
+                       Field(1e-30f), Field(3.0f), Field(inf)});
+
+    expect_increasing({Field(std::string("")), Field(std::string("a")),
+                       Field(std::string("a\0", 2)),
+                       Field(std::string("a\0\xff", 3)),
+                       Field(std::string("a\x01")), Field(std::string("ab")),
+                       Field(std::string("b")),
+                       Field(std::string("\xff\xff"))});
+
+    // Types order INT < FLOAT < STRING regardless of value.
+    expect_increasing({Field(IMAX), Field(-inf), Field(std::string(""))});
+}
+
+TEST(KeyEncoder, MultiColumnTuplesMatchLexicographicOrder) {
+    struct Row {
+        int a;
+        std::string b;
+        float c;
+    };
+    std::mt19937 rng(3);
+    std::vector<Row> rows;
+    for (int i = 0; i < 500; ++i) {
+        rows.push_back({static_cast<int>(rng() % 5) - 2,
+                        std::string(rng() % 3, static_cast<char>(rng() % 3)),
+                        static_cast<float>(rng() % 7) - 3.0f});
+    }
+    // a ASC, b DESC, c ASC
+    const KeyEncoder enc({{0, SortOrder::ASC},
+                          {1, SortOrder::DESC},
+                          {2, SortOrder::ASC}});
+    auto logical_less = [](const Row &x, const Row &y) {
+        if (x.a != y.a) return x.a < y.a;
+        if (x.b != y.b) return x.b > y.b;
+        return x.c < y.c;
+    };
+
+    std::vector<std::string> keys;
+    for (const auto &r : rows) {
+        Tuple t;
+        t.addField(std::make_unique<Field>(r.a));
+        t.addField(std::make_unique<Field>(r.b));
+        t.addField(std::make_unique<Field>(r.c));
+        std::string from_tuple, from_view;
+        enc.encode(t, from_tuple);
+        const std::string blob = t.serialize();
+        enc.encode(TupleView(blob), from_view);
+        ASSERT_EQ(from_tuple, from_view);
+        keys.push_back(from_tuple);
+    }
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        for (std::size_t j = 0; j < rows.size(); j += 7) {
+            const int c = KeyEncoder::compare(keys[i], keys[j]);
+            EXPECT_EQ(c < 0, logical_less(rows[i], rows[j]));
+            EXPECT_EQ(c == 0, !logical_less(rows[i], rows[j]) &&
+                                  !logical_less(rows[j], rows[i]));
+        }
+    }
+}
+
+TEST(KeyEncoder, MissingColumnsAndPrefix) {
+    const KeyEncoder asc({{1, SortOrder::ASC}});
+    const KeyEncoder desc({{1, SortOrder::DESC}});
+    Tuple short_row, full_row;
+    short_row.addField(std::make_unique<Field>(7));
+    full_row.addField(std::make_unique<Field>(7));
+    full_row.addField(std::make_unique<Field>(-5));
+
+    std::string missing, present;
+    asc.encode(short_row, missing);
+    asc.encode(full_row, present);
+    EXPECT_LT(KeyEncoder::compare(missing, present), 0);  // missing first
+    desc.encode(short_row, missing);
+    desc.encode(full_row, present);
+    EXPECT_GT(KeyEncoder::compare(missing, present), 0);
+
+    EXPECT_EQ(KeyEncoder::prefix(std::string("\x01\x02", 2)),
+              0x0102000000000000ull);
+    EXPECT_EQ(KeyEncoder::prefix("ABCDEFGHIJ"), 0x4142434445464748ull);
+}
@@ -0,0 +1,46 @@
+#include "srd/record/tuple_view.hpp"
+
+#include <gtest/gtest.h>
+
+#include "srd/record/tuple.hpp"
+
+using srd::record::Field;
+using srd::record::FieldType;
+using srd::record::Tuple;
+using srd::record::TupleView;
+
+TEST(TupleView, ReadsFieldsInPlace) {
+    Tuple t;
+    t.addField(std::make_unique<Field>(int(-12)));
+    t.addField(std::make_unique<Field>(std::string("hello")));
+    t.addField(std::make_unique<Field>(float(2.5f)));
+    const std::string blob = t.serialize();
+
+    TupleView v(blob);
+    ASSERT_EQ(v.size(), 3u);
+    EXPECT_EQ(v.field(0).type, FieldType::INT);
+    EXPECT_EQ(v.field(0).asInt(), -12);
+    EXPECT_EQ(v.field(1).asString(), "hello");
+    EXPECT_FLOAT_EQ(v.field(2).asFloat(), 2.5f);
+    // Views point into the record, no copies.
+    EXPECT_GE(v.field(1).payload.data(), blob.data());
+    EXPECT_LT(v.field(1).payload.data(), blob.data() + blob.size());
+}
+
+TEST(TupleView, TypeMismatchAndBoundsThrow) {
+    Tuple t;
+    t.addField(std::make_unique<Field>(int(1)));
+    const std::string blob = t.serialize();
+    TupleView v(blob);
+    EXPECT_THROW(v.field(0).asFloat(), std::runtime_error);
+    EXPECT_THROW(v.field(1), std::out_of_range);
+}
+
+TEST(TupleView, TruncatedRecordThrows) {
+    Tuple t;
+    t.addField(std::make_unique<Field>(std::string("abcdef")));
+    const std::string blob = t.serialize();
+    TupleView v(std::string_view(blob).substr(0, blob.size() - 2));
+    EXPECT_THROW(v.field(0), std::runtime_error);
+    EXPECT_THROW(TupleView(std::string_view("ab")), std::runtime_error);
+}
@@ -0,0 +1,183 @@
+#include "srd/storage/checkpointer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "srd/storage/slotted_page.hpp"
+
+using srd::storage::CheckpointOptions;
+using srd::storage::Checkpointer;
+using srd::storage::PAGE_SIZE;
+using srd::storage::SlottedPage;
+using srd::storage::StorageManager;
+
+static std::string tmp_db_path(const char *tag) {
+    auto now =
+        std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    std::mt19937_64 rng(static_cast<unsigned long long>(now));
+    return std::string("srd_ckpt_") + tag + "_" + std::to_string(rng()) +
+           ".dat";
+}
+
+static std::vector<std::unique_ptr<SlottedPage>> make_pages(std::size_t n) {
+    std::vector<std::unique_ptr<SlottedPage>> pages;
+    for (std::size_t i = 0; i < n; ++i) {
+        pages.push_back(std::make_unique<SlottedPage>());
+        std::size_t slot = 0;
+        pages.back()->addRecord("page " + std::to_string(i), slot);
+    }
+    return pages;
+}
+
+static bool same_on_disk(StorageManager &sm, std::uint64_t id,
+                         const SlottedPage &page) {
+    return std::memcmp(sm.load(id)->raw_data(), page.raw_data(),
+                       PAGE_SIZE) == 0;
+}
+
+TEST(Checkpointer, BackgroundRoundsWriteDirtyPagesInRuns) {
+    StorageManager sm(tmp_db_path("background"));
+    sm.extend_to(63);
+    auto pages = make_pages(64);
+
+    CheckpointOptions o;
+    o.interval = std::chrono::milliseconds(10);
+    o.bytes_per_sec = 0;
+    Checkpointer ckpt(sm, o);
+    // Two runs of adjacent pages: 10..19 and 40..49.
+    for (std::uint64_t id = 10; id < 20; ++id) {
+        ckpt.mark_dirty(id, pages[id].get());
+        ckpt.mark_dirty(id + 30, pages[id + 30].get());
+    }
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (ckpt.stats().pages_written < 20 &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    const auto stats = ckpt.stats();
+    EXPECT_EQ(stats.pages_written, 20u);
+    EXPECT_EQ(stats.runs, 2u * stats.rounds);
+    EXPECT_EQ(ckpt.dirty_pages(), 0u);
+    for (std::uint64_t id = 10; id < 20; ++id) {
+        EXPECT_TRUE(same_on_disk(sm, id, *pages[id]));
+        EXPECT_TRUE(same_on_disk(sm, id + 30, *pages[id + 30]));
+    }
+    EXPECT_FALSE(same_on_disk(sm, 25, *pages[25]));
+}
+
+TEST(Checkpointer, CheckpointWhileForegroundKeepsWriting) {
+    constexpr std::size_t N = 32;
+    StorageManager sm(tmp_db_path("fuzzy"));
+    sm.extend_to(N - 1);
+    auto pages = make_pages(N);
+
+    CheckpointOptions o;
+    o.interval = std::chrono::milliseconds(1);
+    Checkpointer ckpt(sm, o);
+    std::atomic<bool> stop{false};
+    // Full pages are replaced, but kept alive: a round may still hold them.
+    std::vector<std::unique_ptr<SlottedPage>> retired;
+    std::thread writer([&] {
+        std::mt19937 rng(3);
+        std::size_t slot = 0;
+        for (int k = 0; !stop.load(); ++k) {
+            const std::size_t id = rng() % N;
+            if (!pages[id]->addRecord("r" + std::to_string(k), slot)) {
+                retired.push_back(std::move(pages[id]));
+                pages[id] = std::make_unique<SlottedPage>();
+            }
+            ckpt.mark_dirty(id, pages[id].get());
+        }
+    });
+    // Checkpoints complete while pages change under them.
+    for (int i = 0; i < 5; ++i) ckpt.checkpoint();
+    stop = true;
+    writer.join();
+
+    // Once writes stop, a checkpoint makes the disk match memory.
+    ckpt.checkpoint();
+    for (std::size_t id = 0; id < N; ++id) {
+        EXPECT_TRUE(same_on_disk(sm, id, *pages[id])) << "page " << id;
+    }
+    EXPECT_GE(ckpt.stats().rounds, 6u);
+}
+
+TEST(Checkpointer, RateLimitAndFinalRoundOnDestruction) {
+    auto path = tmp_db_path("limit");
+    auto pages = make_pages(64);
+    {
+        StorageManager sm(path);
+        sm.extend_to(63);
+        CheckpointOptions o;
+        o.bytes_per_sec = 1 << 20;  // 64 pages = 256 KiB: about 250 ms
+        o.batch_pages = 8;
+        Checkpointer ckpt(sm, o);
+        for (std::uint64_t id = 0; id < 64; ++id) {
+            ckpt.mark_dirty(id, pages[id].get());
+        }
+        const auto start = std::chrono::steady_clock::now();
+        ckpt.checkpoint();
+        EXPECT_GE(std::chrono::steady_clock::now() - start,
+                  std::chrono::milliseconds(150));
+
+        // Marked but never checkpointed: written when ckpt goes away.
+        std::size_t slot = 0;
+        pages[5]->addRecord("late", slot);
+        ckpt.mark_dirty(5, pages[5].get());
+    }
+    StorageManager sm(path);
+    for (std::uint64_t id = 0; id < 64; ++id) {
+        EXPECT_TRUE(same_on_disk(sm, id, *pages[id])) << "page " << id;
+    }
+}
+
+TEST(Checkpointer, FailedRoundKeepsPagesDirtyForRetry) {
+    StorageManager sm(tmp_db_path("retry"));
+    sm.extend_to(3);
+    auto pages = make_pages(8);
+
+    CheckpointOptions o;
+    o.interval = std::chrono::hours(1);  // rounds only on request
+    o.bytes_per_sec = 0;
+    Checkpointer ckpt(sm, o);
+    ckpt.mark_dirty(2, pages[2].get());
+    ckpt.mark_dirty(7, pages[7].get());  // past the end of the file
+    // Every caller waiting on a failed round sees the failure.
+    std::atomic<int> failures{0};
+    std::vector<std::thread> callers;
+    for (int i = 0; i < 3; ++i) {
+        callers.emplace_back([&] {
+            try {
+                ckpt.checkpoint();
+            } catch (const std::out_of_range &) {
+                ++failures;
+            }
+        });
+    }
+    for (auto &c : callers) c.join();
+    EXPECT_EQ(failures.load(), 3);
+    EXPECT_THROW(ckpt.checkpoint(), std::out_of_range);
+    EXPECT_EQ(ckpt.dirty_pages(), 2u);
+    EXPECT_GE(ckpt.stats().failed_rounds, 1u);
+
+    // Marking again replaces the page put back by the failed round.
+    ckpt.mark_dirty(2, pages[3].get());
+    EXPECT_EQ(ckpt.dirty_pages(), 2u);
+    sm.extend_to(7);
+    ckpt.checkpoint();
+    EXPECT_EQ(ckpt.dirty_pages(), 0u);
+    EXPECT_TRUE(same_on_disk(sm, 2, *pages[3]));
+    EXPECT_TRUE(same_on_disk(sm, 7, *pages[7]));
+    EXPECT_EQ(ckpt.stats().rounds, 1u);
+}
@@ -0,0 +1,73 @@
+#include "srd/storage/page_codec.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "srd/storage/slotted_page.hpp"
+
+using srd::storage::PAGE_SIZE;
+using srd::storage::PageCodec;
+using srd::storage::SlottedPage;
+
+static std::string roundtrip(const std::string &in, std::string &packed) {
+    PageCodec::compress(in, packed);
+    EXPECT_LE(packed.size(), PageCodec::max_compressed_size(in.size()));
+    std::string out(in.size(), '\0');
+    PageCodec::decompress(packed, out.data(), out.size());
+    return out;
+}
+
+TEST(PageCodec, SlottedPageShrinksAndRoundtrips) {
+    SlottedPage page;
+    std::size_t slot = 0;
+    for (int i = 0; i < 30; ++i) {
+        page.addRecord("customer-" + std::to_string(i * 7919), slot);
+    }
+    const std::string image(page.raw_data(), PAGE_SIZE);
+    std::string packed;
+    EXPECT_EQ(roundtrip(image, packed), image);
+    EXPECT_LT(packed.size(), PAGE_SIZE / 4);
+
+    // An all-zero page is one long overlapping match.
+    const std::string zeros(PAGE_SIZE, '\0');
+    EXPECT_EQ(roundtrip(zeros, packed), zeros);
+    EXPECT_LT(packed.size(), 32u);
+}
+
+TEST(PageCodec, IncompressibleAndEdgeInputsRoundtrip) {
+    std::mt19937_64 rng(3);
+    std::string random(PAGE_SIZE, '\0');
+    for (auto &c : random) c = static_cast<char>(rng());
+    std::string packed;
+    EXPECT_EQ(roundtrip(random, packed), random);
+
+    for (const std::string &in :
+         {std::string(), std::string("a"), std::string("abcd"),
+          std::string(300, 'x') + "tail", std::string("abcabcabcabcab")}) {
+        EXPECT_EQ(roundtrip(in, packed), in);
+    }
+}
+
+TEST(PageCodec, CorruptBlocksAreRejected) {
+    const std::string in = std::string(1000, 'q') + "0123456789";
+    std::string packed;
+    PageCodec::compress(in, packed);
+    std::string out(in.size(), '\0');
+
+    // Wrong output size.
+    EXPECT_THROW(PageCodec::decompress(packed, out.data(), out.size() - 1),
+                 std::runtime_error);
+    // Truncated block.
+    EXPECT_THROW(PageCodec::decompress(packed.substr(0, packed.size() / 2),
+                                       out.data(), out.size()),
+                 std::runtime_error);
+    // Match offset pointing before the start of the output.
+    std::string bad = packed;
+    bad[2] = static_cast<char>(0xff);
+    bad[3] = static_cast<char>(0xff);
+    EXPECT_THROW(PageCodec::decompress(bad, out.data(), out.size()),
+                 std::runtime_error);
+}
@@ -1,6 +1,9 @@
 #include "srd/storage/slotted_page.hpp"
 
+#include <atomic>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -36,4 +39,41 @@ TEST(SlottedPage, DeleteThenReadFails) {
     p.deleteTuple(0);
     Tuple out;
     EXPECT_FALSE(p.getTuple(0, out));
-}
\ No newline at end of file
+}
+
+TEST(SlottedPage, ConcurrentReadersSeeWholeTuples) {
+    SlottedPage p;
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_TRUE(p.addTuple(makeTuple(i, float(i), std::to_string(i))));
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> bad{0};
+    // The writer keeps rewriting slot 0; every version is self-consistent.
+    std::thread writer([&] {
+        for (int i = 0; i < 2000; ++i) {
+            p.deleteTuple(0);
+            p.addTuple(makeTuple(i, float(i), std::to_string(i)));
+        }
+        stop = true;
+    });
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            while (!stop) {
+                for (size_t slot = 0; slot < 8; ++slot) {
+                    Tuple t;
+                    if (!p.getTuple(slot, t)) continue;
+                    const int i = t.fields[0]->asInt();
+                    if (t.fields[1]->asFloat() != float(i) ||
+                        t.fields[2]->asString() != std::to_string(i)) {
+                        ++bad;
+                    }
+                }
+            }
+        });
+    }
+    writer.join();
+    for (auto &t : readers) t.join();
+    EXPECT_EQ(bad.load(), 0);
+}
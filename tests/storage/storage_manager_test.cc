@@ -2,16 +2,23 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <random>
 #include <string>
+#include <thread>
 
 #include "srd/storage/slotted_page.hpp"
 
 using srd::storage::PAGE_SIZE;
 using srd::storage::SlottedPage;
+using srd::storage::SnapshotOptions;
 using srd::storage::StorageManager;
+using srd::storage::StorageOptions;
 
 // Simple unique-ish temp file name inside Bazel sandbox
 static std::string tmp_db_path(const char* tag) {
@@ -101,4 +108,500 @@ TEST(StorageManagerTest, LoadAndFlushOutOfRangeThrow) {
 
     auto p = std::make_unique<SlottedPage>();
     EXPECT_THROW(sm.flush(n, *p), std::out_of_range);
-}
\ No newline at end of file
+}
+
+TEST(StorageManagerTest, FixedGrowthReservesWholeChunks) {
+    auto path = tmp_db_path("fixed");
+    srd::storage::StorageOptions opts;
+    opts.growth.kind = srd::storage::GrowthPolicy::Kind::FIXED;
+    opts.growth.chunk_pages = 16;
+    StorageManager sm(path, opts);
+
+    EXPECT_EQ(sm.num_pages(), 1u);
+    EXPECT_EQ(sm.capacity_pages(), 16u);
+
+    for (int i = 0; i < 15; ++i) sm.extend_one();
+    EXPECT_EQ(sm.num_pages(), 16u);
+    EXPECT_EQ(sm.capacity_pages(), 16u);
+
+    sm.extend_one();
+    EXPECT_EQ(sm.num_pages(), 17u);
+    EXPECT_EQ(sm.capacity_pages(), 32u);
+
+    // One request bigger than a chunk is reserved in a single step.
+    sm.extend_to(99);
+    EXPECT_EQ(sm.num_pages(), 100u);
+    EXPECT_EQ(sm.capacity_pages(), 100u);
+}
+
+TEST(StorageManagerTest, GeometricGrowthScalesWithCapacity) {
+    auto path = tmp_db_path("geometric");
+    srd::storage::StorageOptions opts;
+    opts.growth.chunk_pages = 4;
+    opts.growth.factor = 1.0;
+    StorageManager sm(path, opts);
+
+    sm.extend_to(99);
+    const auto cap = sm.capacity_pages();
+    EXPECT_GE(cap, 100u);
+    sm.extend_to(cap);  // one past the reservation
+    EXPECT_GE(sm.capacity_pages(), 2 * cap);
+}
+
+TEST(StorageManagerTest, ReopenSeesLogicalPagesOnly) {
+    auto path = tmp_db_path("trim");
+    {
+        StorageManager sm(path);
+        sm.extend_to(9);
+        EXPECT_EQ(sm.num_pages(), 10u);
+        EXPECT_GT(sm.capacity_pages(), sm.num_pages());
+    }
+    EXPECT_FALSE(
+        std::filesystem::exists(StorageManager::logical_size_path(path)));
+    StorageManager sm(path);
+    EXPECT_EQ(sm.num_pages(), 10u);
+    EXPECT_EQ(sm.capacity_pages(), 10u);
+}
+
+TEST(StorageManagerTest, ReservationIsNotDataAfterCrash) {
+    auto path = tmp_db_path("crash");
+    auto crashed = tmp_db_path("crashed");
+    StorageManager sm(path);
+    sm.extend_to(9);
+    sm.sync();  // pages 0..9 are logical from here on, though never written
+    sm.extend_to(19);
+    SlottedPage page;
+    std::size_t slot = 0;
+    page.addRecord("written past the recorded size", slot);
+    sm.flush(14, page);
+    ASSERT_GT(sm.capacity_pages(), 20u);
+
+    // A copy of the open file stands in for the file after a crash.
+    std::filesystem::copy_file(path, crashed);
+    std::filesystem::copy_file(StorageManager::logical_size_path(path),
+                               StorageManager::logical_size_path(crashed));
+    {
+        StorageManager after(crashed);
+        EXPECT_EQ(after.num_pages(), 15u);
+        EXPECT_EQ(after.capacity_pages(), sm.capacity_pages());
+        EXPECT_EQ(std::memcmp(after.load(14)->raw_data(), page.raw_data(),
+                              PAGE_SIZE),
+                  0);
+        after.extend_to(29);
+    }
+    StorageManager again(crashed);
+    EXPECT_EQ(again.num_pages(), 30u);
+    EXPECT_EQ(again.capacity_pages(), 30u);
+}
+
+TEST(StorageManagerTest, GrownPageLoadsAsEmptyPage) {
+    auto path = tmp_db_path("grown");
+    StorageManager sm(path);
+    sm.extend_to(3);
+
+    auto page = sm.load(3);
+    srd::record::Tuple out;
+    EXPECT_FALSE(page->getTuple(0, out));
+    EXPECT_EQ(page->used_bytes(), 0u);
+
+    auto t = std::make_unique<srd::record::Tuple>();
+    t->addField(std::make_unique<srd::record::Field>(17));
+    ASSERT_TRUE(page->addTuple(std::move(t)));
+    sm.flush(3, *page);
+
+    auto again = sm.load(3);
+    ASSERT_TRUE(again->getTuple(0, out));
+    EXPECT_EQ(out.fields[0]->asInt(), 17);
+}
+
+TEST(StorageManagerTest, PageBuffersAreAligned) {
+    SlottedPage p;
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p.raw_data()) %
+                  srd::storage::PAGE_ALIGNMENT,
+              0u);
+}
+
+TEST(StorageManagerTest, DirectIoRoundtrip) {
+    auto path = tmp_db_path("direct");
+    srd::storage::StorageOptions opts;
+    opts.direct_io = true;
+    {
+        // Works whether or not the filesystem honours O_DIRECT.
+        StorageManager sm(path, opts);
+        sm.extend_to(4);
+        auto page = std::make_unique<SlottedPage>();
+        std::memset(page->raw_data(), 0x5C, PAGE_SIZE);
+        sm.flush(4, *page);
+        auto reread = sm.load(4);
+        EXPECT_EQ(std::memcmp(reread->raw_data(), page->raw_data(), PAGE_SIZE),
+                  0);
+    }
+    StorageManager sm(path, opts);
+    EXPECT_EQ(sm.num_pages(), 5u);
+    auto reread = sm.load(4);
+    EXPECT_EQ(static_cast<unsigned char>(reread->raw_data()[PAGE_SIZE - 1]),
+              0x5C);
+}
+
+static void fill_page(SlottedPage &p, std::uint64_t tag) {
+    for (size_t i = 0; i < PAGE_SIZE; ++i) {
+        p.raw_data()[i] = static_cast<char>((i + tag * 31) % 251);
+    }
+}
+
+TEST(StorageManagerTest, LoadRangeAndFlushRangeRoundtrip) {
+    auto path = tmp_db_path("range");
+    StorageManager sm(path);
+    sm.extend_to(15);
+
+    std::vector<std::unique_ptr<SlottedPage>> owned;
+    std::vector<const SlottedPage *> pages;
+    for (std::uint64_t i = 0; i < 8; ++i) {
+        owned.push_back(std::make_unique<SlottedPage>());
+        fill_page(*owned.back(), 4 + i);
+        pages.push_back(owned.back().get());
+    }
+    sm.flush_range(4, pages);
+
+    auto loaded = sm.load_range(3, 10);
+    ASSERT_EQ(loaded.size(), 10u);
+    for (std::uint64_t i = 0; i < 8; ++i) {
+        EXPECT_EQ(std::memcmp(loaded[i + 1]->raw_data(), pages[i]->raw_data(),
+                              PAGE_SIZE),
+                  0)
+            << "page " << 4 + i;
+    }
+    // Single-page load agrees with the vectored read.
+    auto single = sm.load(7);
+    EXPECT_EQ(
+        std::memcmp(single->raw_data(), loaded[4]->raw_data(), PAGE_SIZE), 0);
+
+    EXPECT_THROW(sm.load_range(10, 7), std::out_of_range);
+    EXPECT_THROW(sm.flush_range(14, pages), std::out_of_range);
+    EXPECT_TRUE(sm.load_range(0, 0).empty());
+}
+
+TEST(StorageManagerTest, FlushPagesCoalescesAdjacentIds) {
+    auto path = tmp_db_path("coalesce");
+    StorageManager sm(path);
+    sm.extend_to(20);
+
+    std::vector<std::unique_ptr<SlottedPage>> owned;
+    std::vector<std::pair<std::uint64_t, const SlottedPage *>> dirty;
+    // Three runs: {2,3,4}, {9,10}, {15}; submitted out of order.
+    for (std::uint64_t id : {10, 3, 15, 2, 9, 4}) {
+        owned.push_back(std::make_unique<SlottedPage>());
+        fill_page(*owned.back(), id);
+        dirty.emplace_back(id, owned.back().get());
+    }
+    // A later duplicate of page 3 replaces the earlier one.
+    owned.push_back(std::make_unique<SlottedPage>());
+    fill_page(*owned.back(), 99);
+    dirty.emplace_back(3, owned.back().get());
+
+    EXPECT_EQ(sm.flush_pages(dirty), 3u);
+
+    SlottedPage expect;
+    for (std::uint64_t id : {2, 4, 9, 10, 15}) {
+        fill_page(expect, id);
+        auto p = sm.load(id);
+        EXPECT_EQ(std::memcmp(p->raw_data(), expect.raw_data(), PAGE_SIZE), 0)
+            << "page " << id;
+    }
+    fill_page(expect, 99);
+    EXPECT_EQ(std::memcmp(sm.load(3)->raw_data(), expect.raw_data(), PAGE_SIZE),
+              0);
+}
+
+// Incompressible page content.
+static void fill_random(SlottedPage &p, std::uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    for (size_t i = 0; i < PAGE_SIZE; ++i) {
+        p.raw_data()[i] = static_cast<char>(rng());
+    }
+}
+
+static StorageOptions compressed_options() {
+    StorageOptions o;
+    o.compressed = true;
+    return o;
+}
+
+TEST(StorageManagerTest, CompressedRoundtripRewriteAndReopen) {
+    auto path = tmp_db_path("compressed");
+    std::vector<std::unique_ptr<SlottedPage>> owned;
+    {
+        StorageManager sm(path, compressed_options());
+        EXPECT_TRUE(sm.compressed());
+        sm.extend_to(9);
+        std::vector<const SlottedPage *> pages;
+        for (int i = 0; i < 8; ++i) {
+            owned.push_back(std::make_unique<SlottedPage>());
+            std::size_t slot = 0;
+            for (int r = 0; r < 20; ++r) {
+                owned.back()->addRecord(
+                    "record " + std::to_string(i * 100 + r), slot);
+            }
+            pages.push_back(owned.back().get());
+        }
+        sm.flush_range(1, pages);
+        // Mostly-empty slotted pages shrink to a fraction of PAGE_SIZE.
+        EXPECT_LT(sm.file_bytes(), 8 * PAGE_SIZE / 4);
+
+        // Never-written pages read as zeros; runs mix both kinds.
+        auto loaded = sm.load_range(0, 10);
+        for (char c : std::string_view(loaded[0]->raw_data(), PAGE_SIZE)) {
+            ASSERT_EQ(c, 0);
+        }
+        for (int i = 0; i < 8; ++i) {
+            EXPECT_EQ(std::memcmp(loaded[i + 1]->raw_data(),
+                                  owned[i]->raw_data(), PAGE_SIZE),
+                      0);
+        }
+
+        // A rewrite never overwrites the page's extent: it appends until a
+        // sync() has freed the old one, which a later write reuses.
+        const auto before = sm.file_bytes();
+        sm.flush(3, *owned[2]);
+        const auto grown = sm.file_bytes();
+        EXPECT_GT(grown, before);
+        sm.sync();
+        sm.flush(3, *owned[2]);
+        EXPECT_EQ(sm.file_bytes(), grown);
+        fill_random(*owned[5], 7);
+        sm.flush(6, *owned[5]);
+        EXPECT_GT(sm.file_bytes(), grown + PAGE_SIZE);
+    }
+
+    StorageManager sm(path, compressed_options());
+    EXPECT_EQ(sm.num_pages(), 10u);
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(std::memcmp(sm.load(i + 1)->raw_data(), owned[i]->raw_data(),
+                              PAGE_SIZE),
+                  0)
+            << "page " << i + 1;
+    }
+}
+
+TEST(StorageManagerTest, CompressedMapIsRebuiltFromExtents) {
+    auto path = tmp_db_path("rebuild");
+    SlottedPage a, b;
+    fill_random(a, 1);
+    std::size_t slot = 0;
+    b.addRecord("hello", slot);
+    {
+        StorageManager sm(path, compressed_options());
+        sm.extend_to(2);
+        sm.flush(1, a);
+        sm.flush(2, b);
+        sm.flush(1, b);  // appended after page 2
+        sm.sync();       // frees page 1's first extent
+        sm.flush(2, a);  // reuses it: the latest image is not the last one
+    }
+    std::filesystem::remove(StorageManager::page_map_path(path));
+
+    StorageManager sm(path, compressed_options());
+    EXPECT_EQ(sm.num_pages(), 3u);
+    EXPECT_EQ(std::memcmp(sm.load(1)->raw_data(), b.raw_data(), PAGE_SIZE), 0);
+    EXPECT_EQ(std::memcmp(sm.load(2)->raw_data(), a.raw_data(), PAGE_SIZE), 0);
+
+    // A raw file is not mistaken for a compressed one.
+    auto raw_path = tmp_db_path("raw");
+    {
+        StorageManager raw(raw_path);
+        raw.flush(0, a);
+    }
+    EXPECT_THROW(StorageManager(raw_path, compressed_options()),
+                 std::runtime_error);
+}
+
+TEST(StorageManagerTest, CompressedRebuildDropsTornAppend) {
+    auto path = tmp_db_path("torn");
+    SlottedPage a, b;
+    fill_random(a, 1);
+    fill_random(b, 2);
+    {
+        StorageManager sm(path, compressed_options());
+        sm.extend_to(1);
+        sm.flush(0, a);
+        sm.flush(1, b);
+    }
+    std::filesystem::remove(StorageManager::page_map_path(path));
+
+    // Corrupt the body of the last extent, keeping its header intact, as a
+    // crash in the middle of the append could.
+    std::string bytes;
+    {
+        std::ifstream is(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(is),
+                     std::istreambuf_iterator<char>());
+    }
+    std::size_t last = 0;
+    for (std::size_t off = 0; off < bytes.size();) {
+        uint32_t capacity = 0;
+        std::memcpy(&capacity, bytes.data() + off + 16, sizeof(capacity));
+        ASSERT_GT(capacity, 0u);
+        last = off;
+        off += capacity;
+    }
+    ASSERT_GT(last, 0u);
+    bytes[last + 32 + 100] ^= 0x5a;
+    {
+        std::ofstream os(path, std::ios::binary | std::ios::trunc);
+        os.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    {
+        StorageManager sm(path, compressed_options());
+        ASSERT_EQ(sm.num_pages(), 1u);
+        EXPECT_EQ(std::memcmp(sm.load(0)->raw_data(), a.raw_data(), PAGE_SIZE),
+                  0);
+        // The torn bytes are reused by the next append.
+        sm.extend_to(1);
+        sm.flush(1, b);
+        EXPECT_EQ(sm.file_bytes(), bytes.size());
+    }
+    StorageManager sm(path, compressed_options());
+    ASSERT_EQ(sm.num_pages(), 2u);
+    EXPECT_EQ(std::memcmp(sm.load(1)->raw_data(), b.raw_data(), PAGE_SIZE), 0);
+}
+
+TEST(StorageManagerTest, CompressedReadsNeverSeeAPartialRewrite) {
+    auto path = tmp_db_path("rewrite_race");
+    StorageManager sm(path, compressed_options());
+    SlottedPage images[2];
+    fill_random(images[0], 1);
+    std::size_t slot = 0;
+    images[1].addRecord("small", slot);
+    sm.flush(0, images[0]);
+
+    // Rewrites alternate between a raw and a small extent, and the syncs
+    // free old ones, so writes keep landing on extents reads used before.
+    std::atomic<bool> stop{false};
+    std::atomic<int> bad{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; ++t) {
+        readers.emplace_back([&] {
+            while (!stop.load()) {
+                try {
+                    auto p = sm.load(0);
+                    if (std::memcmp(p->raw_data(), images[0].raw_data(),
+                                    PAGE_SIZE) != 0 &&
+                        std::memcmp(p->raw_data(), images[1].raw_data(),
+                                    PAGE_SIZE) != 0) {
+                        ++bad;
+                    }
+                } catch (const std::exception &) {
+                    ++bad;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < 2000; ++i) {
+        sm.flush(0, images[i % 2]);
+        if (i % 10 == 0) sm.sync();
+    }
+    stop = true;
+    for (auto &t : readers) t.join();
+    EXPECT_EQ(bad.load(), 0);
+    // Freed extents are reused rather than the file growing with rewrites.
+    EXPECT_LT(sm.file_bytes(), 64 * PAGE_SIZE);
+}
+
+// Page content derived from 'seq', which is also stored in its first bytes.
+static void stamp_page(SlottedPage &p, std::uint64_t seq) {
+    fill_page(p, seq);
+    std::memcpy(p.raw_data(), &seq, sizeof(seq));
+}
+
+static std::uint64_t check_stamp(const SlottedPage &p) {
+    std::uint64_t seq = 0;
+    std::memcpy(&seq, p.raw_data(), sizeof(seq));
+    SlottedPage expect;
+    stamp_page(expect, seq);
+    EXPECT_EQ(std::memcmp(p.raw_data(), expect.raw_data(), PAGE_SIZE), 0)
+        << "torn page with stamp " << seq;
+    return seq;
+}
+
+TEST(StorageManagerTest, SnapshotIsPointInTimeUnderConcurrentWrites) {
+    constexpr std::uint64_t N = 256;
+    auto path = tmp_db_path("snap_src");
+    auto target = tmp_db_path("snap_dst");
+    StorageManager sm(path);
+    sm.extend_to(N - 1);
+    SlottedPage page;
+    for (std::uint64_t i = 0; i < N; ++i) {
+        stamp_page(page, i);
+        sm.flush(i, page);
+    }
+
+    // One writer rewrites the pages round-robin; write k stamps page k % N
+    // with k. A point-in-time image therefore holds N consecutive stamps.
+    std::atomic<bool> stop{false};
+    std::thread writer([&] {
+        SlottedPage p;
+        for (std::uint64_t k = N; !stop.load(); ++k) {
+            stamp_page(p, k);
+            sm.flush(k % N, p);
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    SnapshotOptions o;
+    o.reflink = false;
+    o.chunk_pages = 4;
+    o.bytes_per_sec = 8 << 20;  // ~2 MiB of copy I/O: about 250 ms
+    const auto stats = sm.snapshot_to(target, o);
+    stop = true;
+    writer.join();
+
+    EXPECT_EQ(stats.pages, N);
+    EXPECT_FALSE(stats.reflinked);
+    EXPECT_GT(stats.copied_by_writers, 0u);
+    StorageManager snap(target);
+    ASSERT_EQ(snap.num_pages(), N);
+    std::uint64_t lo = ~std::uint64_t{0}, hi = 0;
+    for (std::uint64_t i = 0; i < N; ++i) {
+        const std::uint64_t seq = check_stamp(*snap.load(i));
+        EXPECT_EQ(seq % N, i);
+        lo = std::min(lo, seq);
+        hi = std::max(hi, seq);
+    }
+    EXPECT_LT(hi - lo, N);
+}
+
+TEST(StorageManagerTest, SnapshotCopiesRawAndCompressedFiles) {
+    SnapshotOptions o;  // reflink where possible, copy otherwise
+    for (bool compressed : {false, true}) {
+        StorageOptions opts;
+        opts.compressed = compressed;
+        auto path = tmp_db_path("snap_src");
+        auto target = tmp_db_path("snap_dst");
+        SlottedPage page;
+        {
+            StorageManager sm(path, opts);
+            sm.extend_to(40);
+            for (std::uint64_t i = 0; i < 30; ++i) {
+                stamp_page(page, i);
+                sm.flush(i, page);
+            }
+            // Never onto the file itself: opening it would wipe it.
+            EXPECT_THROW(sm.snapshot_to(path, o), std::runtime_error);
+            EXPECT_EQ(check_stamp(*sm.load(7)), 7u);
+            const auto stats = sm.snapshot_to(target, o);
+            EXPECT_EQ(stats.pages, 41u);
+            // Later writes do not reach the snapshot.
+            stamp_page(page, 1000);
+            sm.flush(3, page);
+        }
+        StorageManager snap(target, opts);
+        ASSERT_EQ(snap.num_pages(), 41u) << compressed;
+        for (std::uint64_t i = 0; i < 30; ++i) {
+            EXPECT_EQ(check_stamp(*snap.load(i)), i);
+        }
+        // Never written: reads as an empty page.
+        EXPECT_EQ(snap.load(35)->raw_data()[0], 0);
+        std::filesystem::remove(StorageManager::page_map_path(target));
+        std::filesystem::remove(StorageManager::page_map_path(path));
+    }
+}
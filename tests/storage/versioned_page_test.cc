@@ -0,0 +1,151 @@
+#include "srd/storage/versioned_page.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using srd::record::Field;
+using srd::record::Tuple;
+using srd::storage::Snapshot;
+using srd::storage::VersionClock;
+using srd::storage::VersionedPage;
+
+static Tuple makeTuple(int i, std::string s) {
+    Tuple t;
+    t.addField(std::make_unique<Field>(i));
+    t.addField(std::make_unique<Field>(s));
+    return t;
+}
+
+static int readInt(const VersionedPage &p, size_t slot, uint64_t ts) {
+    Tuple out;
+    if (!p.read(slot, ts, out)) return -1;
+    return out.fields[0]->asInt();
+}
+
+TEST(VersionedPage, SnapshotSeesStateAsOfItsStart) {
+    VersionClock clock;
+    VersionedPage page(clock);
+    size_t slot = 0;
+    ASSERT_TRUE(page.insert(makeTuple(1, "one"), slot));
+
+    Snapshot before(clock);
+    ASSERT_TRUE(page.update(slot, makeTuple(2, "two")));
+    Snapshot middle(clock);
+    ASSERT_TRUE(page.update(slot, makeTuple(3, "three")));
+    Snapshot after(clock);
+
+    EXPECT_EQ(readInt(page, slot, before.ts()), 1);
+    EXPECT_EQ(readInt(page, slot, middle.ts()), 2);
+    EXPECT_EQ(readInt(page, slot, after.ts()), 3);
+    EXPECT_EQ(page.undo_versions(), 2u);
+}
+
+TEST(VersionedPage, InsertAndDeleteVisibility) {
+    VersionClock clock;
+    VersionedPage page(clock);
+
+    Snapshot empty(clock);
+    size_t slot = 0;
+    ASSERT_TRUE(page.insert(makeTuple(7, "x"), slot));
+    Snapshot live(clock);
+    ASSERT_TRUE(page.remove(slot));
+    Snapshot gone(clock);
+
+    EXPECT_EQ(readInt(page, slot, empty.ts()), -1);
+    EXPECT_EQ(readInt(page, slot, live.ts()), 7);
+    EXPECT_EQ(readInt(page, slot, gone.ts()), -1);
+    EXPECT_FALSE(page.remove(slot));
+    EXPECT_FALSE(page.update(slot, makeTuple(8, "y")));
+}
+
+TEST(VersionedPage, GarbageCollectionRespectsOpenSnapshots) {
+    VersionClock clock;
+    VersionedPage page(clock);
+    size_t a = 0, b = 0;
+    ASSERT_TRUE(page.insert(makeTuple(1, "a"), a));
+    ASSERT_TRUE(page.insert(makeTuple(10, "b"), b));
+
+    {
+        Snapshot old(clock);
+        ASSERT_TRUE(page.update(a, makeTuple(2, "a")));
+        ASSERT_TRUE(page.remove(b));
+        // The old snapshot still needs both superseded versions.
+        EXPECT_EQ(page.collect_garbage(), 0u);
+        EXPECT_EQ(readInt(page, a, old.ts()), 1);
+        EXPECT_EQ(readInt(page, b, old.ts()), 10);
+    }
+    // Undo entry for 'a' and the deleted row 'b'.
+    EXPECT_EQ(page.collect_garbage(), 2u);
+    EXPECT_EQ(page.undo_versions(), 0u);
+
+    Snapshot now(clock);
+    EXPECT_EQ(readInt(page, a, now.ts()), 2);
+    Tuple raw;
+    EXPECT_FALSE(page.page().getTuple(b, raw));
+}
+
+TEST(VersionedPage, FullPageReclaimsDeadRowsOnInsert) {
+    VersionClock clock;
+    VersionedPage page(clock);
+    const std::string filler(200, 'f');
+    std::vector<size_t> slots;
+    size_t slot = 0;
+    while (page.insert(makeTuple(int(slots.size()), filler), slot)) {
+        slots.push_back(slot);
+    }
+    ASSERT_GT(slots.size(), 2u);
+    ASSERT_TRUE(page.remove(slots[0]));
+    ASSERT_TRUE(page.remove(slots[1]));
+
+    // No snapshot is open, so the deleted rows are reclaimed on demand.
+    ASSERT_TRUE(page.insert(makeTuple(-5, filler), slot));
+    Snapshot now(clock);
+    EXPECT_EQ(readInt(page, slot, now.ts()), -5);
+}
+
+TEST(VersionedPage, ReadersDoNotBlockAndSeeStableSnapshots) {
+    VersionClock clock;
+    VersionedPage page(clock);
+    std::vector<size_t> slots(8);
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_TRUE(page.insert(makeTuple(0, "v0"), slots[i]));
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> bad{0};
+    std::thread writer([&] {
+        // Every round sets all rows to the same value, one row at a time.
+        for (int round = 1; round <= 300; ++round) {
+            for (size_t s : slots) {
+                page.update(s, makeTuple(round, "v" + std::to_string(round)));
+            }
+            if (round % 50 == 0) page.collect_garbage();
+        }
+        stop = true;
+    });
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; ++r) {
+        readers.emplace_back([&] {
+            while (!stop) {
+                Snapshot snap(clock);
+                // Within one snapshot values never go backwards across rows
+                // updated in order, and a row reads the same twice.
+                int prev = INT32_MAX;
+                for (size_t s : slots) {
+                    const int v = readInt(page, s, snap.ts());
+                    if (v < 0 || v > prev || readInt(page, s, snap.ts()) != v) {
+                        ++bad;
+                    }
+                    prev = v;
+                }
+            }
+        });
+    }
+    writer.join();
+    for (auto &t : readers) t.join();
+    EXPECT_EQ(bad.load(), 0);
+}